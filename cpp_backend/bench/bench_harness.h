@@ -0,0 +1,138 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+// Minimal Google Benchmark-style harness: each benchmark is calibrated to run
+// for at least --min-time seconds, repeated --repetitions times, and the median
+// is reported. --json prints Google Benchmark compatible JSON so results can be
+// diffed across commits; --filter=SUBSTR selects benchmarks by name.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// Keep the optimizer from discarding a computed value.
+template <typename T>
+inline void doNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result {
+  std::string name;
+  uint64_t iterations;
+  double ns_per_op;
+  double bytes_per_second; // 0 when not applicable
+  double items_per_second;
+  std::vector<std::pair<std::string, double>> counters;
+};
+
+class Runner {
+public:
+  Runner(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg == "--json") {
+        json = true;
+      } else if (arg.rfind("--filter=", 0) == 0) {
+        filter = arg.substr(9);
+      } else if (arg.rfind("--min-time=", 0) == 0) {
+        min_time = std::stod(arg.substr(11));
+      } else if (arg.rfind("--repetitions=", 0) == 0) {
+        repetitions = std::max(1, std::stoi(arg.substr(14)));
+      }
+    }
+  }
+
+  // fn(iterations) must perform `iterations` operations. bytes/items are per operation.
+  template <typename F>
+  void run(const std::string& name, F&& fn, double bytes_per_op = 0, double items_per_op = 1) {
+    if (!filter.empty() && name.find(filter) == std::string::npos) {
+      return;
+    }
+
+    // Calibrate: grow the iteration count until one batch takes min_time.
+    uint64_t iterations = 1;
+    double elapsed = 0;
+    while (true) {
+      elapsed = time(fn, iterations);
+      if (elapsed >= min_time || iterations >= (1ull << 40)) {
+        break;
+      }
+      double scale = elapsed > 0 ? (min_time * 1.4) / elapsed : 10;
+      iterations = static_cast<uint64_t>(iterations * std::min(std::max(scale, 2.0), 100.0));
+    }
+
+    std::vector<double> samples;
+    for (int r = 0; r < repetitions; ++r) {
+      samples.push_back(time(fn, iterations) * 1e9 / iterations);
+    }
+    std::sort(samples.begin(), samples.end());
+    double ns = samples[samples.size() / 2];
+
+    Result result{name, iterations, ns, bytes_per_op > 0 ? bytes_per_op * 1e9 / ns : 0, items_per_op * 1e9 / ns, {}};
+    results.push_back(result);
+    if (!json) {
+      std::printf("%-48s %14.1f ns/op %14.0f items/s", name.c_str(), ns, result.items_per_second);
+      if (result.bytes_per_second > 0) {
+        std::printf(" %10.1f MiB/s", result.bytes_per_second / (1024.0 * 1024.0));
+      }
+      std::printf("\n");
+    }
+  }
+
+  // Attach a custom counter (e.g. allocations per op) to the most recent result.
+  void counter(const std::string& key, double value) {
+    if (results.empty()) {
+      return;
+    }
+    results.back().counters.emplace_back(key, value);
+    if (!json) {
+      std::printf("%-48s %14.2f %s\n", "", value, key.c_str());
+    }
+  }
+
+  int finish() {
+    if (!json) {
+      return 0;
+    }
+    std::cout << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+      const Result& r = results[i];
+      std::cout << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+                << ", \"real_time\": " << r.ns_per_op << ", \"time_unit\": \"ns\""
+                << ", \"items_per_second\": " << r.items_per_second;
+      if (r.bytes_per_second > 0) {
+        std::cout << ", \"bytes_per_second\": " << r.bytes_per_second;
+      }
+      for (const auto& c : r.counters) {
+        std::cout << ", \"" << c.first << "\": " << c.second;
+      }
+      std::cout << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    std::cout << "  ]\n}" << std::endl;
+    return 0;
+  }
+
+private:
+  template <typename F>
+  static double time(F& fn, uint64_t iterations) {
+    auto start = std::chrono::steady_clock::now();
+    fn(iterations);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  bool json = false;
+  std::string filter;
+  double min_time = 0.2;
+  int repetitions = 5;
+  std::vector<Result> results;
+};
+
+} // namespace bench
+
+#endif // BENCH_HARNESS_H
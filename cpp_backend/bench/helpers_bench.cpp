@@ -0,0 +1,244 @@
+// Per-request helpers and JSON serialization paths: video ID extraction, user
+// ID generation, pgvector and array literal formatting, and the row -> json ->
+// dump() rendering Database does for every response.
+//
+//   ./build/helpers-bench [--json] [--filter=SUBSTR]
+
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_harness.h"
+#include "config.h"
+#include "embedding_parser.h"
+#include "helpers.h"
+#include "tally_cache.h"
+#include "topic_dictionary.h"
+
+namespace {
+
+std::vector<float> makeEmbedding(uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> v(EMBEDDING_DIM);
+    double norm = 0;
+    for (float& f : v) {
+        f = dist(gen);
+        norm += f * f;
+    }
+    for (float& f : v) {
+        f = static_cast<float>(f / std::sqrt(norm));
+    }
+    return v;
+}
+
+// Tallies as the cache holds them: unsorted, long-tailed vote counts
+std::vector<TopicTally> makeTallies(size_t n, uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::vector<TopicTally> tallies;
+    for (size_t i = 0; i < n; ++i) {
+        int votes = static_cast<int>(1000 / (1 + gen() % 200));
+        tallies.push_back(TopicTally{static_cast<int>(1 + gen() % 5000), votes, votes + static_cast<int>(gen() % 5)});
+    }
+    return tallies;
+}
+
+// The GET /videos/:id/topics list as an nlohmann::json tree
+nlohmann::json topicsJson(const TopicDictionary& topics, std::vector<TopicTally>& tallies) {
+    std::stable_sort(tallies.begin(), tallies.end(),
+                     [](const TopicTally& a, const TopicTally& b) { return a.total_votes > b.total_votes; });
+
+    nlohmann::json topics_list = nlohmann::json::array();
+    for (const auto& tally : tallies) {
+        const std::string* topicName = topics.nameForId(tally.topic_id);
+        nlohmann::json topic_data;
+        topic_data["topic_id"] = tally.topic_id;
+        topic_data["topic_name"] = topicName ? *topicName : "";
+        topic_data["total_votes"] = tally.total_votes;
+        topics_list.push_back(topic_data);
+    }
+    return topics_list;
+}
+
+// Reference point for generateUserId: one engine per thread instead of per call
+std::string userIdThreadLocalEngine() {
+    thread_local std::mt19937 gen(std::random_device{}());
+    static const char hex[] = "0123456789abcdef";
+    std::string id = "user-";
+    for (int i = 0; i < 9; ++i) {
+        id += hex[gen() & 15];
+    }
+    return id;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::Runner runner(argc, argv);
+
+    const std::vector<std::pair<std::string, std::string>> urls = {
+        {"watch", "https://www.youtube.com/watch?v=dQw4w9WgXcQ"},
+        {"watch_playlist_timestamp",
+         "https://www.youtube.com/watch?v=dQw4w9WgXcQ&list=PLFgquLnL59alCl_2TQvOiD5Vgm1hCaGSI&index=3&t=42s"},
+        {"playlist_first", "https://www.youtube.com/watch?list=PLFgquLnL59alCl_2TQvOiD5Vgm1hCaGSI&index=3&v=dQw4w9WgXcQ"},
+        {"short_timestamp", "https://youtu.be/dQw4w9WgXcQ?t=42"},
+        {"mobile_share", "https://m.youtube.com/watch?feature=share&si=AbCdEfGhIjKlMnOp&v=dQw4w9WgXcQ"},
+        {"invalid", "https://example.com/channel/UCuAXFkgsw1L7xaCfnd5JJOw/videos?view=0&sort=p"},
+    };
+    for (const auto& url : urls) {
+        runner.run("getYouTubeVideoId/" + url.first, [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                std::string id = getYouTubeVideoId(url.second);
+                bench::doNotOptimize(id);
+            }
+        });
+    }
+
+    runner.run("generateUserId", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::string id = generateUserId();
+            bench::doNotOptimize(id);
+        }
+    });
+    runner.run("generateUserId/reference_thread_local_engine", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::string id = userIdThreadLocalEngine();
+            bench::doNotOptimize(id);
+        }
+    });
+
+    const std::vector<float> embedding = makeEmbedding(42);
+    runner.run("formatVectorForPgvector/384", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::string s = formatVectorForPgvector(embedding);
+            bench::doNotOptimize(s);
+        }
+    }, EMBEDDING_DIM * sizeof(float));
+
+    std::vector<std::string> page_ids;
+    for (int i = 0; i < 20; ++i) {
+        page_ids.push_back(getYouTubeVideoId("https://youtu.be/vid" + std::to_string(100000 + i) + "xx"));
+    }
+    runner.run("formatPgTextArray/20_ids", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::string s = formatPgTextArray(page_ids);
+            bench::doNotOptimize(s);
+        }
+    });
+
+    // GET /videos/:id - one row with four text columns
+    runner.run("json/video_row_dump", [&](uint64_t n) {
+        const std::string id = "dQw4w9WgXcQ";
+        const std::string title = "Rick Astley - Never Gonna Give You Up (Official Music Video)";
+        const std::string upload_date = "2009-10-25 06:57:33.123456+00";
+        const std::string last_updated = "2026-01-31 12:00:00.654321+00";
+        for (uint64_t i = 0; i < n; ++i) {
+            nlohmann::json video_data;
+            video_data["id"] = id;
+            video_data["title"] = title;
+            video_data["upload_date"] = upload_date;
+            video_data["last_updated"] = last_updated;
+            std::string body = video_data.dump();
+            bench::doNotOptimize(body);
+        }
+    });
+
+    TopicDictionary topics;
+    for (int id = 1; id <= 5000; ++id) {
+        topics.insert(id, "topic-" + std::to_string(id) + (id % 3 ? " music" : " science & technology"));
+    }
+
+    // GET /videos/:id/topics on a heavily tagged video
+    const std::vector<TopicTally> tallies_100 = makeTallies(100, 7);
+    std::string topics_body;
+    runner.run("json/topics_100_build_dump", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::vector<TopicTally> tallies = tallies_100;
+            topics_body = topicsJson(topics, tallies).dump();
+            bench::doNotOptimize(topics_body);
+        }
+    }, 0, 100);
+    runner.counter("body_bytes", static_cast<double>(topics_body.size()));
+
+    // POST /topics/batch for a feed page: 20 videos with 10 topics each
+    std::vector<std::vector<TopicTally>> page_tallies;
+    for (uint32_t v = 0; v < 20; ++v) {
+        page_tallies.push_back(makeTallies(10, 100 + v));
+    }
+    std::string batch_body;
+    runner.run("json/batch_20x10_build_dump", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            nlohmann::json videos_list = nlohmann::json::array();
+            for (size_t v = 0; v < page_ids.size(); ++v) {
+                std::vector<TopicTally> tallies = page_tallies[v];
+                nlohmann::json video_data;
+                video_data["video_id"] = page_ids[v];
+                video_data["topics"] = topicsJson(topics, tallies);
+                videos_list.push_back(video_data);
+            }
+            batch_body = videos_list.dump();
+            bench::doNotOptimize(batch_body);
+        }
+    }, 0, 200);
+    runner.counter("body_bytes", static_cast<double>(batch_body.size()));
+
+    // GET /users/:id/stats
+    runner.run("json/user_stats_dump", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            nlohmann::json stats;
+            stats["user_id"] = "user-1a2b3c4d5";
+            stats["username"] = nullptr;
+            stats["reputation"] = 0;
+            stats["created_at"] = "2026-01-31 12:00:00.654321+00";
+            stats["submissions_count"] = 1234;
+            stats["last_submission_date"] = "2026-02-01 08:30:00.000001+00";
+            stats["most_frequent_tag"] = {{"topic_name", *topics.nameForId(42)}, {"topic_count", 311}};
+            std::string body = stats.dump();
+            bench::doNotOptimize(body);
+        }
+    });
+
+    // Request bodies parsed on the hot write paths
+    const std::string vote_body =
+        R"({"name":"science & technology","desired_vote":1,"user_id":"user-1a2b3c4d5","topic_id":0})";
+    runner.run("json/parse_vote_body", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            nlohmann::json body = nlohmann::json::parse(vote_body);
+            int vote = body.value("desired_vote", 0);
+            bench::doNotOptimize(vote);
+        }
+    }, static_cast<double>(vote_body.size()));
+
+    const std::string embedding_body = nlohmann::json{{"embedding", embedding}}.dump();
+    runner.run("json/parse_embedding_body_384", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            nlohmann::json body = nlohmann::json::parse(embedding_body);
+            std::vector<float> values = body.at("embedding").get<std::vector<float>>();
+            bench::doNotOptimize(values);
+        }
+    }, static_cast<double>(embedding_body.size()));
+
+    // What the embedding route actually runs: SAX decode / raw float32 copy into a reused buffer
+    std::vector<float> decoded(EMBEDDING_DIM);
+    std::string parse_error;
+    runner.run("parseEmbeddingJson/384", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            bool ok = parseEmbeddingJson(embedding_body, decoded.data(), decoded.size(), parse_error);
+            bench::doNotOptimize(ok);
+        }
+    }, static_cast<double>(embedding_body.size()));
+
+    const std::string float32_body(reinterpret_cast<const char*>(embedding.data()),
+                                   embedding.size() * sizeof(float));
+    runner.run("parseEmbeddingFloat32/384", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            bool ok = parseEmbeddingFloat32(float32_body, decoded.data(), decoded.size(), parse_error);
+            bench::doNotOptimize(ok);
+        }
+    }, static_cast<double>(float32_body.size()));
+
+    return runner.finish();
+}
@@ -0,0 +1,213 @@
+// Recall and throughput of the in-process HNSW index (int8 codes) against exact
+// float32 search, with and without re-ranking candidates on the float vectors.
+//
+//   ./build/hnsw-bench [--n=20000] [--queries=500] [--k=10] [--json] [--filter=SUBSTR]
+//
+// Vectors are drawn around random cluster centres so neighbourhoods look like
+// sentence embeddings rather than uniform noise (which is the worst case).
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <queue>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "bench_harness.h"
+#include "config.h"
+#include "hnsw_index.h"
+#include "vector_math.h"
+
+namespace {
+
+size_t argValue(int argc, char** argv, const std::string& name, size_t fallback) {
+    const std::string prefix = "--" + name + "=";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind(prefix, 0) == 0) {
+            return std::stoul(arg.substr(prefix.size()));
+        }
+    }
+    return fallback;
+}
+
+class EmbeddingGenerator {
+public:
+    EmbeddingGenerator(size_t dim, size_t clusters, uint32_t seed) : dim(dim), gen(seed) {
+        std::normal_distribution<float> dist(0.0f, 1.0f);
+        centres.resize(clusters * dim);
+        for (float& f : centres) {
+            f = dist(gen);
+        }
+    }
+
+    std::vector<float> next() {
+        std::normal_distribution<float> noise(0.0f, 0.6f);
+        std::uniform_int_distribution<size_t> pick(0, centres.size() / dim - 1);
+        const float* centre = &centres[pick(gen) * dim];
+        std::vector<float> v(dim);
+        for (size_t i = 0; i < dim; ++i) {
+            v[i] = centre[i] + noise(gen);
+        }
+        return v;
+    }
+
+private:
+    size_t dim;
+    std::mt19937 gen;
+    std::vector<float> centres;
+};
+
+// Brute-force top-k by cosine over normalized float vectors
+std::vector<size_t> exactTopK(const std::vector<std::vector<float>>& data, const float* query, size_t k) {
+    std::priority_queue<std::pair<float, size_t>> best; // (-similarity) max-heap keeps the k most similar
+    for (size_t i = 0; i < data.size(); ++i) {
+        float neg = -dotProduct(query, data[i].data(), data[i].size());
+        if (best.size() < k) {
+            best.emplace(neg, i);
+        } else if (neg < best.top().first) {
+            best.pop();
+            best.emplace(neg, i);
+        }
+    }
+    std::vector<size_t> out;
+    while (!best.empty()) {
+        out.push_back(best.top().second);
+        best.pop();
+    }
+    std::reverse(out.begin(), out.end());
+    return out;
+}
+
+// Approximate candidates from the index, re-scored with the float vectors
+std::vector<size_t> rerankedTopK(const HnswIndex& index, const std::vector<std::vector<float>>& data,
+                                 const float* query, size_t k, size_t candidates, size_t ef) {
+    std::vector<std::pair<float, size_t>> scored;
+    for (const HnswResult& r : index.search(query, candidates, ef)) {
+        size_t id = std::stoul(r.label);
+        scored.emplace_back(-dotProduct(query, data[id].data(), data[id].size()), id);
+    }
+    std::sort(scored.begin(), scored.end());
+    std::vector<size_t> out;
+    for (size_t i = 0; i < scored.size() && i < k; ++i) {
+        out.push_back(scored[i].second);
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::Runner runner(argc, argv);
+    const size_t n = argValue(argc, argv, "n", 20000);
+    const size_t query_count = argValue(argc, argv, "queries", 500);
+    const size_t k = argValue(argc, argv, "k", 10);
+    const size_t dim = EMBEDDING_DIM;
+
+    EmbeddingGenerator generator(dim, 200, 7);
+    std::vector<std::vector<float>> data(n);
+    for (auto& v : data) {
+        v = generator.next();
+        normalizeVector(v.data(), dim);
+    }
+    std::vector<std::vector<float>> queries(query_count);
+    for (auto& q : queries) {
+        q = generator.next();
+        normalizeVector(q.data(), dim);
+    }
+
+    // Kernels: one 384-d dot product per op
+    const std::vector<float>& a = data[0];
+    const std::vector<float>& b = data[1];
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::Avx2, SimdLevel::Avx512}) {
+        if (level > detectSimdLevel()) {
+            continue;
+        }
+        DotProductFn dot = dotProductFor(level);
+        runner.run(std::string("dot/") + simdLevelName(level), [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                float r = dot(a.data(), b.data(), dim);
+                bench::doNotOptimize(r);
+            }
+        }, 2 * dim * sizeof(float));
+    }
+
+    // Build once; reported as a single timed pass rather than calibrated repetitions
+    HnswIndex index(dim, HNSW_M, HNSW_EF_CONSTRUCTION);
+    auto build_start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        index.insert(std::to_string(i), data[i].data(), 1);
+    }
+    double build_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+    std::cerr << "Built HNSW over " << n << " x " << dim << " (M=" << HNSW_M << ", ef_construction="
+              << HNSW_EF_CONSTRUCTION << ", " << simdLevelName(detectSimdLevel()) << ") in " << build_secs
+              << " s, " << static_cast<uint64_t>(n / build_secs) << " inserts/s, "
+              << index.stats().vector_bytes / n << " vector bytes/node" << std::endl;
+
+    // Ground truth
+    std::vector<std::set<std::string>> truth(query_count);
+    for (size_t q = 0; q < query_count; ++q) {
+        for (size_t id : exactTopK(data, queries[q].data(), k)) {
+            truth[q].insert(std::to_string(id));
+        }
+    }
+    auto recall = [&](auto&& searchFn) {
+        size_t hits = 0;
+        for (size_t q = 0; q < query_count; ++q) {
+            for (const std::string& label : searchFn(queries[q].data())) {
+                hits += truth[q].count(label);
+            }
+        }
+        return static_cast<double>(hits) / (query_count * k);
+    };
+    auto labelsOf = [](const std::vector<size_t>& ids) {
+        std::vector<std::string> labels;
+        for (size_t id : ids) {
+            labels.push_back(std::to_string(id));
+        }
+        return labels;
+    };
+
+    size_t next_query = 0;
+    runner.run("search/exact_float32", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            auto r = exactTopK(data, queries[next_query++ % query_count].data(), k);
+            bench::doNotOptimize(r);
+        }
+    });
+    runner.counter("recall_at_k", 1.0);
+
+    for (size_t ef : {16, 32, 64, 128, 256}) {
+        if (ef < k) {
+            continue;
+        }
+        runner.run("search/hnsw_int8_ef=" + std::to_string(ef), [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                auto r = index.search(queries[next_query++ % query_count].data(), k, ef);
+                bench::doNotOptimize(r);
+            }
+        });
+        runner.counter("recall_at_k", recall([&](const float* query) {
+            std::vector<std::string> labels;
+            for (const HnswResult& r : index.search(query, k, ef)) {
+                labels.push_back(r.label);
+            }
+            return labels;
+        }));
+
+        const size_t candidates = std::min(ef, k * HNSW_RERANK_FACTOR);
+        runner.run("search/hnsw_int8_rerank_ef=" + std::to_string(ef), [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                auto r = rerankedTopK(index, data, queries[next_query++ % query_count].data(), k, candidates, ef);
+                bench::doNotOptimize(r);
+            }
+        });
+        runner.counter("recall_at_k", recall([&](const float* query) {
+            return labelsOf(rerankedTopK(index, data, query, k, candidates, ef));
+        }));
+    }
+
+    return runner.finish();
+}
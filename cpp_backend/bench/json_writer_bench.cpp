@@ -0,0 +1,212 @@
+// List response rendering: an nlohmann::json node per row then dump(), against
+// JsonWriter appending straight into the response body. Reports throughput and
+// heap allocations per response on 10k-row results.
+//
+//   ./build/json-writer-bench [--json] [--filter=SUBSTR] [--rows=10000]
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_harness.h"
+#include "json_writer.h"
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// The replaced operator new above allocates with malloc, so free is the matching
+// release. GCC (11+) can't see that once these are inlined into callers and warns
+// with -Wmismatched-new-delete; it is a false positive here.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+// One row of GET /videos/:id/similar_by_vector
+struct SimilarRow {
+    std::string id;
+    std::optional<std::string> title;
+    std::optional<std::string> upload_date;
+    std::optional<std::string> last_updated;
+    double similarity;
+};
+
+// One row of GET /users/contributions
+struct UserRow {
+    std::string id;
+    std::optional<std::string> username;
+    int contributions;
+    size_t rank;
+};
+
+std::vector<SimilarRow> makeSimilarRows(size_t n) {
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<double> sim(0.2, 1.0);
+    std::vector<SimilarRow> rows;
+    for (size_t i = 0; i < n; ++i) {
+        SimilarRow row;
+        row.id = "vid" + std::to_string(10000000 + i);
+        if (i % 5) {
+            row.title = "Video " + std::to_string(i) + " - a \"quoted\" title, long enough to be realistic";
+        }
+        row.upload_date = "2024-03-0" + std::to_string(1 + i % 9) + " 12:00:00";
+        row.last_updated = "2026-01-31 12:00:00.654321";
+        row.similarity = sim(gen);
+        rows.push_back(std::move(row));
+    }
+    return rows;
+}
+
+std::vector<UserRow> makeUserRows(size_t n) {
+    std::vector<UserRow> rows;
+    for (size_t i = 0; i < n; ++i) {
+        UserRow row;
+        row.id = "user-" + std::to_string(100000000 + i);
+        if (i % 3 == 0) {
+            row.username = "name" + std::to_string(i);
+        }
+        row.contributions = static_cast<int>(100000 / (i + 1));
+        row.rank = i + 1;
+        rows.push_back(std::move(row));
+    }
+    return rows;
+}
+
+nlohmann::json optionalJson(const std::optional<std::string>& value) {
+    return value ? nlohmann::json(*value) : nlohmann::json(nullptr);
+}
+
+// As Database rendered it before JsonWriter
+std::string similarDom(const std::vector<SimilarRow>& rows) {
+    nlohmann::json similar_videos = nlohmann::json::array();
+    for (const SimilarRow& row : rows) {
+        nlohmann::json video_data;
+        video_data["id"] = row.id;
+        video_data["title"] = optionalJson(row.title);
+        video_data["upload_date"] = optionalJson(row.upload_date);
+        video_data["last_updated"] = optionalJson(row.last_updated);
+        video_data["similarity"] = row.similarity;
+        similar_videos.push_back(video_data);
+    }
+    return similar_videos.dump();
+}
+
+std::string similarWriter(const std::vector<SimilarRow>& rows) {
+    JsonWriter out(2 + rows.size() * 200);
+    out.beginArray();
+    for (const SimilarRow& row : rows) {
+        out.beginObject();
+        out.key("id").value(row.id);
+        out.key("last_updated").value(row.last_updated);
+        out.key("similarity").value(row.similarity);
+        out.key("title").value(row.title);
+        out.key("upload_date").value(row.upload_date);
+        out.endObject();
+    }
+    out.endArray();
+    return out.take();
+}
+
+std::string usersDom(const std::vector<UserRow>& rows) {
+    nlohmann::json users_list = nlohmann::json::array();
+    for (const UserRow& row : rows) {
+        nlohmann::json user_data;
+        user_data["id"] = row.id;
+        user_data["username"] = optionalJson(row.username);
+        user_data["contributions_count"] = row.contributions;
+        user_data["rank"] = row.rank;
+        users_list.push_back(user_data);
+    }
+    return users_list.dump();
+}
+
+std::string usersWriter(const std::vector<UserRow>& rows) {
+    JsonWriter out(2 + rows.size() * 96);
+    out.beginArray();
+    for (const UserRow& row : rows) {
+        out.beginObject();
+        out.key("contributions_count").value(row.contributions);
+        out.key("id").value(row.id);
+        out.key("rank").value(row.rank);
+        out.key("username").value(row.username);
+        out.endObject();
+    }
+    out.endArray();
+    return out.take();
+}
+
+// Times render and reports heap allocations and body size for one response
+template <typename F>
+void runRender(bench::Runner& runner, const std::string& name, size_t rows, F render) {
+    std::string body = render();
+    uint64_t before = allocations.load(std::memory_order_relaxed);
+    body = render();
+    uint64_t per_response = allocations.load(std::memory_order_relaxed) - before;
+
+    runner.run(name, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::string out = render();
+            bench::doNotOptimize(out);
+        }
+    }, static_cast<double>(body.size()), static_cast<double>(rows));
+    runner.counter("allocs_per_response", static_cast<double>(per_response));
+    runner.counter("body_bytes", static_cast<double>(body.size()));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::Runner runner(argc, argv);
+    size_t rows = 10000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--rows=", 0) == 0) {
+            rows = std::stoul(arg.substr(7));
+        }
+    }
+
+    const std::vector<SimilarRow> similar = makeSimilarRows(rows);
+    const std::string suffix = "/" + std::to_string(rows);
+    runRender(runner, "similar_by_vector/dom_dump" + suffix, rows, [&]() { return similarDom(similar); });
+    runRender(runner, "similar_by_vector/json_writer" + suffix, rows, [&]() { return similarWriter(similar); });
+
+    const std::vector<UserRow> users = makeUserRows(rows);
+    runRender(runner, "contributions/dom_dump" + suffix, rows, [&]() { return usersDom(users); });
+    runRender(runner, "contributions/json_writer" + suffix, rows, [&]() { return usersWriter(users); });
+
+    // Same bytes, except doubles may print a digit shorter than dump()'s
+    if (nlohmann::json::parse(similarDom(similar)) != nlohmann::json::parse(similarWriter(similar)) ||
+        usersDom(users) != usersWriter(users)) {
+        std::fprintf(stderr, "JsonWriter output differs from nlohmann::json::dump\n");
+        return 1;
+    }
+    return runner.finish();
+}
@@ -0,0 +1,130 @@
+// Encode/decode throughput of the pgvector codec against the original
+// stringstream-based formatVectorForPgvector implementation.
+//
+//   ./build/vector-codec-bench [--json] [--filter=SUBSTR]
+
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench_harness.h"
+#include "config.h"
+#include "vector_codec.h"
+
+namespace {
+
+std::vector<float> makeEmbedding(uint32_t seed) {
+    // Unit-length vectors like all-MiniLM-L6-v2 output
+    std::mt19937 gen(seed);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> v(EMBEDDING_DIM);
+    double norm = 0;
+    for (float& f : v) {
+        f = dist(gen);
+        norm += f * f;
+    }
+    for (float& f : v) {
+        f = static_cast<float>(f / std::sqrt(norm));
+    }
+    return v;
+}
+
+// Original helpers.cpp implementation, kept here as the encode baseline
+std::string formatWithStringstream(const std::vector<float>& vec) {
+    std::stringstream ss;
+    ss << "[";
+    for (size_t i = 0; i < vec.size(); ++i) {
+        ss << std::fixed << std::setprecision(8) << vec[i];
+        if (i < vec.size() - 1) {
+            ss << ",";
+        }
+    }
+    ss << "]";
+    return ss.str();
+}
+
+// Baseline parser in the style of the original helpers
+std::vector<float> parseWithStringstream(const std::string& text) {
+    std::vector<float> out;
+    std::stringstream ss(text.substr(1, text.size() - 2));
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        out.push_back(std::stof(item));
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bench::Runner runner(argc, argv);
+    const std::vector<float> embedding = makeEmbedding(42);
+    const double raw_bytes = EMBEDDING_DIM * sizeof(float);
+
+    const std::string legacy_text = formatWithStringstream(embedding);
+    const std::string codec_text = encodePgvector(embedding);
+
+    runner.run("encode/stringstream_fixed8", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::string s = formatWithStringstream(embedding);
+            bench::doNotOptimize(s);
+        }
+    }, raw_bytes);
+    runner.counter("text_bytes", static_cast<double>(legacy_text.size()));
+
+    runner.run("encode/encodePgvector_reused_buffer", [&](uint64_t n) {
+        std::string buffer;
+        for (uint64_t i = 0; i < n; ++i) {
+            encodePgvector(embedding.data(), embedding.size(), buffer);
+            bench::doNotOptimize(buffer);
+        }
+    }, raw_bytes);
+    runner.counter("text_bytes", static_cast<double>(codec_text.size()));
+
+    runner.run("encode/encodePgvectorBinary", [&](uint64_t n) {
+        std::string buffer;
+        for (uint64_t i = 0; i < n; ++i) {
+            encodePgvectorBinary(embedding.data(), embedding.size(), buffer);
+            bench::doNotOptimize(buffer);
+        }
+    }, raw_bytes);
+    runner.counter("wire_bytes", 4 + raw_bytes);
+
+    runner.run("decode/stringstream_stof", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            std::vector<float> v = parseWithStringstream(codec_text);
+            bench::doNotOptimize(v);
+        }
+    }, raw_bytes);
+
+    runner.run("decode/decodePgvector_reused_buffer", [&](uint64_t n) {
+        std::vector<float> v;
+        v.reserve(EMBEDDING_DIM);
+        for (uint64_t i = 0; i < n; ++i) {
+            decodePgvector(codec_text, v);
+            bench::doNotOptimize(v);
+        }
+    }, raw_bytes);
+
+    std::string wire;
+    encodePgvectorBinary(embedding.data(), embedding.size(), wire);
+    runner.run("decode/decodePgvectorBinary", [&](uint64_t n) {
+        std::vector<float> v;
+        v.reserve(EMBEDDING_DIM);
+        for (uint64_t i = 0; i < n; ++i) {
+            decodePgvectorBinary(reinterpret_cast<const unsigned char*>(wire.data()), wire.size(), v);
+            bench::doNotOptimize(v);
+        }
+    }, raw_bytes);
+
+    // Round-trip check: the shortest representation must decode to identical floats
+    std::vector<float> decoded;
+    if (!decodePgvector(codec_text, decoded) || decoded != embedding) {
+        std::cerr << "Round-trip mismatch in decodePgvector" << std::endl;
+        return 1;
+    }
+    return runner.finish();
+}
@@ -1,6 +1,7 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 #include <iostream>
+#include <cstdint>
 // Database connection details - matching docker-compose.yml
 
 const std::string DB_HOST = "postgres";
@@ -9,4 +10,105 @@ const std::string DB_PASS = "testpass";
 const unsigned int DB_PORT = 5432;
 const std::string DB_NAME = "youtube_topics";
 
+// Dimension of videos.vector_embedding (all-MiniLM-L6-v2)
+const unsigned int EMBEDDING_DIM = 384;
+// Idle decode buffers kept for POST /videos/:id/embedding bodies; more are allocated under load
+const size_t EMBEDDING_BUFFER_POOL_SIZE = 64;
+
+// Connection pool sizing - should cover Crow workers plus background tasks
+const unsigned int DB_POOL_SIZE = 16;
+const unsigned int DB_POOL_WAIT_TIMEOUT_MS = 2000;
+// Connections idle at least this long get a SELECT 1 before reuse; ones the server dropped are reopened
+const unsigned int DB_POOL_VALIDATE_IDLE_MS = 5000;
+
+// Executor for *Async database calls - tasks beyond the queue capacity are rejected with 503
+const unsigned int EXECUTOR_THREADS = 8;
+const unsigned int EXECUTOR_QUEUE_CAPACITY = 1024;
+
+// Per-video topic tally cache - memory budget is split evenly across shards
+const size_t TALLY_CACHE_BYTES = 64 * 1024 * 1024;
+const size_t TALLY_CACHE_SHARDS = 16;
+
+// Write-behind votes: POST /videos/:id/topics answers 202 once the vote is in a local fsync'd log
+// and the in-memory state, and a background writer upserts votes into video_topics in batches.
+// Off: every vote commits its own transaction before the response.
+const bool VOTE_WRITE_BEHIND = false;
+// Relative paths resolve against the working directory (cpp_backend/ in the container)
+const std::string VOTE_LOG_DIR = "data/votes";
+const uint64_t VOTE_LOG_SEGMENT_BYTES = 64ull << 20;
+// Votes per batch written to Postgres, and how long the writer waits for a batch to fill
+const size_t VOTE_WRITE_BATCH = 1000;
+const unsigned int VOTE_WRITE_LINGER_MS = 10;
+// Accepted votes not yet in Postgres beyond which new votes get 503
+const size_t VOTE_WRITE_MAX_PENDING = 100000;
+
+// Runtime log level (trace, debug, info, warn, error, off); the LOG_LEVEL environment variable
+// overrides it. Per-request lines are debug, sampled one in LOG_REQUEST_SAMPLE_EVERY.
+const std::string LOG_LEVEL = "info";
+const unsigned int LOG_REQUEST_SAMPLE_EVERY = 1;
+// Records buffered per logging thread before new ones are dropped, and how often they are flushed
+const size_t LOG_RING_CAPACITY = 4096;
+const unsigned int LOG_FLUSH_INTERVAL_MS = 50;
+
+// GET /metrics latency histograms are striped this many ways so concurrent threads record
+// into separate cache lines; scrapes merge the stripes
+const size_t METRICS_HISTOGRAM_STRIPES = 16;
+
+// Upper bound on video IDs accepted by POST /topics/batch (one feed/search page)
+const size_t MAX_BATCH_VIDEO_IDS = 100;
+
+// GET /users/contributions - default and largest accepted ?limit= (one leaderboard page)
+const unsigned int CONTRIBUTIONS_DEFAULT_LIMIT = 100;
+const unsigned int MAX_CONTRIBUTIONS_LIMIT = 1000;
+// Rows per batch when loading the leaderboard at startup
+const unsigned int LEADERBOARD_LOAD_BATCH = 50000;
+
+// GET /videos/:id/similar (topic overlap) - default and largest accepted ?limit=
+const unsigned int SIMILAR_VIDEOS_DEFAULT_LIMIT = 20;
+const unsigned int MAX_SIMILAR_VIDEOS_LIMIT = 100;
+// Topic-overlap queries whose topics tag at least this many videos in total are split across executor threads
+const uint64_t TOPIC_INDEX_PARALLEL_MIN_IDS = 1 << 16;
+// Rows per batch when loading the topic index at startup
+const unsigned int TOPIC_INDEX_LOAD_BATCH = 50000;
+
+// GET /videos/:id/similar_hybrid - default weights of the topic-overlap and embedding scores, and
+// candidates fetched from each source per requested result
+const double HYBRID_TOPIC_WEIGHT = 0.5;
+const double HYBRID_VECTOR_WEIGHT = 0.5;
+const unsigned int HYBRID_CANDIDATE_FACTOR = 4;
+
+// GET /videos/:id/similar_by_vector - largest accepted ?limit= and ?probes=
+const unsigned int MAX_SIMILAR_BY_VECTOR_LIMIT = 100;
+const unsigned int IVFFLAT_MAX_PROBES = 1000;
+
+// In-process HNSW index for vector similarity (links per node, build and default search beam width)
+const size_t HNSW_M = 16;
+const size_t HNSW_EF_CONSTRUCTION = 200;
+const size_t HNSW_EF_SEARCH = 64;
+const size_t HNSW_MAX_EF = 1000;
+// With float32 vectors in the embedding snapshot, fetch limit * factor candidates and re-rank them exactly
+const size_t HNSW_RERANK_FACTOR = 4;
+// Rows per batch when loading embeddings into the index at startup
+const unsigned int VECTOR_INDEX_LOAD_BATCH = 5000;
+// On-disk int8 (+ float32) embedding snapshot the index is rebuilt from at startup; empty disables it.
+// Relative paths resolve against the working directory (cpp_backend/ in the container).
+const std::string EMBEDDING_SNAPSHOT_PATH = "data/embeddings.snap";
+const bool EMBEDDING_SNAPSHOT_KEEP_FLOAT = true;
+// Startup catch-up re-reads this many embedding versions below the snapshot's newest, covering
+// writes that committed out of version order
+const uint64_t EMBEDDING_CATCHUP_OVERLAP = 10000;
+// Compact once superseded records outnumber live ones and at least this many exist
+const size_t EMBEDDING_SNAPSHOT_MIN_DEAD = 4096;
+// Shards of the in-memory video title catalog used to render index results
+const size_t VIDEO_CATALOG_SHARDS = 16;
+// In-memory public id -> BIGINT surrogate key caches for videos and users (entries, not bytes)
+const size_t VIDEO_KEY_CACHE_ENTRIES = 1 << 20;
+const size_t USER_KEY_CACHE_ENTRIES = 1 << 18;
+const size_t KEY_CACHE_SHARDS = 16;
+// Change counters behind the ETags of GET /videos/:id and /videos/:id/topics; videos share
+// slots when there are more of them, which only costs the odd extra revalidation
+const size_t VIDEO_VERSION_SLOTS = 1 << 20;
+// Clients may keep those responses but must revalidate them (If-None-Match) before each reuse
+const std::string VIDEO_CACHE_CONTROL = "no-cache";
+
 #endif // CONFIG_H
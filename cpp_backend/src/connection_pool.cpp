@@ -0,0 +1,151 @@
+#include "connection_pool.h"
+#include "logger.h"
+#include <utility>
+
+PooledConnection::PooledConnection(ConnectionPool* pool, std::unique_ptr<pqxx::connection> conn)
+    : pool(pool), conn(std::move(conn)) {}
+
+PooledConnection::PooledConnection(PooledConnection&& other) noexcept
+    : pool(other.pool), conn(std::move(other.conn)) {
+    other.pool = nullptr;
+}
+
+PooledConnection::~PooledConnection() {
+    if (pool && conn) {
+        pool->release(std::move(conn));
+    }
+}
+
+ConnectionPool::ConnectionPool(std::string conn_str, size_t size,
+                               std::chrono::milliseconds wait_timeout,
+                               std::chrono::milliseconds validate_after, Initializer init)
+    : conn_str(std::move(conn_str)), capacity(size == 0 ? 1 : size),
+      wait_timeout(wait_timeout), validate_after(validate_after), init(std::move(init)) {
+    idle.reserve(capacity);
+    for (size_t i = 0; i < capacity; ++i) {
+        idle.push_back({open(), std::chrono::steady_clock::now()});
+    }
+}
+
+std::unique_ptr<pqxx::connection> ConnectionPool::open() {
+    std::unique_ptr<pqxx::connection> conn;
+    try {
+        conn = std::make_unique<pqxx::connection>(conn_str);
+    } catch (const pqxx::broken_connection &e) {
+        std::string error_msg = "Failed to connect to PostgreSQL: ";
+        error_msg += e.what();
+        throw std::runtime_error(error_msg);
+    }
+    if (init) {
+        init(*conn);
+    }
+    return conn;
+}
+
+bool ConnectionPool::ping(pqxx::connection& conn) {
+    try {
+        pqxx::nontransaction txn(conn);
+        txn.exec("SELECT 1");
+        return true;
+    } catch (const pqxx::failure& e) {
+        LOG_WARN("Idle database connection failed its check: " << e.what());
+        return false;
+    }
+}
+
+PooledConnection ConnectionPool::acquire() {
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<pqxx::connection> conn;
+    std::chrono::steady_clock::time_point idle_since;
+    bool reopen = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (idle.empty() && missing == 0) {
+            waits.fetch_add(1, std::memory_order_relaxed);
+            if (!available.wait_for(lock, wait_timeout, [this] { return !idle.empty() || missing > 0; })) {
+                timeouts.fetch_add(1, std::memory_order_relaxed);
+                throw PoolExhausted("Timed out waiting for a database connection.");
+            }
+        }
+        if (!idle.empty()) {
+            conn = std::move(idle.back().conn);
+            idle_since = idle.back().since;
+            idle.pop_back();
+        } else {
+            --missing;
+            reopen = true;
+        }
+    }
+
+    uint64_t waited_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    total_wait_us.fetch_add(waited_us, std::memory_order_relaxed);
+    uint64_t prev_max = max_wait_us.load(std::memory_order_relaxed);
+    while (waited_us > prev_max && !max_wait_us.compare_exchange_weak(prev_max, waited_us, std::memory_order_relaxed)) {
+    }
+
+    // is_open() only reflects what libpq last saw, so a connection the server closed while
+    // it sat idle still passes it; after validate_after idle, ping it before handing it out.
+    if (!reopen) {
+        bool usable = conn->is_open();
+        if (usable && std::chrono::steady_clock::now() - idle_since >= validate_after) {
+            validations.fetch_add(1, std::memory_order_relaxed);
+            usable = ping(*conn);
+        }
+        if (!usable) {
+            conn.reset();
+            reopen = true;
+        }
+    }
+    if (reopen) {
+        try {
+            conn = open();
+            reconnects.fetch_add(1, std::memory_order_relaxed);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++missing;
+            available.notify_one();
+            throw;
+        }
+    }
+
+    acquisitions.fetch_add(1, std::memory_order_relaxed);
+    return PooledConnection(this, std::move(conn));
+}
+
+void ConnectionPool::release(std::unique_ptr<pqxx::connection> conn) {
+    // A connection broken mid-query (pqxx::broken_connection) reports closed;
+    // drop it and let the next acquire reconnect that slot.
+    bool healthy = conn->is_open();
+    if (!healthy) {
+        LOG_WARN("Dropping broken database connection from pool.");
+        conn.reset();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (healthy) {
+            idle.push_back({std::move(conn), std::chrono::steady_clock::now()});
+        } else {
+            ++missing;
+        }
+    }
+    available.notify_one();
+}
+
+PoolStats ConnectionPool::stats() const {
+    PoolStats s;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        s.size = capacity;
+        s.idle = idle.size();
+        s.in_use = capacity - idle.size() - missing;
+    }
+    s.acquisitions = acquisitions.load(std::memory_order_relaxed);
+    s.waits = waits.load(std::memory_order_relaxed);
+    s.timeouts = timeouts.load(std::memory_order_relaxed);
+    s.reconnects = reconnects.load(std::memory_order_relaxed);
+    s.validations = validations.load(std::memory_order_relaxed);
+    s.total_wait_us = total_wait_us.load(std::memory_order_relaxed);
+    s.max_wait_us = max_wait_us.load(std::memory_order_relaxed);
+    return s;
+}
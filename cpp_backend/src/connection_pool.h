@@ -0,0 +1,106 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <pqxx/pqxx>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "errors.h"
+
+class ConnectionPool;
+
+// Thrown when no connection becomes available within the pool's wait timeout.
+class PoolExhausted : public ServiceUnavailable {
+public:
+  using ServiceUnavailable::ServiceUnavailable;
+};
+
+struct PoolStats {
+  size_t size;
+  size_t in_use;
+  size_t idle;
+  uint64_t acquisitions;
+  uint64_t waits;        // acquisitions that had to block for a connection
+  uint64_t timeouts;
+  uint64_t reconnects;
+  uint64_t validations;  // idle connections pinged before being handed out
+  uint64_t total_wait_us;
+  uint64_t max_wait_us;
+};
+
+// RAII handle for a checked-out connection. Returns it to the pool on destruction.
+class PooledConnection {
+public:
+  PooledConnection(ConnectionPool* pool, std::unique_ptr<pqxx::connection> conn);
+  PooledConnection(PooledConnection&& other) noexcept;
+  PooledConnection& operator=(PooledConnection&&) = delete;
+  PooledConnection(const PooledConnection&) = delete;
+  PooledConnection& operator=(const PooledConnection&) = delete;
+  ~PooledConnection();
+
+  pqxx::connection& operator*() { return *conn; }
+  pqxx::connection* operator->() { return conn.get(); }
+
+private:
+  ConnectionPool* pool;
+  std::unique_ptr<pqxx::connection> conn;
+};
+
+// Bounded, thread-safe pool of PostgreSQL connections. Every connection it
+// opens is passed through the initializer (used to prepare statements).
+// A connection idle for longer than validate_after is pinged before it is handed
+// out, so one the server dropped meanwhile (restart, idle timeout, failover) is
+// reopened instead of failing the caller's first query.
+class ConnectionPool {
+public:
+  using Initializer = std::function<void(pqxx::connection&)>;
+
+  ConnectionPool(std::string conn_str, size_t size,
+                 std::chrono::milliseconds wait_timeout,
+                 std::chrono::milliseconds validate_after, Initializer init);
+
+  // Check out a connection, blocking up to the wait timeout.
+  PooledConnection acquire();
+
+  PoolStats stats() const;
+
+private:
+  friend class PooledConnection;
+
+  struct IdleConnection {
+    std::unique_ptr<pqxx::connection> conn;
+    std::chrono::steady_clock::time_point since;
+  };
+
+  std::unique_ptr<pqxx::connection> open();
+  // Round trip to the server; false if the connection no longer works
+  static bool ping(pqxx::connection& conn);
+  void release(std::unique_ptr<pqxx::connection> conn);
+
+  const std::string conn_str;
+  const size_t capacity;
+  const std::chrono::milliseconds wait_timeout;
+  const std::chrono::milliseconds validate_after;
+  Initializer init;
+
+  mutable std::mutex mutex;
+  std::condition_variable available;
+  std::vector<IdleConnection> idle;
+  size_t missing = 0; // slots whose connection was dropped and must be reopened
+
+  std::atomic<uint64_t> acquisitions{0};
+  std::atomic<uint64_t> waits{0};
+  std::atomic<uint64_t> timeouts{0};
+  std::atomic<uint64_t> reconnects{0};
+  std::atomic<uint64_t> validations{0};
+  std::atomic<uint64_t> total_wait_us{0};
+  std::atomic<uint64_t> max_wait_us{0};
+};
+
+#endif // CONNECTION_POOL_H
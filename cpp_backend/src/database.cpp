@@ -1,46 +1,133 @@
 #include "database.h"
 #include "config.h"
 #include "helpers.h" // Added for formatVector
-#include <iostream>
+#include "vector_codec.h"
+#include "vector_math.h"
+#include "logger.h"
+#include "metrics.h"
+#include "json_writer.h"
 #include <string>
 #include <memory>
 #include <stdexcept>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+VideoInfo videoInfoFromRow(const pqxx::row& row) {
+    VideoInfo info;
+    if (!row["title"].is_null()) {
+        info.title = row["title"].as<std::string>();
+    }
+    if (!row["upload_date"].is_null()) {
+        info.upload_date = row["upload_date"].as<std::string>();
+    }
+    if (!row["last_updated"].is_null()) {
+        info.last_updated = row["last_updated"].as<std::string>();
+    }
+    return info;
+}
+
+nlohmann::json optionalJson(const std::optional<std::string>& value) {
+    return value ? nlohmann::json(*value) : nlohmann::json(nullptr);
+}
+
+nlohmann::json optionalJson(const std::optional<int>& value) {
+    return value ? nlohmann::json(*value) : nlohmann::json(nullptr);
+}
+
+// txn.exec_prepared, timed per statement for /metrics; name must be a string literal
+template <typename... Args>
+pqxx::result execPrepared(pqxx::transaction_base& txn, const char* name, Args&&... args) {
+    StatementMetrics& metrics = Metrics::instance().statement(name);
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        pqxx::result r = txn.exec_prepared(name, std::forward<Args>(args)...);
+        metrics.latency.record(start);
+        return r;
+    } catch (...) {
+        metrics.latency.record(start);
+        metrics.errors.fetch_add(1, std::memory_order_relaxed);
+        throw;
+    }
+}
+
+// Typical serialized sizes of one list element, to reserve response bodies in one go
+constexpr size_t TOPIC_JSON_BYTES = 64;
+constexpr size_t SIMILAR_VIDEO_JSON_BYTES = 192;
+constexpr size_t USER_JSON_BYTES = 96;
+
+// Keeps concurrent tally cache loads of a video from racing with a vote write
+struct TallyWriteGuard {
+    TallyCache& cache;
+    const std::string& videoId;
+    TallyWriteGuard(TallyCache& cache, const std::string& videoId) : cache(cache), videoId(videoId) {
+        cache.beginWrite(videoId);
+    }
+    ~TallyWriteGuard() { cache.endWrite(videoId); }
+};
+
+} // namespace
 
 void Database::connect() {
-    std::string conn_str = "host=" + DB_HOST + " port=" + std::to_string(DB_PORT) + " user=" + DB_USER + " password=" + DB_PASS + " dbname=" + DB_NAME;
+    pool = std::make_unique<ConnectionPool>(
+        buildConnectionString(), DB_POOL_SIZE,
+        std::chrono::milliseconds(DB_POOL_WAIT_TIMEOUT_MS),
+        std::chrono::milliseconds(DB_POOL_VALIDATE_IDLE_MS),
+        [](pqxx::connection& c) { prepareStatements(c); });
+    LOG_INFO("Connected to PostgreSQL server.");
+}
+
+void Database::createTables() {
+    std::unique_ptr<pqxx::connection> bootstrap;
     try {
-        conn = std::make_unique<pqxx::connection>(conn_str);
-        std::cout << "Connected to PostgreSQL server." << std::endl;
+        bootstrap = std::make_unique<pqxx::connection>(buildConnectionString());
     } catch (const pqxx::broken_connection &e) {
         std::string error_msg = "Failed to connect to PostgreSQL: ";
         error_msg += e.what();
         throw std::runtime_error(error_msg);
     }
-}
 
-void Database::createTables() {
     try {
-        pqxx::work txn(getConnection());
+        pqxx::work txn(*bootstrap);
 
         // Enable the vector extension
         txn.exec("CREATE EXTENSION IF NOT EXISTS vector;");
 
-        // Drop tables if they exist to ensure schema updates during development
-        txn.exec("DROP TABLE IF EXISTS video_topics CASCADE;");
-        txn.exec("DROP TABLE IF EXISTS videos CASCADE;");
-        txn.exec("DROP TABLE IF EXISTS topics CASCADE;");
-        txn.exec("DROP TABLE IF EXISTS users CASCADE;");
+        // Drop tables if they exist to ensure schema updates during development. Not with
+        // write-behind votes: the vote log replayed at startup needs the videos, users and
+        // topics its records name, so the schema (and data) is kept across restarts.
+        if (!VOTE_WRITE_BEHIND) {
+            txn.exec("DROP TABLE IF EXISTS video_topic_scores CASCADE;");
+            txn.exec("DROP TABLE IF EXISTS video_topics CASCADE;");
+            txn.exec("DROP TABLE IF EXISTS videos CASCADE;");
+            txn.exec("DROP TABLE IF EXISTS topics CASCADE;");
+            txn.exec("DROP TABLE IF EXISTS user_topic_counts CASCADE;");
+            txn.exec("DROP TABLE IF EXISTS user_stats CASCADE;");
+            txn.exec("DROP TABLE IF EXISTS users CASCADE;");
+            // Restarting the sequence makes an embedding snapshot from before the drop look
+            // newer than the database, so the loader discards it
+            txn.exec("DROP SEQUENCE IF EXISTS video_embedding_version_seq;");
+        }
 
+        // Vote tables reference videos and users by a BIGINT surrogate key: an 8-byte key
+        // makes their rows and indexes smaller and joins cheaper than the VARCHAR public id
         std::string create_videos_sql = R"(
             CREATE TABLE IF NOT EXISTS videos (
-            id VARCHAR(255) PRIMARY KEY,
+            video_key BIGINT GENERATED ALWAYS AS IDENTITY PRIMARY KEY,
+            id VARCHAR(255) UNIQUE NOT NULL,
             title VARCHAR(255),
             upload_date VARCHAR(255),
             last_updated TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-            vector_embedding VECTOR(384)
+            vector_embedding VECTOR(384),
+            embedding_version BIGINT
             )
         )";
         txn.exec(create_videos_sql);
+        // Every embedding write takes the next version, so readers can catch up from a known point
+        txn.exec("CREATE SEQUENCE IF NOT EXISTS video_embedding_version_seq;");
+        txn.exec("CREATE INDEX IF NOT EXISTS videos_embedding_version_idx ON videos (embedding_version);");
 
         std::string create_topics_sql = R"(
             CREATE TABLE IF NOT EXISTS topics (
@@ -53,21 +140,68 @@ void Database::createTables() {
 
         std::string create_video_topics_sql = R"(
             CREATE TABLE IF NOT EXISTS video_topics (
-            video_id VARCHAR(255) NOT NULL,
+            video_key BIGINT NOT NULL,
             topic_id INT NOT NULL,
-            user_id VARCHAR(255) NOT NULL,
+            user_key BIGINT NOT NULL,
             vote INT NOT NULL,
             created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-            PRIMARY KEY (video_id, topic_id, user_id),
-            FOREIGN KEY (video_id) REFERENCES videos(id),
+            PRIMARY KEY (video_key, topic_id, user_key),
+            FOREIGN KEY (video_key) REFERENCES videos(video_key),
             FOREIGN KEY (topic_id) REFERENCES topics(id)
             )
         )";
         txn.exec(create_video_topics_sql);
 
+        // Denormalized per-(video, topic) tallies, kept exact by a trigger on video_topics
+        // in the same transaction as the vote write
+        std::string create_video_topic_scores_sql = R"(
+            CREATE TABLE IF NOT EXISTS video_topic_scores (
+            video_key BIGINT NOT NULL,
+            topic_id INT NOT NULL,
+            total_votes INT NOT NULL DEFAULT 0,
+            voter_count INT NOT NULL DEFAULT 0,
+            PRIMARY KEY (video_key, topic_id),
+            FOREIGN KEY (video_key) REFERENCES videos(video_key),
+            FOREIGN KEY (topic_id) REFERENCES topics(id)
+            )
+        )";
+        txn.exec(create_video_topic_scores_sql);
+        txn.exec("CREATE INDEX IF NOT EXISTS video_topic_scores_topic_idx ON video_topic_scores (topic_id, video_key);");
+
+        std::string create_scores_trigger_fn_sql = R"(
+            CREATE OR REPLACE FUNCTION maintain_video_topic_scores() RETURNS trigger AS $$
+            BEGIN
+                IF TG_OP = 'UPDATE' AND NEW.video_key = OLD.video_key AND NEW.topic_id = OLD.topic_id THEN
+                    UPDATE video_topic_scores SET total_votes = total_votes + NEW.vote - OLD.vote
+                    WHERE video_key = NEW.video_key AND topic_id = NEW.topic_id;
+                    RETURN NULL;
+                END IF;
+                IF TG_OP IN ('DELETE', 'UPDATE') THEN
+                    UPDATE video_topic_scores SET total_votes = total_votes - OLD.vote, voter_count = voter_count - 1
+                    WHERE video_key = OLD.video_key AND topic_id = OLD.topic_id;
+                    DELETE FROM video_topic_scores
+                    WHERE video_key = OLD.video_key AND topic_id = OLD.topic_id AND voter_count <= 0;
+                END IF;
+                IF TG_OP IN ('INSERT', 'UPDATE') THEN
+                    INSERT INTO video_topic_scores (video_key, topic_id, total_votes, voter_count)
+                    VALUES (NEW.video_key, NEW.topic_id, NEW.vote, 1)
+                    ON CONFLICT (video_key, topic_id) DO UPDATE
+                    SET total_votes = video_topic_scores.total_votes + EXCLUDED.total_votes,
+                        voter_count = video_topic_scores.voter_count + 1;
+                END IF;
+                RETURN NULL;
+            END;
+            $$ LANGUAGE plpgsql
+        )";
+        txn.exec(create_scores_trigger_fn_sql);
+        txn.exec("DROP TRIGGER IF EXISTS video_topics_scores_trg ON video_topics;");
+        txn.exec("CREATE TRIGGER video_topics_scores_trg AFTER INSERT OR UPDATE OR DELETE ON video_topics "
+                 "FOR EACH ROW EXECUTE PROCEDURE maintain_video_topic_scores();");
+
         std::string create_users_sql = R"(
             CREATE TABLE IF NOT EXISTS users (
-            id VARCHAR(255) PRIMARY KEY,
+            user_key BIGINT GENERATED ALWAYS AS IDENTITY PRIMARY KEY,
+            id VARCHAR(255) UNIQUE NOT NULL,
             username VARCHAR(255) UNIQUE,
             reputation INT DEFAULT 0,
             created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
@@ -75,129 +209,905 @@ void Database::createTables() {
         )";
         txn.exec(create_users_sql);
 
+        // Per-user summaries of video_topics, kept exact by a trigger in the same transaction
+        // as the vote write, so user stats never scan a user's votes
+        std::string create_user_stats_sql = R"(
+            CREATE TABLE IF NOT EXISTS user_stats (
+            user_key BIGINT PRIMARY KEY,
+            submissions_count INT NOT NULL DEFAULT 0,
+            last_submission_at TIMESTAMP,
+            FOREIGN KEY (user_key) REFERENCES users(user_key)
+            )
+        )";
+        txn.exec(create_user_stats_sql);
+
+        std::string create_user_topic_counts_sql = R"(
+            CREATE TABLE IF NOT EXISTS user_topic_counts (
+            user_key BIGINT NOT NULL,
+            topic_id INT NOT NULL,
+            submissions_count INT NOT NULL DEFAULT 0,
+            PRIMARY KEY (user_key, topic_id),
+            FOREIGN KEY (user_key) REFERENCES users(user_key),
+            FOREIGN KEY (topic_id) REFERENCES topics(id)
+            )
+        )";
+        txn.exec(create_user_topic_counts_sql);
+        // A user's most frequent topic is the first entry of this index
+        txn.exec("CREATE INDEX IF NOT EXISTS user_topic_counts_top_idx "
+                 "ON user_topic_counts (user_key, submissions_count DESC, topic_id);");
+
+        // last_submission_at is the latest vote write; removing that vote doesn't move it back
+        std::string create_user_stats_trigger_fn_sql = R"(
+            CREATE OR REPLACE FUNCTION maintain_user_stats() RETURNS trigger AS $$
+            BEGIN
+                IF TG_OP = 'UPDATE' AND NEW.user_key = OLD.user_key AND NEW.topic_id = OLD.topic_id THEN
+                    UPDATE user_stats SET last_submission_at = GREATEST(last_submission_at, NEW.created_at)
+                    WHERE user_key = NEW.user_key;
+                    RETURN NULL;
+                END IF;
+                IF TG_OP IN ('DELETE', 'UPDATE') THEN
+                    UPDATE user_stats SET submissions_count = submissions_count - 1
+                    WHERE user_key = OLD.user_key;
+                    UPDATE user_topic_counts SET submissions_count = submissions_count - 1
+                    WHERE user_key = OLD.user_key AND topic_id = OLD.topic_id;
+                    DELETE FROM user_topic_counts
+                    WHERE user_key = OLD.user_key AND topic_id = OLD.topic_id AND submissions_count <= 0;
+                END IF;
+                IF TG_OP IN ('INSERT', 'UPDATE') THEN
+                    INSERT INTO user_stats (user_key, submissions_count, last_submission_at)
+                    VALUES (NEW.user_key, 1, NEW.created_at)
+                    ON CONFLICT (user_key) DO UPDATE
+                    SET submissions_count = user_stats.submissions_count + 1,
+                        last_submission_at = GREATEST(user_stats.last_submission_at, EXCLUDED.last_submission_at);
+                    INSERT INTO user_topic_counts (user_key, topic_id, submissions_count)
+                    VALUES (NEW.user_key, NEW.topic_id, 1)
+                    ON CONFLICT (user_key, topic_id) DO UPDATE
+                    SET submissions_count = user_topic_counts.submissions_count + 1;
+                END IF;
+                RETURN NULL;
+            END;
+            $$ LANGUAGE plpgsql
+        )";
+        txn.exec(create_user_stats_trigger_fn_sql);
+        txn.exec("DROP TRIGGER IF EXISTS video_topics_user_stats_trg ON video_topics;");
+        txn.exec("CREATE TRIGGER video_topics_user_stats_trg AFTER INSERT OR UPDATE OR DELETE ON video_topics "
+                 "FOR EACH ROW EXECUTE PROCEDURE maintain_user_stats();");
+
         // Create vector index for efficient similarity search
         txn.exec("CREATE INDEX IF NOT EXISTS videos_vector_idx ON videos USING ivfflat (vector_embedding vector_cosine_ops);");
 
         txn.commit();
-        std::cout << "Database tables and indexes checked/created successfully." << std::endl;
+        LOG_INFO("Database tables and indexes checked/created successfully.");
     } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error creating tables: " << e.what() << std::endl;
+        LOG_ERROR("Error creating tables: " << e.what());
         throw;
     }
 }
 
-Database::Database() : thread_pool(4) {  // Initialize thread pool with 4 threads
-    connect();
+Database::Database()
+    : embeddingStore(EMBEDDING_SNAPSHOT_PATH.empty() ? nullptr
+                     : std::make_unique<EmbeddingStore>(EMBEDDING_SNAPSHOT_PATH, EMBEDDING_DIM,
+                                                        EMBEDDING_SNAPSHOT_KEEP_FLOAT)),
+      executor(EXECUTOR_THREADS, EXECUTOR_QUEUE_CAPACITY, RejectionPolicy::Reject),
+      tallyCache(TALLY_CACHE_BYTES, TALLY_CACHE_SHARDS),
+      topicIndex(executor),
+      videoCatalog(VIDEO_CATALOG_SHARDS),
+      videoKeys(VIDEO_KEY_CACHE_ENTRIES, KEY_CACHE_SHARDS),
+      userKeys(USER_KEY_CACHE_ENTRIES, KEY_CACHE_SHARDS),
+      videoVersions(VIDEO_VERSION_SLOTS),
+      vectorIndex(EMBEDDING_DIM, HNSW_M, HNSW_EF_CONSTRUCTION) {
+    // Tables must exist before the pool prepares statements on its connections
     createTables();
+    connect();
+    loadTopicDictionary();
+    if (VOTE_WRITE_BEHIND) {
+        // Replays the vote log before the in-memory indexes are loaded from Postgres
+        votePipeline = std::make_unique<VotePipeline>(
+            VOTE_LOG_DIR, VOTE_LOG_SEGMENT_BYTES, VOTE_WRITE_BATCH, std::chrono::milliseconds(VOTE_WRITE_LINGER_MS),
+            VOTE_WRITE_MAX_PENDING, tallyCache, [this](const std::vector<VoteRecord>& records) { writeVotes(records); });
+        votePipeline->start();
+    }
+    loadTopicIndex();
+    loadLeaderboard();
+    vectorIndexLoader = std::thread([this]() { loadVectorIndex(); });
+}
+
+void Database::loadTopicDictionary() {
+    try {
+        auto conn = getConnection();
+        pqxx::work txn(*conn);
+        pqxx::result r = execPrepared(txn, "get_all_topics");
+        for (const auto& row : r) {
+            topics.insert(row["id"].as<int>(), row["name"].as<std::string>());
+        }
+        LOG_INFO("Loaded " << topics.size() << " topics into the topic dictionary.");
+    } catch (const pqxx::sql_error &e) {
+        LOG_ERROR("Error loading topic dictionary: " << e.what());
+        throw;
+    }
+}
+
+void Database::loadTopicIndex() {
+    auto start = std::chrono::steady_clock::now();
+    int64_t last_key = 0;
+    int last_topic = 0;
+    size_t loaded = 0;
+    try {
+        while (true) {
+            auto conn = getConnection();
+            pqxx::work txn(*conn);
+            pqxx::result r = execPrepared(txn, "load_topic_memberships", last_key, last_topic, TOPIC_INDEX_LOAD_BATCH);
+            std::string video_id;
+            for (const auto& row : r) {
+                int64_t key = row["video_key"].as<int64_t>();
+                video_id = row["video_id"].as<std::string>();
+                if (key != last_key) {
+                    // Videos with votes are the ones votes and tally reads will resolve
+                    videoKeys.put(video_id, key);
+                    last_key = key;
+                }
+                last_topic = row["topic_id"].as<int>();
+                topicIndex.applyVoters(video_id, last_topic, row["voter_count"].as<int>());
+                ++loaded;
+            }
+            if (r.size() < TOPIC_INDEX_LOAD_BATCH) {
+                break;
+            }
+        }
+    } catch (const pqxx::sql_error &e) {
+        LOG_ERROR("Error loading topic index: " << e.what());
+        throw;
+    }
+    LOG_INFO("Loaded " << loaded << " video topics into the topic index in "
+             << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s.");
+}
+
+void Database::loadLeaderboard() {
+    int64_t last_key = 0;
+    try {
+        while (true) {
+            auto conn = getConnection();
+            pqxx::work txn(*conn);
+            pqxx::result r = execPrepared(txn, "load_user_contributions", last_key, LEADERBOARD_LOAD_BATCH);
+            for (const auto& row : r) {
+                last_key = row["user_key"].as<int64_t>();
+                std::optional<std::string> username;
+                if (!row["username"].is_null()) {
+                    username = row["username"].as<std::string>();
+                }
+                leaderboard.put(row["id"].as<std::string>(), username, row["contributions_count"].as<int>());
+            }
+            if (r.size() < LEADERBOARD_LOAD_BATCH) {
+                break;
+            }
+        }
+    } catch (const pqxx::sql_error &e) {
+        LOG_ERROR("Error loading leaderboard: " << e.what());
+        throw;
+    }
+    LOG_INFO("Loaded " << leaderboard.size() << " users into the leaderboard.");
+}
+
+void Database::loadVectorIndex() {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t last_version = 0;
+    std::vector<float> embedding;
+    size_t caught_up = 0;
+    try {
+        if (embeddingStore && embeddingStore->open()) {
+            uint64_t db_version = getMaxEmbeddingVersion();
+            if (embeddingStore->maxVersion() > db_version) {
+                LOG_WARN("Embedding snapshot is ahead of the database (version " << embeddingStore->maxVersion()
+                         << " > " << db_version << "), discarding it.");
+                embeddingStore->clear();
+            }
+            uint64_t snapshot_version = embeddingStore->maxVersion();
+            last_version = snapshot_version > EMBEDDING_CATCHUP_OVERLAP ? snapshot_version - EMBEDDING_CATCHUP_OVERLAP : 0;
+        } else if (embeddingStore) {
+            LOG_WARN("Embedding snapshot unavailable, loading the index from Postgres only.");
+        }
+        const bool use_store = embeddingStore && embeddingStore->stats().open;
+
+        // Embeddings written since the snapshot (all of them without one), in version order
+        while (!shuttingDown.load()) {
+            pqxx::result r;
+            {
+                auto conn = getConnection();
+                pqxx::work txn(*conn);
+                r = execPrepared(txn, "load_video_embeddings", static_cast<int64_t>(last_version), VECTOR_INDEX_LOAD_BATCH);
+            }
+            for (const auto& row : r) {
+                std::string id = row["id"].as<std::string>();
+                last_version = static_cast<uint64_t>(row["embedding_version"].as<int64_t>());
+                const auto& field = row["vector_embedding"];
+                if (!decodePgvector(field.c_str(), field.size(), embedding) || embedding.size() != vectorIndex.dim()) {
+                    LOG_WARN("Skipping malformed embedding for video " << id);
+                    continue;
+                }
+                // Versions keep an embedding updateVideoEmbedding wrote meanwhile from being overwritten
+                if (use_store) {
+                    embeddingStore->append(id, last_version, embedding.data());
+                } else {
+                    vectorIndex.insert(id, embedding.data(), last_version);
+                }
+                videoCatalog.put(id, videoInfoFromRow(row), false);
+                ++caught_up;
+            }
+            if (r.size() < VECTOR_INDEX_LOAD_BATCH) {
+                break;
+            }
+        }
 
-    // Prepare statements
-    pqxx::connection& c = getConnection();
+        if (use_store && !shuttingDown.load()) {
+            embeddingStoreReady.store(true);
+            LOG_INFO("Embedding snapshot caught up with " << caught_up << " embeddings from Postgres in "
+                     << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s.");
+            embeddingStore->forEach([this](const std::string& label, uint64_t version, const int8_t* codes, float scale) {
+                if (!shuttingDown.load()) {
+                    vectorIndex.insertQuantized(label, codes, scale, version);
+                }
+            });
+        }
+    } catch (const std::exception &e) {
+        LOG_ERROR("Error loading vector index, similar_by_vector stays on Postgres: " << e.what());
+        return;
+    }
+    if (shuttingDown.load()) {
+        return;
+    }
+    vectorIndexReady.store(true);
+    LOG_INFO("Loaded " << vectorIndex.size() << " embeddings into the HNSW index in "
+             << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s.");
+}
+
+uint64_t Database::getMaxEmbeddingVersion() {
+    try {
+        auto conn = getConnection();
+        pqxx::work txn(*conn);
+        pqxx::result r = execPrepared(txn, "get_max_embedding_version");
+        return static_cast<uint64_t>(r[0][0].as<int64_t>());
+    } catch (const pqxx::sql_error &e) {
+        LOG_ERROR("Error in getMaxEmbeddingVersion: " << e.what());
+        throw;
+    }
+}
+
+int Database::resolveTopicId(const std::string& topicName) {
+    int topicId = topics.idForName(topicName);
+    if (topicId != 0) {
+        return topicId;
+    }
+    return insertTopic(topicName);
+}
+
+const std::string* Database::resolveTopicName(int topicId) {
+    const std::string* name = topics.nameForId(topicId);
+    if (name) {
+        return name;
+    }
+    // Topic created by another backend instance since startup
+    nlohmann::json topic = getTopicById(topicId);
+    if (topic.is_null()) {
+        return nullptr;
+    }
+    topics.insert(topicId, topic["name"].get<std::string>());
+    return topics.nameForId(topicId);
+}
+
+std::optional<int64_t> Database::resolveVideoKey(pqxx::transaction_base& txn, const std::string& videoId) {
+    int64_t key;
+    if (videoKeys.get(videoId, key)) {
+        return key;
+    }
+    pqxx::result r = execPrepared(txn, "get_video_key", videoId);
+    if (r.empty()) {
+        return std::nullopt;
+    }
+    key = r[0]["video_key"].as<int64_t>();
+    videoKeys.put(videoId, key);
+    return key;
+}
+
+int64_t Database::internUser(pqxx::nontransaction& txn, const std::string& userId) {
+    int64_t key;
+    if (userKeys.get(userId, key)) {
+        return key;
+    }
+    pqxx::result r = execPrepared(txn, "intern_user", userId);
+    if (r.empty()) {
+        // Already there, or inserted by a concurrent vote that has committed by now: the insert
+        // waits for it, and each nontransaction statement sees the latest committed rows
+        r = execPrepared(txn, "get_user_key", userId);
+    }
+    key = r[0]["user_key"].as<int64_t>();
+    userKeys.put(userId, key);
+    return key;
+}
+
+// Prepare statements - runs on every connection the pool opens
+void Database::prepareStatements(pqxx::connection& c) {
     c.prepare("get_video_by_id", "SELECT id, title, upload_date, last_updated FROM videos WHERE id = $1");
-    c.prepare("insert_video", "INSERT INTO videos (id, title) VALUES ($1, $2)");
-    c.prepare("insert_video_no_title", "INSERT INTO videos (id) VALUES ($1)");
+    c.prepare("insert_video", "INSERT INTO videos (id, title) VALUES ($1, $2) RETURNING video_key");
+    c.prepare("insert_video_no_title", "INSERT INTO videos (id) VALUES ($1) RETURNING video_key");
+    // Public id -> surrogate key on a key cache miss
+    c.prepare("get_video_key", "SELECT video_key FROM videos WHERE id = $1");
+    c.prepare("get_video_keys", "SELECT id, video_key FROM videos WHERE id = ANY($1::varchar[])");
+    // Returns no row for an existing user (no tuple or WAL write); get_user_key then reads the key
+    c.prepare("intern_user",
+        "INSERT INTO users (id) VALUES ($1) ON CONFLICT (id) DO NOTHING RETURNING user_key");
+    c.prepare("get_user_key", "SELECT user_key FROM users WHERE id = $1");
     c.prepare("get_topic_by_name", "SELECT id, name, created_at FROM topics WHERE name = $1");
-    c.prepare("insert_topic", "INSERT INTO topics (name) VALUES ($1) RETURNING id");
-    c.prepare("get_video_topic_vote", "SELECT video_id, topic_id, user_id, vote, created_at FROM video_topics WHERE video_id = $1 AND topic_id = $2 AND user_id = $3");
-    c.prepare("update_video_topic_vote", "UPDATE video_topics SET vote = $1, created_at = CURRENT_TIMESTAMP WHERE video_id = $2 AND topic_id = $3 AND user_id = $4");
-    c.prepare("insert_video_topic_vote", "INSERT INTO video_topics (video_id, topic_id, user_id, vote) VALUES ($1, $2, $3, $4)");
-    c.prepare("delete_video_topic_vote", "DELETE FROM video_topics WHERE video_id = $1 AND topic_id = $2 AND user_id = $3");
+    c.prepare("get_topic_by_id", "SELECT id, name, created_at FROM topics WHERE id = $1");
+    c.prepare("get_all_topics", "SELECT id, name FROM topics");
+    // Concurrent creators of the same name both succeed; the loser re-reads the winner's id
+    c.prepare("insert_topic", "INSERT INTO topics (name) VALUES ($1) ON CONFLICT (name) DO NOTHING RETURNING id");
+    // One vote in one statement: toggle/update/insert the vote row for already-resolved
+    // user, topic and video keys. Data-modifying CTEs all run against the same
+    // snapshot, so removed/written both decide off existing.
+    c.prepare("submit_vote",
+        "WITH existing AS ("
+        "  SELECT vote FROM video_topics "
+        "  WHERE video_key = $3 AND topic_id = $2 AND user_key = $1 FOR UPDATE"
+        "), removed AS ("
+        "  DELETE FROM video_topics "
+        "  WHERE video_key = $3 AND topic_id = $2 AND user_key = $1 "
+        "  AND EXISTS (SELECT 1 FROM existing WHERE vote = $4::int) "
+        "  RETURNING vote"
+        "), written AS ("
+        "  INSERT INTO video_topics (video_key, topic_id, user_key, vote) "
+        "  SELECT $3, $2, $1, $4::int "
+        "  WHERE NOT EXISTS (SELECT 1 FROM existing WHERE vote = $4::int) "
+        "  ON CONFLICT (video_key, topic_id, user_key) "
+        "  DO UPDATE SET vote = EXCLUDED.vote, created_at = CURRENT_TIMESTAMP "
+        "  RETURNING vote, (xmax = 0) AS inserted"
+        ") "
+        "SELECT (SELECT vote FROM existing) AS previous_vote, "
+        "  (SELECT vote FROM written) AS vote, "
+        "  CASE WHEN EXISTS (SELECT 1 FROM removed) THEN 'removed' "
+        "       WHEN EXISTS (SELECT 1 FROM written WHERE NOT inserted) THEN 'updated' "
+        "       ELSE 'recorded' END AS action");
+    // Write-behind votes: the video's key (no row if it doesn't exist) and the previous vote, in one read
+    c.prepare("get_vote_state",
+        "SELECT v.video_key, "
+        "  (SELECT t.vote FROM video_topics t JOIN users u ON u.user_key = t.user_key "
+        "   WHERE t.video_key = v.video_key AND t.topic_id = $2 AND u.id = $3) AS vote "
+        "FROM videos v WHERE v.id = $1");
+    // Batch write-back, one row per key, with public ids resolved to keys by the joins.
+    // Rows for videos or topics that no longer exist can't be written; they are skipped
+    // rather than failing the batch, and each statement returns how many it skipped.
+    c.prepare("write_votes_users",
+        "INSERT INTO users (id) SELECT DISTINCT u FROM unnest($1::varchar[]) AS u ON CONFLICT (id) DO NOTHING");
+    c.prepare("write_votes_upsert",
+        "WITH d AS ("
+        "  SELECT * FROM unnest($1::varchar[], $2::int[], $3::varchar[], $4::int[]) AS d(video_id, topic_id, user_id, vote)"
+        "), r AS ("
+        "  SELECT v.video_key, d.topic_id, u.user_key, d.vote FROM d "
+        "  JOIN videos v ON v.id = d.video_id "
+        "  JOIN users u ON u.id = d.user_id "
+        "  WHERE EXISTS (SELECT 1 FROM topics WHERE id = d.topic_id)"
+        "), w AS ("
+        "  INSERT INTO video_topics (video_key, topic_id, user_key, vote) "
+        "  SELECT video_key, topic_id, user_key, vote FROM r "
+        "  ON CONFLICT (video_key, topic_id, user_key) "
+        "  DO UPDATE SET vote = EXCLUDED.vote, created_at = CURRENT_TIMESTAMP "
+        "  WHERE video_topics.vote <> EXCLUDED.vote"
+        ") "
+        "SELECT (SELECT count(*) FROM d) - (SELECT count(*) FROM r) AS skipped");
+    // A delete for a user with no row is a no-op, not a skip: the vote it removes was never written
+    c.prepare("write_votes_delete",
+        "WITH d AS ("
+        "  SELECT * FROM unnest($1::varchar[], $2::int[], $3::varchar[]) AS d(video_id, topic_id, user_id)"
+        "), w AS ("
+        "  DELETE FROM video_topics t USING d "
+        "  JOIN videos v ON v.id = d.video_id "
+        "  JOIN users u ON u.id = d.user_id "
+        "  WHERE t.video_key = v.video_key AND t.topic_id = d.topic_id AND t.user_key = u.user_key"
+        ") "
+        "SELECT count(*) AS skipped FROM d WHERE NOT EXISTS (SELECT 1 FROM videos v WHERE v.id = d.video_id)");
+    // Both read the trigger-maintained video_topic_scores, so cost is O(topics per video)
+    // rather than O(votes per video). Topic names come from the in-process dictionary.
     c.prepare("get_aggregated_topics_for_video",
-        "SELECT t.id AS topic_id, t.name AS topic_name, SUM(vt.vote) AS total_votes "
-        "FROM video_topics vt "
-        "JOIN topics t ON vt.topic_id = t.id "
-        "WHERE vt.video_id = $1 "
-        "GROUP BY t.id, t.name "
+        "SELECT topic_id, total_votes, voter_count "
+        "FROM video_topic_scores "
+        "WHERE video_key = $1 "
         "ORDER BY total_votes DESC");
-    c.prepare("get_similar_videos",
-        "SELECT vt2.video_id, v2.title, COUNT(DISTINCT vt2.topic_id) AS shared_topics_count "
-        "FROM video_topics vt1 "
-        "JOIN video_topics vt2 ON vt1.topic_id = vt2.topic_id "
-        "JOIN videos v2 ON vt2.video_id = v2.id "
-        "WHERE vt1.video_id = $1 AND vt2.video_id != $2 "
-        "GROUP BY vt2.video_id, v2.title "
-        "ORDER BY shared_topics_count DESC");
-    c.prepare("get_user_details", "SELECT id, username, reputation, created_at FROM users WHERE id = $1");
-    c.prepare("get_user_submissions_count", "SELECT COUNT(*) FROM video_topics WHERE user_id = $1");
-    c.prepare("get_user_last_submission_date", "SELECT created_at FROM video_topics WHERE user_id = $1 ORDER BY created_at DESC LIMIT 1");
-    c.prepare("get_user_most_frequent_tag",
-        "SELECT t.name AS topic_name, COUNT(vt.topic_id) AS topic_count "
-        "FROM video_topics vt "
-        "JOIN topics t ON vt.topic_id = t.id "
-        "WHERE vt.user_id = $1 "
-        "GROUP BY t.name "
-        "ORDER BY topic_count DESC "
-        "LIMIT 1");
+    c.prepare("get_aggregated_topics_for_videos",
+        "SELECT video_key, topic_id, total_votes, voter_count "
+        "FROM video_topic_scores "
+        "WHERE video_key = ANY($1::bigint[])");
+    // Keyset-paginated scan used to fill the topic index at startup
+    c.prepare("load_topic_memberships",
+        "SELECT s.video_key, v.id AS video_id, s.topic_id, s.voter_count "
+        "FROM video_topic_scores s JOIN videos v ON v.video_key = s.video_key "
+        "WHERE s.voter_count > 0 AND (s.video_key, s.topic_id) > ($1, $2) "
+        "ORDER BY s.video_key, s.topic_id LIMIT $3");
+    // One indexed lookup per table regardless of how many votes the user has
+    c.prepare("get_user_stats",
+        "SELECT u.id, u.username, u.reputation, u.created_at, "
+        "       COALESCE(s.submissions_count, 0) AS submissions_count, s.last_submission_at, "
+        "       top.topic_id AS top_topic_id, top.submissions_count AS top_topic_count "
+        "FROM users u "
+        "LEFT JOIN user_stats s ON s.user_key = u.user_key "
+        "LEFT JOIN LATERAL ("
+        "  SELECT topic_id, submissions_count FROM user_topic_counts "
+        "  WHERE user_key = u.user_key ORDER BY submissions_count DESC, topic_id LIMIT 1"
+        ") top ON true "
+        "WHERE u.id = $1");
+    // Keyset-paginated scan used to fill the leaderboard at startup
+    c.prepare("load_user_contributions",
+        "SELECT u.user_key, u.id, u.username, COALESCE(s.submissions_count, 0) AS contributions_count "
+        "FROM users u LEFT JOIN user_stats s ON s.user_key = u.user_key "
+        "WHERE u.user_key > $1 ORDER BY u.user_key LIMIT $2");
     c.prepare("upsert_user", "INSERT INTO users (id, username) VALUES ($1, $2) ON CONFLICT (id) DO UPDATE SET username = EXCLUDED.username");
     c.prepare("upsert_user_no_username", "INSERT INTO users (id) VALUES ($1) ON CONFLICT (id) DO NOTHING");
-    c.prepare("update_video_embedding", "UPDATE videos SET vector_embedding = $1 WHERE id = $2");
-    c.prepare("get_video_embedding", "SELECT vector_embedding FROM videos WHERE id = $1");
+    c.prepare("get_videos_by_ids",
+        "SELECT id, title, upload_date, last_updated FROM videos WHERE id = ANY($1::varchar[])");
+    c.prepare("update_video_embedding",
+        "UPDATE videos SET vector_embedding = $1, embedding_version = nextval('video_embedding_version_seq') "
+        "WHERE id = $2 RETURNING title, upload_date, last_updated, embedding_version");
+    // Keyset-paginated scan in version order, used to fill the HNSW index / catch up the snapshot at startup
+    c.prepare("load_video_embeddings",
+        "SELECT id, title, upload_date, last_updated, vector_embedding, embedding_version FROM videos "
+        "WHERE vector_embedding IS NOT NULL AND embedding_version > $1 ORDER BY embedding_version LIMIT $2");
+    c.prepare("get_max_embedding_version", "SELECT COALESCE(MAX(embedding_version), 0) FROM videos");
+    // k-NN in one statement: the target embedding is read in the outer query and the
+    // LATERAL ORDER BY <=> LIMIT lets the planner walk the ivfflat index for the top k.
     c.prepare("get_similar_videos_by_vector",
-        "SELECT id, title, upload_date, last_updated, 1 - (vector_embedding <=> $1) AS similarity "
-        "FROM videos ");
+        "SELECT n.id, n.title, n.upload_date, n.last_updated, n.similarity "
+        "FROM videos target "
+        "CROSS JOIN LATERAL ("
+        "  SELECT v.id, v.title, v.upload_date, v.last_updated, "
+        "         1 - (v.vector_embedding <=> target.vector_embedding) AS similarity "
+        "  FROM videos v "
+        "  WHERE v.video_key <> target.video_key AND v.vector_embedding IS NOT NULL "
+        "  ORDER BY v.vector_embedding <=> target.vector_embedding "
+        "  LIMIT $2"
+        ") n "
+        "WHERE target.id = $1 AND target.vector_embedding IS NOT NULL AND n.similarity >= $3 "
+        "ORDER BY n.similarity DESC");
+    // Transaction-scoped, so a per-request probes value never leaks to the next user of the connection
+    c.prepare("set_ivfflat_probes", "SELECT set_config('ivfflat.probes', $1, true)");
 }
 
 Database::~Database() {
-    // Connection is managed by unique_ptr, no explicit disconnect needed.
+    // Connections are owned by the pool, no explicit disconnect needed.
+    shuttingDown.store(true);
+    // Drain queued tasks while everything they touch (caches, indexes, snapshot, pool) is
+    // still alive: members are destroyed in reverse order, and executor is declared before
+    // most of them. Uploads whose futures were dropped still run here.
+    executor.shutdown();
+    if (vectorIndexLoader.joinable()) {
+        vectorIndexLoader.join();
+    }
+    if (votePipeline) {
+        // Write back every accepted vote while the pool is still up
+        votePipeline->stop();
+    }
 }
 
-pqxx::connection& Database::getConnection() {
-    if (!conn || !conn->is_open()) {
+PooledConnection Database::getConnection() {
+    if (!pool) {
         throw std::runtime_error("Database connection is not open.");
     }
-    return *conn;
+    return pool->acquire();
+}
+
+nlohmann::json Database::getPoolStats() {
+    PoolStats s = pool->stats();
+    nlohmann::json stats;
+    stats["size"] = s.size;
+    stats["in_use"] = s.in_use;
+    stats["idle"] = s.idle;
+    stats["acquisitions"] = s.acquisitions;
+    stats["waits"] = s.waits;
+    stats["timeouts"] = s.timeouts;
+    stats["reconnects"] = s.reconnects;
+    stats["validations"] = s.validations;
+    stats["total_wait_us"] = s.total_wait_us;
+    stats["max_wait_us"] = s.max_wait_us;
+    return stats;
+}
+
+Executor& Database::getExecutor() {
+    return executor;
+}
+
+nlohmann::json Database::getExecutorStats() {
+    ExecutorStats s = executor.stats();
+    nlohmann::json stats;
+    stats["threads"] = s.threads;
+    stats["queue_capacity"] = s.queue_capacity;
+    stats["queue_depth"] = s.queue_depth;
+    stats["active"] = s.active;
+    stats["submitted"] = s.submitted;
+    stats["completed"] = s.completed;
+    stats["rejected"] = s.rejected;
+    stats["caller_runs"] = s.caller_runs;
+    stats["total_queue_wait_us"] = s.total_queue_wait_us;
+    stats["max_queue_wait_us"] = s.max_queue_wait_us;
+    stats["total_run_us"] = s.total_run_us;
+    return stats;
+}
+
+nlohmann::json Database::getTopicIndexStats() {
+    TopicIndexStats s = topicIndex.stats();
+    nlohmann::json stats;
+    stats["videos"] = s.videos;
+    stats["topics"] = s.topics;
+    stats["memberships"] = s.memberships;
+    stats["bitmap_bytes"] = s.bitmap_bytes;
+    stats["queries"] = s.queries;
+    stats["parallel_queries"] = s.parallel_queries;
+    return stats;
+}
+
+nlohmann::json Database::getVectorIndexStats() {
+    HnswStats s = vectorIndex.stats();
+    nlohmann::json stats;
+    stats["ready"] = vectorIndexReady.load();
+    stats["simd"] = s.simd;
+    stats["dim"] = s.dim;
+    stats["nodes"] = s.nodes;
+    stats["live"] = s.live;
+    stats["deleted"] = s.deleted;
+    stats["vector_bytes"] = s.vector_bytes;
+    stats["max_level"] = s.max_level;
+    stats["inserts"] = s.inserts;
+    stats["searches"] = s.searches;
+    stats["distance_computations"] = s.distance_computations;
+    stats["catalog_entries"] = videoCatalog.size();
+    if (embeddingStore) {
+        EmbeddingStoreStats snap = embeddingStore->stats();
+        nlohmann::json snapshot;
+        snapshot["open"] = snap.open;
+        snapshot["ready"] = embeddingStoreReady.load();
+        snapshot["float32"] = snap.has_float;
+        snapshot["records"] = snap.records;
+        snapshot["live"] = snap.live;
+        snapshot["file_bytes"] = snap.file_bytes;
+        snapshot["max_version"] = snap.max_version;
+        snapshot["appends"] = snap.appends;
+        snapshot["compactions"] = snap.compactions;
+        snapshot["brute_force_searches"] = snap.scans;
+        stats["snapshot"] = snapshot;
+    } else {
+        stats["snapshot"] = nullptr;
+    }
+    return stats;
+}
+
+nlohmann::json Database::getVotePipelineStats() {
+    nlohmann::json stats;
+    stats["enabled"] = votePipeline != nullptr;
+    if (!votePipeline) {
+        return stats;
+    }
+    VotePipelineStats s = votePipeline->stats();
+    stats["accepted"] = s.accepted;
+    stats["written"] = s.written;
+    stats["pending"] = s.pending;
+    stats["batches"] = s.batches;
+    stats["write_errors"] = s.write_errors;
+    stats["replayed"] = s.replayed;
+    stats["skipped"] = skippedVotes.load(std::memory_order_relaxed);
+    stats["avg_batch_ms"] = s.batches ? s.total_batch_us / 1000.0 / s.batches : 0.0;
+    stats["max_batch_ms"] = s.max_batch_us / 1000.0;
+    stats["log_segments"] = s.log.segments;
+    stats["log_bytes"] = s.log.bytes;
+    stats["log_syncs"] = s.log.syncs;
+    stats["log_failed"] = s.log.failed;
+    return stats;
+}
+
+nlohmann::json Database::getKeyCacheStats() {
+    nlohmann::json stats;
+    for (const auto& cache : {std::make_pair("videos", &videoKeys), std::make_pair("users", &userKeys)}) {
+        KeyCacheStats s = cache.second->stats();
+        nlohmann::json entry;
+        entry["hits"] = s.hits;
+        entry["misses"] = s.misses;
+        entry["evictions"] = s.evictions;
+        entry["entries"] = s.entries;
+        entry["capacity"] = s.capacity;
+        stats[cache.first] = entry;
+    }
+    return stats;
+}
+
+std::string Database::getVideoEtag(const std::string& videoId) {
+    return videoVersions.etag(videoId);
+}
+
+nlohmann::json Database::getTallyCacheStats() {
+    TallyCacheStats s = tallyCache.stats();
+    nlohmann::json stats;
+    stats["hits"] = s.hits;
+    stats["misses"] = s.misses;
+    stats["evictions"] = s.evictions;
+    stats["vote_updates"] = s.vote_updates;
+    stats["stale_loads"] = s.stale_loads;
+    stats["entries"] = s.entries;
+    stats["bytes"] = s.bytes;
+    stats["capacity_bytes"] = s.capacity_bytes;
+    return stats;
 }
 
 void Database::updateVideoEmbedding(const std::string& videoId, const std::vector<float>& embedding) {
     try {
-        pqxx::work txn(getConnection());
-        std::string embedding_str = formatVectorForPgvector(embedding);
-        txn.exec_prepared("update_video_embedding", embedding_str, videoId);
+        auto conn = getConnection();
+        pqxx::work txn(*conn);
+        // Per-thread buffer so executor workers don't allocate per update
+        thread_local std::string embedding_buf;
+#ifdef PGVECTOR_BINARY_PARAMS
+        encodePgvectorBinary(embedding.data(), embedding.size(), embedding_buf);
+        pqxx::result r = execPrepared(txn, "update_video_embedding",
+            pqxx::binarystring(embedding_buf.data(), embedding_buf.size()), videoId);
+#else
+        encodePgvector(embedding.data(), embedding.size(), embedding_buf);
+        pqxx::result r = execPrepared(txn, "update_video_embedding", embedding_buf, videoId);
+#endif
         txn.commit();
+
+        // Unknown videos are not updated, so there is nothing to index
+        if (!r.empty()) {
+            uint64_t version = static_cast<uint64_t>(r[0]["embedding_version"].as<int64_t>());
+            videoCatalog.put(videoId, videoInfoFromRow(r[0]));
+            vectorIndex.insert(videoId, embedding.data(), version);
+            if (embeddingStore) {
+                embeddingStore->append(videoId, version, embedding.data());
+                if (embeddingStoreReady.load() && embeddingStore->needsCompaction(EMBEDDING_SNAPSHOT_MIN_DEAD)) {
+                    try {
+                        executor.post([this]() { embeddingStore->compact(); });
+                    } catch (const ServiceUnavailable&) {
+                        // Busy; the next embedding update retries
+                    }
+                }
+            }
+            videoVersions.bump(videoId);
+        }
     } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in updateVideoEmbedding: " << e.what() << std::endl;
+        LOG_ERROR("Error in updateVideoEmbedding: " << e.what());
         throw;
     }
 }
 
-nlohmann::json Database::getSimilarVideosByVector(const std::string& videoId, int limit) {
-    nlohmann::json similar_videos = nlohmann::json::array();
+void Database::rerankNeighbours(const std::string& videoId, std::vector<HnswResult>& neighbours) {
+    thread_local std::vector<float> query;
+    thread_local std::vector<float> values;
+    if (!embeddingStore->values(videoId, query)) {
+        return;
+    }
+    for (HnswResult& n : neighbours) {
+        if (embeddingStore->values(n.label, values)) {
+            n.similarity = dotProduct(query.data(), values.data(), query.size());
+        }
+    }
+    std::sort(neighbours.begin(), neighbours.end(),
+              [](const HnswResult& a, const HnswResult& b) { return a.similarity > b.similarity; });
+}
+
+void Database::fillVideoCatalog(const std::vector<std::string>& videoIds) {
+    std::vector<std::string> missing;
+    VideoInfo info;
+    for (const std::string& id : videoIds) {
+        if (!videoCatalog.get(id, info)) {
+            missing.push_back(id);
+        }
+    }
+    if (missing.empty()) {
+        return;
+    }
     try {
-        pqxx::work txn(getConnection());
+        auto conn = getConnection();
+        pqxx::work txn(*conn);
+        pqxx::result r = execPrepared(txn, "get_videos_by_ids", formatPgTextArray(missing));
+        for (const auto& row : r) {
+            videoCatalog.put(row["id"].as<std::string>(), videoInfoFromRow(row), false);
+        }
+    } catch (const pqxx::sql_error &e) {
+        // Results are still served, just without titles
+        LOG_ERROR("Error in fillVideoCatalog: " << e.what());
+    }
+}
 
-        // First, get the embedding of the target video
-        pqxx::result r_embedding = txn.exec_prepared("get_video_embedding", videoId);
-        if (r_embedding.empty() || r_embedding[0][0].is_null()) {
-            std::cerr << "Error: Embedding not found for video ID: " << videoId << std::endl;
-            return similar_videos; // Return empty if target embedding not found
+void Database::vectorSimilarities(const std::string& videoId, const std::vector<std::string>& others,
+                                  std::vector<std::optional<float>>& out) {
+    out.assign(others.size(), std::nullopt);
+    if (embeddingStoreReady.load() && embeddingStore->hasValues()) {
+        thread_local std::vector<float> query;
+        thread_local std::vector<float> values;
+        if (embeddingStore->values(videoId, query)) {
+            for (size_t i = 0; i < others.size(); ++i) {
+                if (embeddingStore->values(others[i], values)) {
+                    out[i] = dotProduct(query.data(), values.data(), query.size());
+                }
+            }
+            return;
+        }
+    }
+    if (vectorIndexReady.load()) {
+        vectorIndex.similarities(videoId, others, out);
+    }
+}
+
+std::vector<HnswResult> Database::similarByVector(const std::string& videoId, int limit, double minSimilarity,
+                                                  int probes, int ef) {
+    limit = std::max(1, limit);
+
+    std::vector<HnswResult> neighbours;
+    bool indexed = false;
+    if (vectorIndexReady.load()) {
+        size_t search_ef = ef > 0 ? std::min(static_cast<size_t>(ef), HNSW_MAX_EF) : HNSW_EF_SEARCH;
+        const bool rerank = embeddingStore && embeddingStore->hasValues() && embeddingStoreReady.load();
+        size_t candidates = rerank ? limit * HNSW_RERANK_FACTOR : limit;
+        indexed = vectorIndex.searchByLabel(videoId, candidates, std::max(search_ef, candidates), neighbours);
+        if (indexed && rerank) {
+            rerankNeighbours(videoId, neighbours);
+        }
+    } else if (embeddingStoreReady.load()) {
+        indexed = embeddingStore->search(videoId, limit, neighbours);
+    }
+    if (indexed) {
+        if (neighbours.size() > static_cast<size_t>(limit)) {
+            neighbours.resize(limit);
+        }
+        // Sorted by similarity, so everything from the first one below the threshold goes
+        auto below = std::find_if(neighbours.begin(), neighbours.end(),
+                                  [&](const HnswResult& n) { return n.similarity < minSimilarity; });
+        neighbours.erase(below, neighbours.end());
+        std::vector<std::string> ids;
+        for (const HnswResult& n : neighbours) {
+            ids.push_back(n.label);
         }
-        std::string target_embedding_str = r_embedding[0][0].as<std::string>();
-        std::cerr << "  Target embedding for " << videoId << ": " << target_embedding_str.substr(0, 50) << "..." << std::endl; // Log first 50 chars
+        fillVideoCatalog(ids);
+        return neighbours;
+    }
+    // Not indexed: either no embedding, or it was written outside this process (embedding-loader)
+    try {
+        auto conn = getConnection();
+        pqxx::work txn(*conn);
 
-        // Now, use this embedding to find similar videos
-        pqxx::result r = txn.exec_prepared("get_similar_videos_by_vector", target_embedding_str);
-        std::cerr << "  Executed get_similar_videos_by_vector for " << videoId << ", returned " << r.size() << " rows." << std::endl;
+        if (probes > 0) {
+            probes = std::min(probes, static_cast<int>(IVFFLAT_MAX_PROBES));
+            execPrepared(txn, "set_ivfflat_probes", std::to_string(probes));
+        }
 
+        pqxx::result r = execPrepared(txn, "get_similar_videos_by_vector", videoId, limit, minSimilarity);
         for (const auto& row : r) {
-            nlohmann::json video_data;
-            video_data["id"] = row["id"].as<std::string>();
-            video_data["title"] = row["title"].is_null() ? nullptr : row["title"].c_str();
-            video_data["upload_date"] = row["upload_date"].is_null() ? nullptr : row["upload_date"].c_str();
-            video_data["last_updated"] = row["last_updated"].is_null() ? nullptr : row["last_updated"].c_str();
-            video_data["similarity"] = row["similarity"].as<double>();
-            similar_videos.push_back(video_data);
+            std::string id = row["id"].as<std::string>();
+            // Rendered from the catalog like index results
+            videoCatalog.put(id, videoInfoFromRow(row), false);
+            neighbours.push_back(HnswResult{std::move(id), row["similarity"].as<float>()});
         }
+        txn.commit();
     } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in getSimilarVideosByVector: " << e.what() << std::endl;
-        // It's important to return an empty JSON array in case of an error
-        return nlohmann::json::array();
+        LOG_ERROR("Error in getSimilarVideosByVector: " << e.what());
+        // Degrade to an empty list rather than failing the request
+        neighbours.clear();
     }
-    return similar_videos;
+    return neighbours;
+}
+
+std::string Database::getSimilarVideosByVector(const std::string& videoId, int limit, double minSimilarity,
+                                               int probes, int ef) {
+    limit = std::max(1, std::min(limit, static_cast<int>(MAX_SIMILAR_BY_VECTOR_LIMIT)));
+    std::vector<HnswResult> neighbours = similarByVector(videoId, limit, minSimilarity, probes, ef);
+    JsonWriter out(2 + neighbours.size() * SIMILAR_VIDEO_JSON_BYTES);
+    out.beginArray();
+    VideoInfo info;
+    for (const HnswResult& n : neighbours) {
+        info = VideoInfo();
+        videoCatalog.get(n.label, info);
+        out.beginObject();
+        out.key("id").value(n.label);
+        out.key("last_updated").value(info.last_updated);
+        out.key("similarity").value(static_cast<double>(n.similarity));
+        out.key("title").value(info.title);
+        out.key("upload_date").value(info.upload_date);
+        out.endObject();
+    }
+    out.endArray();
+    return out.take();
+}
+
+std::string Database::getSimilarVideosHybrid(const std::string& videoId, int limit, double topicWeight,
+                                             double vectorWeight) {
+    limit = std::max(1, std::min(limit, static_cast<int>(MAX_SIMILAR_VIDEOS_LIMIT)));
+    const int candidates = limit * static_cast<int>(HYBRID_CANDIDATE_FACTOR);
+
+    std::future<std::vector<TopicOverlap>> by_topic_future;
+    std::future<std::vector<HnswResult>> by_vector_future;
+    if (topicWeight > 0) {
+        by_topic_future = executor.submit([this, videoId, candidates]() {
+            return topicIndex.similar(videoId, candidates);
+        });
+    }
+    if (vectorWeight > 0) {
+        by_vector_future = executor.submit([this, videoId, candidates]() {
+            return similarByVector(videoId, candidates, -1.0, 0, 0);
+        });
+    }
+
+    // Union of both candidate lists; each gets both scores below, whichever list it came from
+    std::vector<std::string> ids;
+    std::unordered_map<std::string, size_t> slot;
+    auto addCandidate = [&](const std::string& id) {
+        if (slot.emplace(id, ids.size()).second) {
+            ids.push_back(id);
+        }
+    };
+    if (by_topic_future.valid()) {
+        for (const TopicOverlap& o : by_topic_future.get()) {
+            addCandidate(o.video_id);
+        }
+    }
+    std::vector<std::optional<float>> similarity;
+    if (by_vector_future.valid()) {
+        std::vector<HnswResult> by_vector = by_vector_future.get();
+        for (const HnswResult& n : by_vector) {
+            addCandidate(n.label);
+        }
+        similarity.resize(ids.size());
+        for (const HnswResult& n : by_vector) {
+            similarity[slot[n.label]] = n.similarity;
+        }
+    }
+    similarity.resize(ids.size());
+
+    std::vector<int> shared;
+    size_t topic_count = topicIndex.sharedTopics(videoId, ids, shared);
+    std::vector<std::string> missing;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (!similarity[i]) {
+            missing.push_back(ids[i]);
+        }
+    }
+    if (vectorWeight > 0 && !missing.empty()) {
+        std::vector<std::optional<float>> found;
+        vectorSimilarities(videoId, missing, found);
+        for (size_t i = 0; i < missing.size(); ++i) {
+            similarity[slot[missing[i]]] = found[i];
+        }
+    }
+
+    std::vector<std::pair<double, size_t>> ranked; // (-score, candidate)
+    for (size_t i = 0; i < ids.size(); ++i) {
+        double topic_score = topic_count > 0 ? static_cast<double>(shared[i]) / topic_count : 0.0;
+        double vector_score = similarity[i] ? std::max(0.0, static_cast<double>(*similarity[i])) : 0.0;
+        ranked.emplace_back(-(topicWeight * topic_score + vectorWeight * vector_score), i);
+    }
+    size_t top = std::min(ranked.size(), static_cast<size_t>(limit));
+    std::partial_sort(ranked.begin(), ranked.begin() + top, ranked.end());
+    ranked.resize(top);
+
+    std::vector<std::string> top_ids;
+    for (const auto& r : ranked) {
+        top_ids.push_back(ids[r.second]);
+    }
+    fillVideoCatalog(top_ids);
+    JsonWriter out(2 + ranked.size() * SIMILAR_VIDEO_JSON_BYTES);
+    out.beginArray();
+    for (const auto& r : ranked) {
+        const size_t i = r.second;
+        VideoInfo info;
+        videoCatalog.get(ids[i], info);
+        out.beginObject();
+        out.key("id").value(ids[i]);
+        out.key("score").value(-r.first);
+        out.key("shared_topics_count").value(shared[i]);
+        out.key("similarity").value(similarity[i] ? std::optional<double>(*similarity[i]) : std::nullopt);
+        out.key("title").value(info.title);
+        out.endObject();
+    }
+    out.endArray();
+    return out.take();
 }
 
 nlohmann::json Database::getVideoById(const std::string& videoId) {
     try {
-        pqxx::work txn(getConnection());
-        pqxx::result r = txn.exec_prepared("get_video_by_id", videoId);
+        auto conn = getConnection();
+        pqxx::work txn(*conn);
+        pqxx::result r = execPrepared(txn, "get_video_by_id", videoId);
 
         if (!r.empty()) {
             nlohmann::json video_data;
@@ -210,35 +1120,36 @@ nlohmann::json Database::getVideoById(const std::string& videoId) {
         }
         return nlohmann::json();
     } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in getVideoById: " << e.what() << std::endl;
+        LOG_ERROR("Error in getVideoById: " << e.what());
         throw;
     }
 }
 
 nlohmann::json Database::insertVideo(const std::string& videoId, const std::string& title) {
     try {
-        pqxx::work txn(getConnection());
-        if (title.empty()) {
-            txn.exec_prepared("insert_video_no_title", videoId);
-        } else {
-            txn.exec_prepared("insert_video", videoId, title);
-        }
+        auto conn = getConnection();
+        pqxx::work txn(*conn);
+        pqxx::result r = title.empty() ? execPrepared(txn, "insert_video_no_title", videoId)
+                                       : execPrepared(txn, "insert_video", videoId, title);
         txn.commit();
+        videoKeys.put(videoId, r[0]["video_key"].as<int64_t>());
+        videoVersions.bump(videoId);
 
         nlohmann::json video_data;
         video_data["id"] = videoId;
         video_data["title"] = title.empty() ? nullptr : title;
         return video_data;
     } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in insertVideo: " << e.what() << std::endl;
+        LOG_ERROR("Error in insertVideo: " << e.what());
         throw;
     }
 }
 
 nlohmann::json Database::getTopicByName(const std::string& topicName) {
     try {
-        pqxx::work txn(getConnection());
-        pqxx::result r = txn.exec_prepared("get_topic_by_name", topicName);
+        auto conn = getConnection();
+        pqxx::work txn(*conn);
+        pqxx::result r = execPrepared(txn, "get_topic_by_name", topicName);
 
         if (!r.empty()) {
             nlohmann::json topic_data;
@@ -246,308 +1157,557 @@ nlohmann::json Database::getTopicByName(const std::string& topicName) {
             topic_data["id"] = row["id"].as<int>();
             topic_data["name"] = row["name"].as<std::string>();
             topic_data["created_at"] = row["created_at"].as<std::string>();
+            topics.insert(topic_data["id"].get<int>(), topicName);
             return topic_data;
         }
         return nlohmann::json();
     } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in getTopicByName: " << e.what() << std::endl;
+        LOG_ERROR("Error in getTopicByName: " << e.what());
         throw;
     }
 }
 
-int Database::insertTopic(const std::string& topicName) {
+nlohmann::json Database::getTopicById(int topicId) {
     try {
-        pqxx::work txn(getConnection());
-        pqxx::result r = txn.exec_prepared("insert_topic", topicName);
-        txn.commit();
-        return r[0][0].as<int>(); // Assuming the query returns the ID of the inserted topic
-    } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in insertTopic: " << e.what() << std::endl;
-        throw;
-    }
-}
-
-nlohmann::json Database::getVideoTopicVote(const std::string& videoId, int topicId, const std::string& userId) {
-    try {
-        pqxx::work txn(getConnection());
-        pqxx::result r = txn.exec_prepared("get_video_topic_vote", videoId, topicId, userId);
+        auto conn = getConnection();
+        pqxx::work txn(*conn);
+        pqxx::result r = execPrepared(txn, "get_topic_by_id", topicId);
 
         if (!r.empty()) {
-            nlohmann::json vote_data;
+            nlohmann::json topic_data;
             const auto& row = r[0];
-            vote_data["video_id"] = row["video_id"].as<std::string>();
-            vote_data["topic_id"] = row["topic_id"].as<int>();
-            vote_data["user_id"] = row["user_id"].as<std::string>();
-            vote_data["vote"] = row["vote"].as<int>();
-            vote_data["created_at"] = row["created_at"].as<std::string>();
-            return vote_data;
+            topic_data["id"] = row["id"].as<int>();
+            topic_data["name"] = row["name"].as<std::string>();
+            topic_data["created_at"] = row["created_at"].as<std::string>();
+            return topic_data;
         }
         return nlohmann::json();
     } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in getVideoTopicVote: " << e.what() << std::endl;
+        LOG_ERROR("Error in getTopicById: " << e.what());
         throw;
     }
 }
 
-void Database::updateVideoTopicVote(const std::string& videoId, int topicId, const std::string& userId, int newVoteValue) {
+int Database::insertTopic(const std::string& topicName) {
     try {
-        pqxx::work txn(getConnection());
-        txn.exec_prepared("update_video_topic_vote", newVoteValue, videoId, topicId, userId);
+        auto conn = getConnection();
+        pqxx::work txn(*conn);
+        pqxx::result r = execPrepared(txn, "insert_topic", topicName);
+        if (r.empty()) {
+            // UNIQUE conflict: another request created it first; this statement's snapshot sees it
+            r = execPrepared(txn, "get_topic_by_name", topicName);
+        }
         txn.commit();
+        int topicId = r[0]["id"].as<int>();
+        topics.insert(topicId, topicName);
+        return topicId;
     } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in updateVideoTopicVote: " << e.what() << std::endl;
+        LOG_ERROR("Error in insertTopic: " << e.what());
         throw;
     }
 }
 
-void Database::insertVideoTopicVote(const std::string& videoId, int topicId, const std::string& userId, int voteValue) {
+nlohmann::json Database::submitVote(const std::string& videoId, const std::string& topicName, int topicId,
+                                    const std::string& userId, int desiredVote) {
+    if (!topicName.empty()) {
+        topicId = resolveTopicId(topicName);
+    } else if (!resolveTopicName(topicId)) {
+        return nlohmann::json();
+    }
+
+    if (votePipeline) {
+        return queueVote(videoId, topicId, userId, desiredVote);
+    }
+
+    TallyWriteGuard guard(tallyCache, videoId);
     try {
-        pqxx::work txn(getConnection());
-        txn.exec_prepared("insert_video_topic_vote", videoId, topicId, userId, voteValue);
-        txn.commit();
+        auto conn = getConnection();
+        // A single statement is atomic on its own; nontransaction avoids the BEGIN/COMMIT round trips.
+        // With both keys cached the vote is that one statement.
+        pqxx::nontransaction txn(*conn);
+        std::optional<int64_t> videoKey = resolveVideoKey(txn, videoId);
+        if (!videoKey) {
+            throw NotFound("Video not found.");
+        }
+        int64_t userKey = internUser(txn, userId);
+        pqxx::result r = execPrepared(txn, "submit_vote", userKey, topicId, *videoKey, desiredVote);
+
+        const auto& row = r[0];
+        nlohmann::json vote_data;
+        vote_data["action"] = row["action"].as<std::string>();
+        vote_data["topic_id"] = topicId;
+        vote_data["user_id"] = userId;
+        vote_data["previous_vote"] = row["previous_vote"].is_null() ? nlohmann::json() : nlohmann::json(row["previous_vote"].as<int>());
+        vote_data["vote"] = row["vote"].is_null() ? nlohmann::json() : nlohmann::json(row["vote"].as<int>());
+        onVoteCommitted(videoId, vote_data);
+        return vote_data;
     } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in insertVideoTopicVote: " << e.what() << std::endl;
+        LOG_ERROR("Error in submitVote: " << e.what());
         throw;
     }
 }
 
-void Database::deleteVideoTopicVote(const std::string &videoId, int topicId, const std::string &userId) {
+nlohmann::json Database::queueVote(const std::string& videoId, int topicId, const std::string& userId, int desiredVote) {
+    // Postgres must accept whatever reaches the log: it can't be rejected after the 202
+    if (userId.size() > 255 || userId.find('\0') != std::string::npos) {
+        throw std::invalid_argument("Invalid user ID.");
+    }
+
+    uint64_t seq;
+    nlohmann::json vote_data;
+    {
+        auto keyLock = votePipeline->lockKey(videoId, topicId, userId);
+        std::optional<int> previous;
+        if (!votePipeline->pendingVote(videoId, topicId, userId, previous)) {
+            try {
+                auto conn = getConnection();
+                pqxx::nontransaction txn(*conn);
+                pqxx::result r = execPrepared(txn, "get_vote_state", videoId, topicId, userId);
+                if (r.empty()) {
+                    throw NotFound("Video not found.");
+                }
+                videoKeys.put(videoId, r[0]["video_key"].as<int64_t>());
+                if (!r[0]["vote"].is_null()) {
+                    previous = r[0]["vote"].as<int>();
+                }
+            } catch (const pqxx::sql_error &e) {
+                LOG_ERROR("Error in queueVote: " << e.what());
+                throw;
+            }
+        }
+
+        // Same rule as submit_vote: repeating the current vote removes it
+        std::optional<int> current;
+        if (previous != desiredVote) {
+            current = desiredVote;
+        }
+        int voteDelta = current.value_or(0) - previous.value_or(0);
+        int voterDelta = (current ? 1 : 0) - (previous ? 1 : 0);
+
+        TallyWriteGuard guard(tallyCache, videoId);
+        seq = votePipeline->submit(videoId, topicId, userId, current, voteDelta, voterDelta);
+        vote_data["action"] = !current ? "removed" : previous ? "updated" : "recorded";
+        vote_data["topic_id"] = topicId;
+        vote_data["user_id"] = userId;
+        vote_data["previous_vote"] = optionalJson(previous);
+        vote_data["vote"] = optionalJson(current);
+        vote_data["queued"] = true;
+        onVoteCommitted(videoId, vote_data);
+    }
+    // Outside the key lock, so concurrent votes share one fdatasync. The vote is already applied
+    // in memory and queued for write-back, so a failed sync is reported rather than a 503.
     try {
-        pqxx::work txn(getConnection());
-        txn.exec_prepared("delete_video_topic_vote", videoId, topicId, userId);
-        txn.commit();
-    } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in deleteVideoTopicVote: " << e.what() << std::endl;
-        throw;
+        votePipeline->waitDurable(seq);
+        vote_data["durable"] = true;
+    } catch (const ServiceUnavailable& e) {
+        LOG_WARN("Vote accepted but not durable" << kv("video", videoId) << kv("error", e.what()));
+        vote_data["durable"] = false;
     }
+    return vote_data;
 }
 
-nlohmann::json Database::getAggregatedTopicsForVideo(const std::string& videoId) {
-    nlohmann::json topics_list = nlohmann::json::array();
-    try {
-        pqxx::work txn(getConnection());
-        pqxx::result r = txn.exec_prepared("get_aggregated_topics_for_video", videoId);
+void Database::writeVotes(const std::vector<VoteRecord>& records) {
+    // One statement can't upsert a row twice: only the newest row per key goes out
+    std::unordered_map<std::string, size_t> newest;
+    for (size_t i = 0; i < records.size(); ++i) {
+        const VoteRecord& r = records[i];
+        newest[r.video_id + '\0' + r.user_id + '\0' + std::to_string(r.topic_id)] = i;
+    }
+    std::vector<std::string> upsert_videos, upsert_users, delete_videos, delete_users;
+    std::vector<int> upsert_topics, upsert_votes, delete_topics;
+    for (const auto& entry : newest) {
+        const VoteRecord& r = records[entry.second];
+        if (r.vote) {
+            upsert_videos.push_back(r.video_id);
+            upsert_topics.push_back(r.topic_id);
+            upsert_users.push_back(r.user_id);
+            upsert_votes.push_back(*r.vote);
+        } else {
+            delete_videos.push_back(r.video_id);
+            delete_topics.push_back(r.topic_id);
+            delete_users.push_back(r.user_id);
+        }
+    }
 
-        for (const auto& row : r) {
-            nlohmann::json topic_data;
-            topic_data["topic_id"] = row["topic_id"].as<int>();
-            topic_data["topic_name"] = row["topic_name"].as<std::string>();
-            topic_data["total_votes"] = row["total_votes"].as<int>();
-            topics_list.push_back(topic_data);
+    try {
+        auto conn = getConnection();
+        pqxx::work txn(*conn);
+        int64_t skipped = 0;
+        if (!upsert_videos.empty()) {
+            execPrepared(txn, "write_votes_users", formatPgTextArray(upsert_users));
+            pqxx::result r = execPrepared(txn, "write_votes_upsert", formatPgTextArray(upsert_videos),
+                                          formatPgIntArray(upsert_topics), formatPgTextArray(upsert_users),
+                                          formatPgIntArray(upsert_votes));
+            skipped += r[0]["skipped"].as<int64_t>();
+        }
+        if (!delete_videos.empty()) {
+            pqxx::result r = execPrepared(txn, "write_votes_delete", formatPgTextArray(delete_videos),
+                                          formatPgIntArray(delete_topics), formatPgTextArray(delete_users));
+            skipped += r[0]["skipped"].as<int64_t>();
+        }
+        txn.commit();
+        if (skipped > 0) {
+            skippedVotes.fetch_add(static_cast<uint64_t>(skipped), std::memory_order_relaxed);
+            LOG_WARN("Skipped votes whose video or topic no longer exists" << kv("skipped", skipped)
+                     << kv("batch", newest.size()));
+        }
+    } catch (const pqxx::data_exception &e) {
+        // A row Postgres refuses would fail every retry; isolate it instead of stalling the queue
+        if (records.size() == 1) {
+            LOG_WARN("Dropping vote by " << records[0].user_id << " on " << records[0].video_id
+                     << " rejected by Postgres: " << e.what());
+            return;
+        }
+        LOG_WARN("Error in writeVotes, writing " << records.size() << " votes one at a time: " << e.what());
+        for (const VoteRecord& record : records) {
+            writeVotes({record});
         }
     } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in getAggregatedTopicsForVideo: " << e.what() << std::endl;
+        LOG_ERROR("Error in writeVotes: " << e.what());
         throw;
     }
-    return topics_list;
 }
 
-nlohmann::json Database::getSimilarVideos(const std::string& videoId) {
-    nlohmann::json similar_videos = nlohmann::json::array();
-    try {
-        pqxx::work txn(getConnection());
-        pqxx::result r = txn.exec_prepared("get_similar_videos", videoId, videoId);
+void Database::onVoteCommitted(const std::string& videoId, const nlohmann::json& vote) {
+    int topicId = vote["topic_id"].get<int>();
+    const nlohmann::json& previous = vote["previous_vote"];
+    const nlohmann::json& current = vote["vote"];
 
-        for (const auto& row : r) {
-            nlohmann::json video_data;
-            video_data["video_id"] = row["video_id"].as<std::string>();
-            video_data["title"] = row["title"].as<std::string>();
-            video_data["shared_topics_count"] = row["shared_topics_count"].as<int>();
-            similar_videos.push_back(video_data);
+    if (previous.is_null() && vote["action"] == "updated") {
+        // Lost a race with a concurrent vote by the same user; the old value is unknown.
+        tallyCache.invalidate(videoId);
+        videoVersions.bump(videoId);
+        return;
+    }
+
+    int voteDelta = (current.is_null() ? 0 : current.get<int>()) - (previous.is_null() ? 0 : previous.get<int>());
+    int voterDelta = (current.is_null() ? 0 : 1) - (previous.is_null() ? 0 : 1);
+    tallyCache.applyVote(videoId, topicId, voteDelta, voterDelta);
+    topicIndex.applyVoters(videoId, topicId, voterDelta);
+    leaderboard.adjust(vote["user_id"].get<std::string>(), voterDelta);
+    // Last, so the new version is only seen once the tallies above reflect the vote
+    videoVersions.bump(videoId);
+}
+
+std::string Database::getAggregatedTopicsForVideo(const std::string& videoId) {
+    std::vector<TopicTally> tallies;
+    if (!tallyCache.get(videoId, tallies)) {
+        try {
+            uint64_t token = tallyCache.loadToken(videoId);
+            auto conn = getConnection();
+            pqxx::work txn(*conn);
+            // An unknown video has no tallies; that is cached like any other result
+            std::optional<int64_t> videoKey = resolveVideoKey(txn, videoId);
+            if (videoKey) {
+                pqxx::result r = execPrepared(txn, "get_aggregated_topics_for_video", *videoKey);
+                tallies.reserve(r.size());
+                for (const auto& row : r) {
+                    tallies.push_back(TopicTally{row["topic_id"].as<int>(), row["total_votes"].as<int>(), row["voter_count"].as<int>()});
+                }
+            }
+            if (votePipeline) {
+                votePipeline->addPending(videoId, tallies);
+            }
+            tallyCache.put(videoId, tallies, token);
+        } catch (const pqxx::sql_error &e) {
+            LOG_ERROR("Error in getAggregatedTopicsForVideo: " << e.what());
+            throw;
         }
-    } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in getSimilarVideos: " << e.what() << std::endl;
-        throw;
     }
-    return similar_videos;
+
+    JsonWriter out(32 + videoId.size() + tallies.size() * TOPIC_JSON_BYTES);
+    out.beginObject();
+    out.key("topics");
+    writeTopics(out, tallies);
+    out.key("video_id").value(videoId);
+    out.endObject();
+    return out.take();
 }
 
-nlohmann::json Database::getUserDetails(const std::string &userId) {
-    try {
-        pqxx::work txn(getConnection());
-        pqxx::result r = txn.exec_prepared("get_user_details", userId);
+// JsonWriter keeps keys in call order. This and every list renderer in this file write
+// them sorted, as nlohmann::json::dump did, so response bodies are unchanged.
+void Database::writeTopics(JsonWriter& out, std::vector<TopicTally>& tallies) {
+    std::stable_sort(tallies.begin(), tallies.end(),
+                     [](const TopicTally& a, const TopicTally& b) { return a.total_votes > b.total_votes; });
 
-        if (!r.empty()) {
-            nlohmann::json user_data;
-            const auto& row = r[0];
-            user_data["id"] = row["id"].as<std::string>();
-            user_data["username"] = row["username"].as<std::string>();
-            user_data["reputation"] = row["reputation"].as<int>();
-            user_data["created_at"] = row["created_at"].as<std::string>();
-            return user_data;
-        }
-        return nlohmann::json();
-    } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in getUserDetails: " << e.what() << std::endl;
-        throw;
+    out.beginArray();
+    for (const auto& tally : tallies) {
+        const std::string* topicName = resolveTopicName(tally.topic_id);
+        out.beginObject();
+        out.key("topic_id").value(tally.topic_id);
+        out.key("topic_name").value(topicName ? std::string_view(*topicName) : std::string_view());
+        out.key("total_votes").value(tally.total_votes);
+        out.endObject();
     }
+    out.endArray();
 }
 
-int Database::getUserSubmissionsCount(const std::string &userId) {
-    try {
-        pqxx::work txn(getConnection());
-        pqxx::result r = txn.exec_prepared("get_user_submissions_count", userId);
+std::string Database::getAggregatedTopicsForVideos(const std::vector<std::string>& videoIds) {
+    std::vector<std::vector<TopicTally>> tallies(videoIds.size());
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < videoIds.size(); ++i) {
+        if (!tallyCache.get(videoIds[i], tallies[i])) {
+            missing.push_back(i);
+        }
+    }
 
-        if (!r.empty()) {
-            return r[0][0].as<int>();
+    if (!missing.empty()) {
+        try {
+            std::vector<std::string> missingIds;
+            std::vector<uint64_t> tokens;
+            std::vector<std::string> unkeyed;
+            std::vector<int64_t> keys;
+            std::unordered_map<int64_t, size_t> slot;
+            for (size_t i : missing) {
+                missingIds.push_back(videoIds[i]);
+                tokens.push_back(tallyCache.loadToken(videoIds[i]));
+                int64_t key;
+                if (videoKeys.get(videoIds[i], key)) {
+                    keys.push_back(key);
+                    slot.emplace(key, i);
+                } else {
+                    unkeyed.push_back(videoIds[i]);
+                }
+            }
+
+            // One round trip for every tally cache miss on the page, plus one for key cache misses
+            auto conn = getConnection();
+            pqxx::work txn(*conn);
+            if (!unkeyed.empty()) {
+                std::unordered_map<std::string, size_t> index;
+                for (size_t i : missing) {
+                    index.emplace(videoIds[i], i);
+                }
+                pqxx::result r = execPrepared(txn, "get_video_keys", formatPgTextArray(unkeyed));
+                for (const auto& row : r) {
+                    std::string id = row["id"].as<std::string>();
+                    int64_t key = row["video_key"].as<int64_t>();
+                    videoKeys.put(id, key);
+                    keys.push_back(key);
+                    slot.emplace(key, index[id]);
+                }
+            }
+            pqxx::result r = keys.empty() ? pqxx::result()
+                : execPrepared(txn, "get_aggregated_topics_for_videos", formatPgIntArray(keys));
+            for (const auto& row : r) {
+                auto it = slot.find(row["video_key"].as<int64_t>());
+                if (it != slot.end()) {
+                    tallies[it->second].push_back(TopicTally{row["topic_id"].as<int>(), row["total_votes"].as<int>(), row["voter_count"].as<int>()});
+                }
+            }
+            for (size_t j = 0; j < missing.size(); ++j) {
+                if (votePipeline) {
+                    votePipeline->addPending(missingIds[j], tallies[missing[j]]);
+                }
+                tallyCache.put(missingIds[j], tallies[missing[j]], tokens[j]);
+            }
+        } catch (const pqxx::sql_error &e) {
+            LOG_ERROR("Error in getAggregatedTopicsForVideos: " << e.what());
+            throw;
         }
-        return 0;
-    } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in getUserSubmissionsCount: " << e.what() << std::endl;
-        throw;
     }
+
+    size_t topic_count = 0;
+    for (const auto& t : tallies) {
+        topic_count += t.size();
+    }
+    JsonWriter out(16 + videoIds.size() * 48 + topic_count * TOPIC_JSON_BYTES);
+    out.beginObject();
+    out.key("videos").beginArray();
+    for (size_t i = 0; i < videoIds.size(); ++i) {
+        out.beginObject();
+        out.key("topics");
+        writeTopics(out, tallies[i]);
+        out.key("video_id").value(videoIds[i]);
+        out.endObject();
+    }
+    out.endArray();
+    out.endObject();
+    return out.take();
 }
 
-std::string Database::getUserLastSubmissionDate(const std::string &userId) {
-    try {
-        pqxx::work txn(getConnection());
-        pqxx::result r = txn.exec_prepared("get_user_last_submission_date", userId);
+std::string Database::getSimilarVideos(const std::string& videoId, int limit) {
+    limit = std::max(1, std::min(limit, static_cast<int>(MAX_SIMILAR_VIDEOS_LIMIT)));
 
-        if (!r.empty()) {
-            return r[0][0].as<std::string>();
-        }
-        return "";
-    } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in getUserLastSubmissionDate: " << e.what() << std::endl;
-        throw;
+    std::vector<TopicOverlap> overlaps = topicIndex.similar(videoId, limit);
+    std::vector<std::string> ids;
+    for (const TopicOverlap& o : overlaps) {
+        ids.push_back(o.video_id);
+    }
+    fillVideoCatalog(ids);
+    JsonWriter out(2 + overlaps.size() * SIMILAR_VIDEO_JSON_BYTES);
+    out.beginArray();
+    for (const TopicOverlap& o : overlaps) {
+        VideoInfo info;
+        videoCatalog.get(o.video_id, info);
+        out.beginObject();
+        out.key("shared_topics_count").value(o.shared_topics);
+        out.key("title").value(info.title);
+        out.key("video_id").value(o.video_id);
+        out.endObject();
     }
+    out.endArray();
+    return out.take();
 }
 
-nlohmann::json Database::getUserMostFrequentTag(const std::string &userId) {
+nlohmann::json Database::getUserStats(const std::string &userId) {
     try {
-        pqxx::work txn(getConnection());
-        pqxx::result r = txn.exec_prepared("get_user_most_frequent_tag", userId);
+        pqxx::result r;
+        {
+            auto conn = getConnection();
+            pqxx::work txn(*conn);
+            r = execPrepared(txn, "get_user_stats", userId);
+        }
+        if (r.empty()) {
+            return nlohmann::json();
+        }
 
-        if (!r.empty()) {
-            nlohmann::json tag_data;
-            const auto& row = r[0];
-            tag_data["topic_name"] = row["topic_name"].as<std::string>();
-            tag_data["topic_count"] = row["topic_count"].as<int>();
-            return tag_data;
+        const auto& row = r[0];
+        nlohmann::json stats;
+        stats["user_id"] = row["id"].as<std::string>();
+        stats["username"] = row["username"].is_null() ? nullptr : row["username"].c_str();
+        stats["reputation"] = row["reputation"].is_null() ? 0 : row["reputation"].as<int>();
+        stats["created_at"] = row["created_at"].as<std::string>();
+        stats["submissions_count"] = row["submissions_count"].as<int>();
+        stats["last_submission_date"] = row["last_submission_at"].is_null() ? "" : row["last_submission_at"].as<std::string>();
+        stats["most_frequent_tag"] = nullptr;
+        if (!row["top_topic_id"].is_null()) {
+            const std::string* name = resolveTopicName(row["top_topic_id"].as<int>());
+            if (name) {
+                stats["most_frequent_tag"] = {{"topic_name", *name}, {"topic_count", row["top_topic_count"].as<int>()}};
+            }
         }
-        return nlohmann::json();
+        return stats;
     } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in getUserMostFrequentTag: " << e.what() << std::endl;
+        LOG_ERROR("Error in getUserStats: " << e.what());
         throw;
     }
 }
 
-nlohmann::json Database::getAllUsersWithContributionCounts() {
-    nlohmann::json users_list = nlohmann::json::array();
-    try {
-        pqxx::work txn(getConnection());
-        pqxx::result r = txn.exec(
-            "SELECT u.id, u.username, COUNT(vt.user_id) AS contributions_count "
-            "FROM users u "
-            "LEFT JOIN video_topics vt ON u.id = vt.user_id "
-            "GROUP BY u.id, u.username "
-            "ORDER BY contributions_count DESC, u.username ASC"
-        );
+namespace {
 
-        for (const auto& row : r) {
-            nlohmann::json user_data;
-            user_data["id"] = row["id"].as<std::string>();
-            user_data["username"] = row["username"].as<std::string>();
-            user_data["contributions_count"] = row["contributions_count"].as<int>();
-            users_list.push_back(user_data);
-        }
-    } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in getAllUsersWithContributionCounts: " << e.what() << std::endl;
-        throw;
+nlohmann::json leaderboardJson(const LeaderboardEntry& entry) {
+    nlohmann::json user_data;
+    user_data["id"] = entry.user_id;
+    user_data["username"] = optionalJson(entry.username);
+    user_data["contributions_count"] = entry.contributions;
+    user_data["rank"] = entry.rank;
+    return user_data;
+}
+
+} // namespace
+
+std::string Database::getUserContributions(size_t offset, size_t limit) {
+    std::vector<LeaderboardEntry> entries = leaderboard.page(offset, limit);
+    JsonWriter out(2 + entries.size() * USER_JSON_BYTES);
+    out.beginArray();
+    for (const LeaderboardEntry& entry : entries) {
+        out.beginObject();
+        out.key("contributions_count").value(entry.contributions);
+        out.key("id").value(entry.user_id);
+        out.key("rank").value(entry.rank);
+        out.key("username").value(entry.username);
+        out.endObject();
     }
-    return users_list;
+    out.endArray();
+    return out.take();
+}
+
+size_t Database::getContributorCount() {
+    return leaderboard.size();
+}
+
+nlohmann::json Database::getUserRank(const std::string &userId) {
+    LeaderboardEntry entry;
+    if (!leaderboard.find(userId, entry)) {
+        return nlohmann::json();
+    }
+    nlohmann::json rank = leaderboardJson(entry);
+    rank["user_id"] = rank["id"];
+    rank.erase("id");
+    rank["total"] = leaderboard.size();
+    return rank;
 }
 
 void Database::upsertUser(const std::string &userId, const std::string &username) {
     try {
-        pqxx::work txn(getConnection());
+        auto conn = getConnection();
+        pqxx::work txn(*conn);
         if (username.empty()) {
-            txn.exec_prepared("upsert_user_no_username", userId);
+            execPrepared(txn, "upsert_user_no_username", userId);
         } else {
-            txn.exec_prepared("upsert_user", userId, username);
+            execPrepared(txn, "upsert_user", userId, username);
         }
         txn.commit();
+        if (username.empty()) {
+            leaderboard.adjust(userId, 0); // adds the user if new, keeps any username
+        } else {
+            leaderboard.setUsername(userId, username);
+        }
     } catch (const pqxx::sql_error &e) {
-        std::cerr << "Error in upsertUser: " << e.what() << std::endl;
+        LOG_ERROR("Error in upsertUser: " << e.what());
         throw;
     }
 }
 
-// Async implementations
+// Async implementations - run on the bounded executor
 std::future<nlohmann::json> Database::getVideoByIdAsync(const std::string& videoId) {
-    return std::async(std::launch::async, [this, videoId]() {
+    return executor.submit([this, videoId]() {
         return this->getVideoById(videoId);
     });
 }
 
 std::future<nlohmann::json> Database::insertVideoAsync(const std::string& videoId, const std::string& title) {
-    return std::async(std::launch::async, [this, videoId, title]() {
+    return executor.submit([this, videoId, title]() {
         return this->insertVideo(videoId, title);
     });
 }
 
 std::future<nlohmann::json> Database::getTopicByNameAsync(const std::string& topicName) {
-    return std::async(std::launch::async, [this, topicName]() {
+    return executor.submit([this, topicName]() {
         return this->getTopicByName(topicName);
     });
 }
 
 std::future<int> Database::insertTopicAsync(const std::string& topicName) {
-    return std::async(std::launch::async, [this, topicName]() {
+    return executor.submit([this, topicName]() {
         return this->insertTopic(topicName);
     });
 }
 
-std::future<nlohmann::json> Database::getAggregatedTopicsForVideoAsync(const std::string& videoId) {
-    return std::async(std::launch::async, [this, videoId]() {
+std::future<std::string> Database::getAggregatedTopicsForVideoAsync(const std::string& videoId) {
+    return executor.submit([this, videoId]() {
         return this->getAggregatedTopicsForVideo(videoId);
     });
 }
 
-std::future<nlohmann::json> Database::getSimilarVideosAsync(const std::string& videoId) {
-    return std::async(std::launch::async, [this, videoId]() {
-        return this->getSimilarVideos(videoId);
-    });
-}
-
-std::future<nlohmann::json> Database::getUserDetailsAsync(const std::string& userId) {
-    return std::async(std::launch::async, [this, userId]() {
-        return this->getUserDetails(userId);
-    });
-}
-
-std::future<int> Database::getUserSubmissionsCountAsync(const std::string& userId) {
-    return std::async(std::launch::async, [this, userId]() {
-        return this->getUserSubmissionsCount(userId);
-    });
-}
-
-std::future<std::string> Database::getUserLastSubmissionDateAsync(const std::string& userId) {
-    return std::async(std::launch::async, [this, userId]() {
-        return this->getUserLastSubmissionDate(userId);
+std::future<std::string> Database::getSimilarVideosAsync(const std::string& videoId, int limit) {
+    return executor.submit([this, videoId, limit]() {
+        return this->getSimilarVideos(videoId, limit);
     });
 }
 
-std::future<nlohmann::json> Database::getUserMostFrequentTagAsync(const std::string& userId) {
-    return std::async(std::launch::async, [this, userId]() {
-        return this->getUserMostFrequentTag(userId);
+std::future<nlohmann::json> Database::getUserStatsAsync(const std::string& userId) {
+    return executor.submit([this, userId]() {
+        return this->getUserStats(userId);
     });
 }
 
 std::future<void> Database::upsertUserAsync(const std::string& userId, const std::string& username) {
-    return std::async(std::launch::async, [this, userId, username]() {
+    return executor.submit([this, userId, username]() {
         this->upsertUser(userId, username);
     });
 }
 
-std::future<void> Database::updateVideoEmbeddingAsync(const std::string& videoId, const std::vector<float>& embedding) {
-    return std::async(std::launch::async, [this, videoId, embedding]() {
-        this->updateVideoEmbedding(videoId, embedding);
+std::future<void> Database::updateVideoEmbeddingAsync(const std::string& videoId, PooledFloats embedding) {
+    return executor.submit([this, videoId, embedding = std::move(embedding)]() {
+        this->updateVideoEmbedding(videoId, *embedding);
     });
 }
 
-std::future<nlohmann::json> Database::getSimilarVideosByVectorAsync(const std::string& videoId, int limit) {
-    return std::async(std::launch::async, [this, videoId, limit]() {
-        return this->getSimilarVideosByVector(videoId, limit);
+std::future<std::string> Database::getSimilarVideosByVectorAsync(const std::string& videoId, int limit,
+                                                                double minSimilarity, int probes, int ef) {
+    return executor.submit([this, videoId, limit, minSimilarity, probes, ef]() {
+        return this->getSimilarVideosByVector(videoId, limit, minSimilarity, probes, ef);
     });
 }
\ No newline at end of file
@@ -1,43 +1,159 @@
 #ifndef DATABASE_H
 #define DATABASE_H
 
+#include <atomic>
 #include <memory>
+#include <thread>
 #include <pqxx/pqxx>
 using namespace pqxx;
 #include <nlohmann/json.hpp>
 #include <string>
 #include <future>
-#include <boost/asio.hpp>
-#include <boost/asio/thread_pool.hpp>
+#include "config.h"
+#include "connection_pool.h"
+#include "executor.h"
+#include "topic_dictionary.h"
+#include "tally_cache.h"
+#include "topic_index.h"
+#include "embedding_store.h"
+#include "float_buffer_pool.h"
+#include "hnsw_index.h"
+#include "json_writer.h"
+#include "key_cache.h"
+#include "leaderboard.h"
+#include "video_catalog.h"
+#include "video_versions.h"
+#include "vote_pipeline.h"
 
 class Database {
 private:
-  std::unique_ptr<pqxx::connection> conn;
-  boost::asio::thread_pool thread_pool;
+  std::unique_ptr<ConnectionPool> pool;
+  std::unique_ptr<EmbeddingStore> embeddingStore; // null when EMBEDDING_SNAPSHOT_PATH is empty; outlives executor tasks
+  // ~Database calls executor.shutdown() first, so queued tasks finish before any member they
+  // touch is destroyed; declaration order alone would only protect pool and embeddingStore
+  Executor executor;
+  TopicDictionary topics;
+  TallyCache tallyCache;
+  TopicIndex topicIndex;
+  Leaderboard leaderboard;
+  std::unique_ptr<VotePipeline> votePipeline; // null unless VOTE_WRITE_BEHIND
+  std::atomic<uint64_t> skippedVotes{0}; // write-back rows naming a video or topic that no longer exists
+  VideoCatalog videoCatalog;
+  KeyCache videoKeys; // videos.id -> videos.video_key
+  KeyCache userKeys;  // users.id -> users.user_key
+  VideoVersions videoVersions; // bumped by every vote and embedding write, for ETags
+  HnswIndex vectorIndex;
+  std::atomic<bool> vectorIndexReady{false}; // similar_by_vector uses Postgres until the load finishes
+  std::atomic<bool> embeddingStoreReady{false}; // ...or brute force over the snapshot once it is caught up
+  std::atomic<bool> shuttingDown{false};
+  std::thread vectorIndexLoader;
 
   void connect();
   void createTables();
+  static void prepareStatements(pqxx::connection& c);
+  void loadTopicDictionary();
+  // Fill the topic -> videos index from video_topic_scores
+  void loadTopicIndex();
+  // Rank every user by contributions (user_stats.submissions_count)
+  void loadLeaderboard();
+  // Runs on vectorIndexLoader: opens the embedding snapshot, catches it up with embeddings
+  // written since, then builds the HNSW index from it (or straight from Postgres without one)
+  void loadVectorIndex();
+  uint64_t getMaxEmbeddingVersion();
+  // Re-score index candidates with the snapshot's float32 vectors
+  void rerankNeighbours(const std::string& videoId, std::vector<HnswResult>& neighbours);
+  // Similarity of videoId's embedding to each of others, from the snapshot's float32 vectors
+  // or the HNSW index; nullopt where unknown
+  void vectorSimilarities(const std::string& videoId, const std::vector<std::string>& others,
+                          std::vector<std::optional<float>>& out);
+  // Fetch titles of result videos the catalog doesn't know yet
+  void fillVideoCatalog(const std::vector<std::string>& videoIds);
+
+  // Topic lookups served from the dictionary, falling back to the topics table on a miss
+  int resolveTopicId(const std::string& topicName);
+  const std::string* resolveTopicName(int topicId);
+
+  // Surrogate key of videoId's row from the key cache, else from Postgres; nullopt if
+  // there is no such video. txn must not be the one that inserted the row.
+  std::optional<int64_t> resolveVideoKey(pqxx::transaction_base& txn, const std::string& videoId);
+  // Key of userId's row, creating the row if needed. Takes a nontransaction so the row is
+  // committed, and safe to cache, by the time the key is returned.
+  int64_t internUser(pqxx::nontransaction& txn, const std::string& userId);
+
+  // Sort tallies by total votes and write them, with topic names, as a JSON array
+  void writeTopics(JsonWriter& out, std::vector<TopicTally>& tallies);
+  // Nearest neighbours of videoId by embedding (see getSimilarVideosByVector), with their
+  // titles in the video catalog. limit is not capped at MAX_SIMILAR_BY_VECTOR_LIMIT, so the
+  // hybrid ranking gets its full limit * HYBRID_CANDIDATE_FACTOR candidates.
+  std::vector<HnswResult> similarByVector(const std::string& videoId, int limit, double minSimilarity,
+                                          int probes, int ef);
+
+  // Apply a committed (or, write-behind, logged) vote (submitVote result) to the in-memory caches
+  void onVoteCommitted(const std::string& videoId, const nlohmann::json& vote);
+
+  // Write-behind half of submitVote: decide the vote against the pipeline's pending row or
+  // Postgres, log and apply it, and return once the log is on disk
+  nlohmann::json queueVote(const std::string& videoId, int topicId, const std::string& userId, int desiredVote);
+  // VotePipeline writer: upsert/delete the newest row per key in one transaction
+  void writeVotes(const std::vector<VoteRecord>& records);
 
 public:
   Database();
   ~Database();
 
-  // Get PostgreSQL connection for database operations
-  pqxx::connection& getConnection();
+  // Check out a pooled PostgreSQL connection; returned to the pool when the handle goes out of scope
+  PooledConnection getConnection();
+
+  // Connection pool usage and wait counters
+  nlohmann::json getPoolStats();
+
+  // Bounded executor backing the *Async methods
+  Executor& getExecutor();
+  nlohmann::json getExecutorStats();
+
+  // Per-video topic tally cache hit/miss/eviction counters
+  nlohmann::json getTallyCacheStats();
 
-  // Async versions of database operations
+  // Write-behind vote queue, batch and log counters ({"enabled": false} when off)
+  nlohmann::json getVotePipelineStats();
+
+  // Video and user id -> surrogate key cache counters
+  nlohmann::json getKeyCacheStats();
+
+  // ETag of GET /videos/:id and GET /videos/:id/topics, from memory. Read it before the data
+  // it labels: a write in between then only makes the next request revalidate.
+  std::string getVideoEtag(const std::string& videoId);
+
+  // Topic -> videos index size and query counters
+  nlohmann::json getTopicIndexStats();
+
+  // HNSW index size, load state and search counters, plus the embedding snapshot
+  nlohmann::json getVectorIndexStats();
+
+  // Async versions of database operations. List endpoints return their serialized response
+  // body, written with JsonWriter rather than built as an nlohmann::json tree.
   std::future<nlohmann::json> getVideoByIdAsync(const std::string& videoId);
   std::future<nlohmann::json> insertVideoAsync(const std::string& videoId, const std::string& title = "");
   std::future<nlohmann::json> getTopicByNameAsync(const std::string& topicName);
   std::future<int> insertTopicAsync(const std::string& topicName);
-  std::future<nlohmann::json> getAggregatedTopicsForVideoAsync(const std::string& videoId);
-  std::future<nlohmann::json> getSimilarVideosAsync(const std::string& videoId);
-  std::future<void> updateVideoEmbeddingAsync(const std::string& videoId, const std::vector<float>& embedding);
-  std::future<nlohmann::json> getSimilarVideosByVectorAsync(const std::string& videoId, int limit = 10);
-  std::future<nlohmann::json> getUserDetailsAsync(const std::string& userId);
-  std::future<int> getUserSubmissionsCountAsync(const std::string& userId);
-  std::future<std::string> getUserLastSubmissionDateAsync(const std::string& userId);
-  std::future<nlohmann::json> getUserMostFrequentTagAsync(const std::string& userId);
+  std::future<std::string> getAggregatedTopicsForVideoAsync(const std::string& videoId);
+  std::future<std::string> getSimilarVideosAsync(const std::string& videoId,
+                                                 int limit = SIMILAR_VIDEOS_DEFAULT_LIMIT);
+  // Takes the decoded upload buffer; it goes back to its pool when the update is done
+  std::future<void> updateVideoEmbeddingAsync(const std::string& videoId, PooledFloats embedding);
+  // Top-`limit` nearest neighbours by cosine similarity, from the in-process HNSW index once
+  // it is loaded, else from Postgres. minSimilarity of -1 disables the threshold. ef > 0
+  // overrides the HNSW search width; probes > 0 overrides ivfflat.probes on the Postgres path.
+  std::future<std::string> getSimilarVideosByVectorAsync(const std::string& videoId, int limit = 10,
+                                                         double minSimilarity = -1.0, int probes = 0,
+                                                         int ef = 0);
+  // Top-`limit` videos by topicWeight * (shared topics / topics of videoId) + vectorWeight *
+  // max(0, cosine similarity), over the union of both sources' candidates. Both candidate lists
+  // are generated concurrently on the executor, so call this from a request thread.
+  std::string getSimilarVideosHybrid(const std::string& videoId, int limit = SIMILAR_VIDEOS_DEFAULT_LIMIT,
+                                     double topicWeight = HYBRID_TOPIC_WEIGHT,
+                                     double vectorWeight = HYBRID_VECTOR_WEIGHT);
+  std::future<nlohmann::json> getUserStatsAsync(const std::string& userId);
   std::future<void> upsertUserAsync(const std::string& userId, const std::string& username = "");
 
   nlohmann::json getVideoById(const std::string &videoId);
@@ -45,28 +161,38 @@ public:
                              const std::string &title);
 
   nlohmann::json getTopicByName(const std::string &topicName);
+  nlohmann::json getTopicById(int topicId);
+  // Get-or-create: returns the existing id if a concurrent insert won the UNIQUE race
   int insertTopic(const std::string &topicName);
 
-  nlohmann::json getVideoTopicVote(const std::string &videoId, int topicId,
-                                   const std::string &userId);
-  void updateVideoTopicVote(const std::string &videoId, int topicId,
-                            const std::string &userId, int vote);
-  void insertVideoTopicVote(const std::string &videoId, int topicId,
-                            const std::string &userId, int vote);
-
-  nlohmann::json getAggregatedTopicsForVideo(const std::string &videoId);
-  nlohmann::json getSimilarVideos(const std::string &videoId);
-
-  // New functions for user stats
-  nlohmann::json getUserDetails(const std::string &userId);
-  int getUserSubmissionsCount(const std::string &userId);
-  std::string getUserLastSubmissionDate(const std::string &userId);
-  nlohmann::json getUserMostFrequentTag(const std::string &userId);
-  nlohmann::json getAllUsersWithContributionCounts();
+  // Resolve the topic (by name, else by id) through the topic dictionary, then upsert the
+  // user and toggle/update/insert the vote atomically. Returns {action, topic_id, user_id,
+  // previous_vote, vote}, or null if topicId names no existing topic; throws NotFound for an
+  // unknown video. With VOTE_WRITE_BEHIND the vote is only logged and the result has queued: true,
+  // plus durable: false if the log could not be synced (the vote is still applied and queued).
+  nlohmann::json submitVote(const std::string &videoId, const std::string &topicName,
+                            int topicId, const std::string &userId, int desiredVote);
+
+  // {"video_id", "topics": [...]}
+  std::string getAggregatedTopicsForVideo(const std::string &videoId);
+  // {"videos": [{"video_id", "topics"}, ...]}: tallies for many videos (cache first, one query
+  // for all misses), in request order
+  std::string getAggregatedTopicsForVideos(const std::vector<std::string> &videoIds);
+  // Videos sharing the most topics with videoId, from the in-memory topic index
+  std::string getSimilarVideos(const std::string &videoId, int limit = SIMILAR_VIDEOS_DEFAULT_LIMIT);
+
+  // User profile plus vote summary (submissions_count, last_submission_date, most_frequent_tag)
+  // from the trigger-maintained user_stats/user_topic_counts tables; null if the user doesn't exist
+  nlohmann::json getUserStats(const std::string &userId);
+  // Users ranked offset + 1 .. offset + limit by contributions, from the in-memory leaderboard
+  std::string getUserContributions(size_t offset, size_t limit);
+  size_t getContributorCount();
+  // {user_id, username, contributions_count, rank}, or null for an unknown user
+  nlohmann::json getUserRank(const std::string &userId);
   void upsertUser(const std::string &userId, const std::string &username = "");
-  void deleteVideoTopicVote(const std::string &videoId, int topicId, const std::string &userId);
   void updateVideoEmbedding(const std::string& videoId, const std::vector<float>& embedding);
-  nlohmann::json getSimilarVideosByVector(const std::string& videoId, int limit = 10);
+  std::string getSimilarVideosByVector(const std::string& videoId, int limit = 10,
+                                       double minSimilarity = -1.0, int probes = 0, int ef = 0);
 };
 
 #endif // DATABASE_H
@@ -0,0 +1,170 @@
+#include "embedding_parser.h"
+#include <nlohmann/json.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+// Stores the numbers of the top-level "embedding" array as they are lexed and
+// stops the parse (by returning false) at the first event that can't be valid.
+class EmbeddingSax {
+public:
+    EmbeddingSax(float* out, size_t dim, std::string& error) : out(out), dim(dim), error(error) {}
+
+    bool null() { return scalar(); }
+    bool boolean(bool) { return scalar(); }
+    bool number_integer(nlohmann::json::number_integer_t v) { return number(static_cast<double>(v)); }
+    bool number_unsigned(nlohmann::json::number_unsigned_t v) { return number(static_cast<double>(v)); }
+    bool number_float(nlohmann::json::number_float_t v, const std::string&) { return number(v); }
+    bool string(std::string&) { return scalar(); }
+    bool binary(nlohmann::json::binary_t&) { return scalar(); }
+
+    bool start_object(size_t) {
+        if (depth == 0) {
+            ++depth;
+            return true;
+        }
+        return container();
+    }
+    bool key(std::string& name) {
+        if (depth == 1) {
+            next_is_embedding = name == "embedding";
+            if (next_is_embedding && seen) {
+                return fail("embedding must appear once.");
+            }
+        }
+        return true;
+    }
+    bool end_object() {
+        --depth;
+        return true;
+    }
+    bool start_array(size_t) {
+        if (depth == 1 && next_is_embedding) {
+            next_is_embedding = false;
+            in_embedding = true;
+            seen = true;
+            ++depth;
+            return true;
+        }
+        return container();
+    }
+    bool end_array() {
+        if (in_embedding && depth == 2) {
+            in_embedding = false;
+        }
+        --depth;
+        return true;
+    }
+
+    bool parse_error(size_t, const std::string&, const nlohmann::detail::exception&) {
+        if (error.empty()) {
+            error = "Invalid JSON body.";
+        }
+        return false;
+    }
+
+    bool finish() {
+        if (!seen) {
+            return fail("embedding array is required.");
+        }
+        if (count != dim) {
+            return wrongSize();
+        }
+        return true;
+    }
+
+private:
+    bool number(double v) {
+        if (in_embedding && depth == 2) {
+            if (count == dim) {
+                return wrongSize();
+            }
+            float f = static_cast<float>(v);
+            if (!std::isfinite(f)) {
+                return fail("embedding values must be finite float32 numbers.");
+            }
+            out[count++] = f;
+            return true;
+        }
+        return scalar();
+    }
+    bool scalar() {
+        if (depth == 0) {
+            return fail("Request body must be a JSON object.");
+        }
+        if (in_embedding && depth == 2) {
+            return fail("embedding must be an array of numbers.");
+        }
+        if (depth == 1 && next_is_embedding) {
+            return fail("embedding must be an array of numbers.");
+        }
+        return true;
+    }
+    bool container() {
+        if (depth == 0) {
+            return fail("Request body must be a JSON object.");
+        }
+        if ((in_embedding && depth == 2) || (depth == 1 && next_is_embedding)) {
+            return fail("embedding must be an array of numbers.");
+        }
+        ++depth;
+        return true;
+    }
+    bool wrongSize() {
+        return fail("Invalid embedding size. Expected " + std::to_string(dim) + " dimensions.");
+    }
+    bool fail(std::string message) {
+        error = std::move(message);
+        return false;
+    }
+
+    float* out;
+    size_t dim;
+    std::string& error;
+    size_t count = 0;
+    int depth = 0;
+    bool next_is_embedding = false;
+    bool in_embedding = false;
+    bool seen = false;
+};
+
+} // namespace
+
+bool parseEmbeddingJson(std::string_view body, float* out, size_t dim, std::string& error) {
+    error.clear();
+    EmbeddingSax sax(out, dim, error);
+    if (!nlohmann::json::sax_parse(body.data(), body.data() + body.size(), &sax)) {
+        if (error.empty()) {
+            error = "Invalid JSON body.";
+        }
+        return false;
+    }
+    return sax.finish();
+}
+
+bool parseEmbeddingFloat32(std::string_view body, float* out, size_t dim, std::string& error) {
+    if (body.size() != dim * sizeof(float)) {
+        error = "Invalid embedding size. Expected " + std::to_string(dim) + " float32 values (" +
+                std::to_string(dim * sizeof(float)) + " bytes).";
+        return false;
+    }
+    std::memcpy(out, body.data(), body.size());
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (size_t i = 0; i < dim; ++i) {
+        uint32_t bits;
+        std::memcpy(&bits, &out[i], sizeof(bits));
+        bits = __builtin_bswap32(bits);
+        std::memcpy(&out[i], &bits, sizeof(bits));
+    }
+#endif
+    for (size_t i = 0; i < dim; ++i) {
+        if (!std::isfinite(out[i])) {
+            error = "embedding values must be finite float32 numbers.";
+            return false;
+        }
+    }
+    error.clear();
+    return true;
+}
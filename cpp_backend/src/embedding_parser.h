@@ -0,0 +1,18 @@
+#ifndef EMBEDDING_PARSER_H
+#define EMBEDDING_PARSER_H
+
+#include <string>
+#include <string_view>
+
+// Request body decoders for POST /videos/:id/embedding. Both write straight into
+// a caller-provided buffer of exactly `dim` floats, accept only finite values
+// and, on failure, return false with a message for the 400 response.
+
+// {"embedding": [x, ...]} with exactly dim numbers; other top-level keys are
+// ignored. Parsed as SAX events, so no JSON DOM or intermediate vector is built.
+bool parseEmbeddingJson(std::string_view body, float* out, size_t dim, std::string& error);
+
+// Exactly dim little-endian IEEE 754 float32 values (application/octet-stream)
+bool parseEmbeddingFloat32(std::string_view body, float* out, size_t dim, std::string& error);
+
+#endif // EMBEDDING_PARSER_H
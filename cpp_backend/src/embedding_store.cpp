@@ -0,0 +1,530 @@
+#include "embedding_store.h"
+#include "config.h"
+#include "vector_math.h"
+#include "logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <queue>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace {
+
+constexpr char FILE_MAGIC[8] = {'Y', 'T', 'E', 'M', 'B', '0', '1', '\0'};
+constexpr size_t FILE_HEADER_SIZE = 32;
+constexpr size_t RECORD_HEADER_SIZE = 24;
+constexpr uint16_t FLAG_VALUES = 1;
+constexpr size_t MIN_MAP_SIZE = 64u << 20;
+constexpr size_t COPY_BUFFER_SIZE = 1u << 20;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t dim;
+    uint32_t flags;
+    uint8_t reserved[16];
+};
+static_assert(sizeof(FileHeader) == FILE_HEADER_SIZE, "file header layout");
+
+struct RecordHeader {
+    uint32_t length;
+    uint32_t crc;
+    uint64_t version;
+    float scale;
+    uint16_t label_len;
+    uint16_t flags;
+};
+static_assert(sizeof(RecordHeader) == RECORD_HEADER_SIZE, "record header layout");
+
+size_t alignUp(size_t n, size_t a) {
+    return (n + a - 1) / a * a;
+}
+
+// Covers everything after the length and crc fields
+uint32_t recordCrc(const char* record, size_t length) {
+    return static_cast<uint32_t>(crc32(0L, reinterpret_cast<const Bytef*>(record + 8), static_cast<uInt>(length - 8)));
+}
+
+bool writeAll(int fd, const char* data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = ::pwrite(fd, data, len, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+RecordHeader headerAt(const char* record) {
+    RecordHeader h;
+    std::memcpy(&h, record, sizeof(h));
+    return h;
+}
+
+} // namespace
+
+EmbeddingStore::EmbeddingStore(std::string path, size_t dim, bool keep_float)
+    : path(std::move(path)), dimension(dim), keep_float(keep_float) {}
+
+EmbeddingStore::~EmbeddingStore() {
+    closeFile();
+}
+
+size_t EmbeddingStore::codesOffset(size_t label_len) const {
+    return RECORD_HEADER_SIZE + alignUp(label_len, 4);
+}
+
+size_t EmbeddingStore::valuesOffset(size_t label_len) const {
+    return codesOffset(label_len) + alignUp(dimension, 4);
+}
+
+size_t EmbeddingStore::recordSize(size_t label_len) const {
+    return alignUp(valuesOffset(label_len) + (keep_float ? dimension * sizeof(float) : 0), 8);
+}
+
+bool EmbeddingStore::validRecord(uint64_t offset, uint64_t limit) const {
+    if (offset + RECORD_HEADER_SIZE > limit) {
+        return false;
+    }
+    RecordHeader h = headerAt(map + offset);
+    if (h.length != recordSize(h.label_len) || offset + h.length > limit) {
+        return false;
+    }
+    if ((h.flags & FLAG_VALUES) != (keep_float ? FLAG_VALUES : 0)) {
+        return false;
+    }
+    return recordCrc(map + offset, h.length) == h.crc;
+}
+
+void EmbeddingStore::remap(uint64_t min_size) {
+    if (map) {
+        ::munmap(const_cast<char*>(map), map_size);
+        map = nullptr;
+    }
+    // Map well past EOF so appends rarely need a remap; only bytes below
+    // file_size are ever read
+    size_t size = std::max<size_t>(MIN_MAP_SIZE, alignUp(static_cast<size_t>(min_size) * 2, 1u << 20));
+    void* p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        LOG_ERROR("Cannot mmap embedding snapshot " << path << ": " << std::strerror(errno));
+        ::close(fd);
+        fd = -1;
+        map_size = 0;
+        return;
+    }
+    map = static_cast<const char*>(p);
+    map_size = size;
+}
+
+void EmbeddingStore::closeFile() {
+    if (map) {
+        ::munmap(const_cast<char*>(map), map_size);
+        map = nullptr;
+        map_size = 0;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool EmbeddingStore::writeHeader(int target_fd) {
+    FileHeader h{};
+    std::memcpy(h.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    h.dim = static_cast<uint32_t>(dimension);
+    h.flags = keep_float ? FLAG_VALUES : 0;
+    return writeAll(target_fd, reinterpret_cast<const char*>(&h), sizeof(h), 0);
+}
+
+bool EmbeddingStore::open() {
+    std::lock_guard<std::mutex> writer(write_mutex);
+    std::unique_lock<std::shared_mutex> lock(map_mutex);
+    closeFile();
+
+    std::error_code ec;
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent, ec);
+    }
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Cannot open embedding snapshot " << path << ": " << std::strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        LOG_ERROR("Cannot stat embedding snapshot " << path << ": " << std::strerror(errno));
+        closeFile();
+        return false;
+    }
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+
+    bool usable = size >= FILE_HEADER_SIZE;
+    if (usable) {
+        FileHeader h;
+        usable = ::pread(fd, &h, sizeof(h), 0) == static_cast<ssize_t>(sizeof(h)) &&
+                 std::memcmp(h.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0 &&
+                 h.dim == dimension && h.flags == (keep_float ? FLAG_VALUES : 0u);
+    }
+    if (!usable) {
+        if (size > 0) {
+            LOG_WARN("Embedding snapshot " << path << " has another format, starting a new one.");
+        }
+        if (::ftruncate(fd, 0) != 0 || !writeHeader(fd)) {
+            LOG_ERROR("Cannot initialize embedding snapshot " << path << ": " << std::strerror(errno));
+            closeFile();
+            return false;
+        }
+        size = FILE_HEADER_SIZE;
+    }
+
+    remap(size);
+    if (fd < 0) {
+        return false;
+    }
+
+    entries.clear();
+    records = 0;
+    max_version = 0;
+    ++generation;
+    uint64_t offset = FILE_HEADER_SIZE;
+    while (offset < size && validRecord(offset, size)) {
+        RecordHeader h = headerAt(map + offset);
+        std::string label(map + offset + RECORD_HEADER_SIZE, h.label_len);
+        auto it = entries.find(label);
+        if (it == entries.end()) {
+            entries.emplace(std::move(label), Entry{offset, h.version});
+        } else if (h.version >= it->second.version) {
+            it->second = {offset, h.version};
+        }
+        max_version = std::max(max_version, h.version);
+        ++records;
+        offset += h.length;
+    }
+    if (offset < size) {
+        // A crash mid-append leaves a partial record; everything from there on is dropped
+        LOG_WARN("Dropping " << (size - offset) << " bytes of incomplete records from " << path);
+        if (::ftruncate(fd, static_cast<off_t>(offset)) != 0) {
+            LOG_ERROR("Cannot truncate embedding snapshot: " << std::strerror(errno));
+        }
+    }
+    file_size = offset;
+    LOG_INFO("Opened embedding snapshot " << path << ": " << entries.size() << " videos in "
+             << records << " records (" << file_size << " bytes).");
+    return true;
+}
+
+void EmbeddingStore::clear() {
+    std::lock_guard<std::mutex> writer(write_mutex);
+    std::unique_lock<std::shared_mutex> lock(map_mutex);
+    if (fd < 0) {
+        return;
+    }
+    if (::ftruncate(fd, FILE_HEADER_SIZE) != 0) {
+        LOG_ERROR("Cannot truncate embedding snapshot: " << std::strerror(errno));
+    }
+    file_size = FILE_HEADER_SIZE;
+    entries.clear();
+    records = 0;
+    max_version = 0;
+    ++generation;
+}
+
+void EmbeddingStore::forEach(const Visitor& fn) const {
+    std::vector<std::string> labels;
+    {
+        std::shared_lock<std::shared_mutex> lock(map_mutex);
+        labels.reserve(entries.size());
+        for (const auto& entry : entries) {
+            labels.push_back(entry.first);
+        }
+    }
+
+    std::vector<int8_t> codes(dimension);
+    for (const std::string& label : labels) {
+        uint64_t version;
+        float scale;
+        {
+            // Look the label up again: compaction may have moved its record
+            std::shared_lock<std::shared_mutex> lock(map_mutex);
+            auto it = entries.find(label);
+            if (it == entries.end()) {
+                continue;
+            }
+            const char* record = map + it->second.offset;
+            RecordHeader h = headerAt(record);
+            version = h.version;
+            scale = h.scale;
+            std::memcpy(codes.data(), record + codesOffset(h.label_len), dimension);
+        }
+        fn(label, version, codes.data(), scale);
+    }
+}
+
+void EmbeddingStore::append(const std::string& label, uint64_t version, const float* vec) {
+    if (label.size() > UINT16_MAX) {
+        return;
+    }
+    thread_local std::vector<float> normalized;
+    thread_local std::vector<char> record;
+    normalized.assign(vec, vec + dimension);
+    normalizeVector(normalized.data(), dimension);
+
+    const size_t length = recordSize(label.size());
+    record.assign(length, 0);
+    RecordHeader h{};
+    h.length = static_cast<uint32_t>(length);
+    h.version = version;
+    h.label_len = static_cast<uint16_t>(label.size());
+    h.flags = keep_float ? FLAG_VALUES : 0;
+    h.scale = quantizeInt8(normalized.data(), dimension,
+                           reinterpret_cast<int8_t*>(record.data() + codesOffset(label.size())));
+    std::memcpy(record.data() + RECORD_HEADER_SIZE, label.data(), label.size());
+    if (keep_float) {
+        std::memcpy(record.data() + valuesOffset(label.size()), normalized.data(), dimension * sizeof(float));
+    }
+    std::memcpy(record.data(), &h, sizeof(h));
+    h.crc = recordCrc(record.data(), length);
+    std::memcpy(record.data(), &h, sizeof(h));
+
+    std::lock_guard<std::mutex> writer(write_mutex);
+    if (fd < 0) {
+        return;
+    }
+    const uint64_t offset = file_size;
+    if (!writeAll(fd, record.data(), length, offset)) {
+        LOG_ERROR("Error appending to embedding snapshot: " << std::strerror(errno));
+        // Cut off whatever part of the record made it to disk
+        if (::ftruncate(fd, static_cast<off_t>(offset)) != 0) {
+            LOG_ERROR("Cannot truncate embedding snapshot: " << std::strerror(errno));
+        }
+        return;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(map_mutex);
+    file_size = offset + length;
+    ++records;
+    if (file_size > map_size) {
+        remap(file_size);
+    }
+    auto it = entries.find(label);
+    if (it == entries.end()) {
+        entries.emplace(label, Entry{offset, version});
+    } else if (version >= it->second.version) {
+        it->second = {offset, version};
+    }
+    max_version = std::max(max_version, version);
+    appends.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool EmbeddingStore::values(const std::string& label, std::vector<float>& out) const {
+    if (!keep_float) {
+        return false;
+    }
+    std::shared_lock<std::shared_mutex> lock(map_mutex);
+    auto it = entries.find(label);
+    if (it == entries.end()) {
+        return false;
+    }
+    const char* record = map + it->second.offset;
+    const float* values = reinterpret_cast<const float*>(record + valuesOffset(headerAt(record).label_len));
+    out.assign(values, values + dimension);
+    return true;
+}
+
+bool EmbeddingStore::search(const std::string& label, size_t k, std::vector<HnswResult>& out) const {
+    std::shared_lock<std::shared_mutex> lock(map_mutex);
+    auto self = entries.find(label);
+    if (self == entries.end()) {
+        return false;
+    }
+    const char* query = map + self->second.offset;
+    const RecordHeader query_header = headerAt(query);
+    const int8_t* query_codes = reinterpret_cast<const int8_t*>(query + codesOffset(query_header.label_len));
+
+    // int8 pass keeps the best `candidates`, then float32 re-ranks them when available
+    const size_t candidates = keep_float ? k * HNSW_RERANK_FACTOR : k;
+    using Scored = std::pair<float, const std::string*>; // (-similarity, label)
+    std::priority_queue<Scored> best;
+    for (const auto& entry : entries) {
+        if (&entry == &*self) {
+            continue;
+        }
+        const char* record = map + entry.second.offset;
+        RecordHeader h = headerAt(record);
+        float similarity = query_header.scale * h.scale *
+            static_cast<float>(dotProductInt8(query_codes, reinterpret_cast<const int8_t*>(record + codesOffset(h.label_len)), dimension));
+        if (best.size() < candidates) {
+            best.emplace(-similarity, &entry.first);
+        } else if (candidates > 0 && -similarity < best.top().first) {
+            best.pop();
+            best.emplace(-similarity, &entry.first);
+        }
+    }
+
+    std::vector<Scored> ranked;
+    ranked.reserve(best.size());
+    while (!best.empty()) {
+        ranked.push_back(best.top());
+        best.pop();
+    }
+    if (keep_float) {
+        const float* query_values = reinterpret_cast<const float*>(query + valuesOffset(query_header.label_len));
+        for (Scored& s : ranked) {
+            const char* record = map + entries.find(*s.second)->second.offset;
+            const float* values = reinterpret_cast<const float*>(record + valuesOffset(headerAt(record).label_len));
+            s.first = -dotProduct(query_values, values, dimension);
+        }
+    }
+    std::sort(ranked.begin(), ranked.end());
+
+    out.clear();
+    for (size_t i = 0; i < ranked.size() && i < k; ++i) {
+        out.push_back({*ranked[i].second, -ranked[i].first});
+    }
+    scans.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+uint64_t EmbeddingStore::maxVersion() const {
+    std::shared_lock<std::shared_mutex> lock(map_mutex);
+    return max_version;
+}
+
+bool EmbeddingStore::needsCompaction(size_t min_dead) const {
+    std::shared_lock<std::shared_mutex> lock(map_mutex);
+    size_t dead = records - entries.size();
+    return fd >= 0 && dead >= min_dead && dead > entries.size();
+}
+
+void EmbeddingStore::compact() {
+    std::unique_lock<std::mutex> only_one(compact_mutex, std::try_to_lock);
+    if (!only_one.owns_lock()) {
+        return;
+    }
+
+    // Phase 1: copy the live records as of now into a new file, without blocking appends
+    std::vector<std::pair<uint64_t, uint32_t>> live; // (offset, length), in file order
+    uint64_t copy_end;
+    uint64_t old_size;
+    uint64_t started_generation;
+    {
+        std::shared_lock<std::shared_mutex> lock(map_mutex);
+        if (fd < 0) {
+            return;
+        }
+        live.reserve(entries.size());
+        for (const auto& entry : entries) {
+            live.emplace_back(entry.second.offset, headerAt(map + entry.second.offset).length);
+        }
+        copy_end = file_size;
+        old_size = file_size;
+        started_generation = generation;
+    }
+    std::sort(live.begin(), live.end());
+
+    const std::string tmp_path = path + ".compact";
+    int tmp = ::open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (tmp < 0) {
+        LOG_ERROR("Cannot create " << tmp_path << ": " << std::strerror(errno));
+        return;
+    }
+    auto fail = [&](const char* what) {
+        LOG_ERROR("Embedding snapshot compaction failed (" << what << "): " << std::strerror(errno));
+        ::close(tmp);
+        ::unlink(tmp_path.c_str());
+    };
+
+    if (!writeHeader(tmp)) {
+        return fail("header");
+    }
+    std::unordered_map<uint64_t, uint64_t> moved;
+    moved.reserve(live.size());
+    std::vector<char> buffer;
+    buffer.reserve(COPY_BUFFER_SIZE);
+    uint64_t out = FILE_HEADER_SIZE;
+    uint64_t flushed = FILE_HEADER_SIZE;
+    for (const auto& record : live) {
+        {
+            std::shared_lock<std::shared_mutex> lock(map_mutex);
+            if (generation != started_generation) {
+                ::close(tmp);
+                ::unlink(tmp_path.c_str());
+                return; // cleared or reopened meanwhile
+            }
+            buffer.insert(buffer.end(), map + record.first, map + record.first + record.second);
+        }
+        moved.emplace(record.first, out);
+        out += record.second;
+        if (buffer.size() >= COPY_BUFFER_SIZE) {
+            if (!writeAll(tmp, buffer.data(), buffer.size(), flushed)) {
+                return fail("write");
+            }
+            flushed += buffer.size();
+            buffer.clear();
+        }
+    }
+    if (!writeAll(tmp, buffer.data(), buffer.size(), flushed) || ::fdatasync(tmp) != 0) {
+        return fail("write");
+    }
+
+    // Phase 2: append what arrived meanwhile, then swap files
+    std::lock_guard<std::mutex> writer(write_mutex);
+    std::unique_lock<std::shared_mutex> lock(map_mutex);
+    if (fd < 0 || generation != started_generation) {
+        ::close(tmp);
+        ::unlink(tmp_path.c_str());
+        return;
+    }
+    const uint64_t tail_base = out;
+    const uint64_t tail_length = file_size - copy_end;
+    size_t tail_records = 0;
+    for (uint64_t offset = copy_end; offset < file_size; offset += headerAt(map + offset).length) {
+        ++tail_records;
+    }
+    if ((tail_length > 0 && !writeAll(tmp, map + copy_end, tail_length, tail_base)) || ::fdatasync(tmp) != 0) {
+        return fail("tail");
+    }
+    if (::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        return fail("rename");
+    }
+
+    for (auto& entry : entries) {
+        uint64_t& offset = entry.second.offset;
+        offset = offset < copy_end ? moved.at(offset) : tail_base + (offset - copy_end);
+    }
+    closeFile();
+    fd = tmp;
+    file_size = tail_base + tail_length;
+    records = live.size() + tail_records;
+    remap(file_size);
+    compactions.fetch_add(1, std::memory_order_relaxed);
+    LOG_INFO("Compacted embedding snapshot " << path << ": " << old_size << " -> " << file_size
+             << " bytes.");
+}
+
+EmbeddingStoreStats EmbeddingStore::stats() const {
+    std::shared_lock<std::shared_mutex> lock(map_mutex);
+    EmbeddingStoreStats s;
+    s.open = fd >= 0;
+    s.has_float = keep_float;
+    s.records = records;
+    s.live = entries.size();
+    s.file_bytes = file_size;
+    s.max_version = max_version;
+    s.appends = appends.load(std::memory_order_relaxed);
+    s.compactions = compactions.load(std::memory_order_relaxed);
+    s.scans = scans.load(std::memory_order_relaxed);
+    return s;
+}
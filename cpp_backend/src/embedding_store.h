@@ -0,0 +1,122 @@
+#ifndef EMBEDDING_STORE_H
+#define EMBEDDING_STORE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "hnsw_index.h"
+
+struct EmbeddingStoreStats {
+  bool open;
+  bool has_float;
+  size_t records;    // including superseded ones
+  size_t live;       // latest record per video
+  size_t file_bytes;
+  uint64_t max_version;
+  uint64_t appends;
+  uint64_t compactions;
+  uint64_t scans;    // brute-force searches served before the HNSW index was ready
+};
+
+// On-disk embedding snapshot: an append-only file of int8-quantized (optionally
+// also float32) normalized vectors, each tagged with the video's
+// embedding_version. The file is mmap'd, so startup reads it at disk speed
+// instead of re-parsing pgvector text from Postgres, and it stays in the page
+// cache rather than the heap. Records carry a CRC so a torn tail from a crash
+// is dropped on open; Postgres remains the source of truth.
+//
+// Layout (host byte order): 32-byte file header, then records of
+//   u32 length, u32 crc32, u64 version, f32 scale, u16 label_len, u16 flags,
+//   label (padded to 4), int8 codes[dim] (padded to 4), [f32 values[dim]],
+// each padded to 8 bytes.
+class EmbeddingStore {
+public:
+  using Visitor = std::function<void(const std::string& label, uint64_t version,
+                                     const int8_t* codes, float scale)>;
+
+  EmbeddingStore(std::string path, size_t dim, bool keep_float);
+  ~EmbeddingStore();
+
+  EmbeddingStore(const EmbeddingStore&) = delete;
+  EmbeddingStore& operator=(const EmbeddingStore&) = delete;
+
+  // Open or create the file and index the latest record per label. A file with
+  // another dimension/format is started over. Returns false if the file cannot
+  // be used; the store then ignores appends.
+  bool open();
+
+  // Drop every record (the snapshot belongs to another database lifetime).
+  void clear();
+
+  // Call fn with the latest record of every label. Records are copied out one at
+  // a time, so appends and compaction proceed while fn runs.
+  void forEach(const Visitor& fn) const;
+
+  // Normalize, quantize and append vec (dim floats). Thread-safe; I/O errors are
+  // logged, not thrown, since the snapshot is only a cache.
+  void append(const std::string& label, uint64_t version, const float* vec);
+
+  // Normalized float32 vector of label (needs keep_float).
+  bool values(const std::string& label, std::vector<float>& out) const;
+  bool hasValues() const { return keep_float; }
+
+  // Exact (int8, re-ranked on float32 when present) top-k neighbours of an
+  // indexed label, excluding itself. Linear in the number of videos: meant to
+  // serve queries while the HNSW index is still being built.
+  bool search(const std::string& label, size_t k, std::vector<HnswResult>& out) const;
+
+  uint64_t maxVersion() const;
+
+  // True once superseded records outnumber live ones (and at least min_dead exist).
+  bool needsCompaction(size_t min_dead) const;
+  // Rewrite the file with only the latest record per label. Appends continue
+  // while live records are copied; only the final swap blocks them.
+  void compact();
+
+  EmbeddingStoreStats stats() const;
+
+private:
+  struct Entry {
+    uint64_t offset;
+    uint64_t version;
+  };
+
+  size_t codesOffset(size_t label_len) const;
+  size_t valuesOffset(size_t label_len) const;
+  size_t recordSize(size_t label_len) const;
+  // Validates the record at offset against the first `limit` bytes of the map
+  bool validRecord(uint64_t offset, uint64_t limit) const;
+  void remap(uint64_t min_size);
+  void closeFile();
+  bool writeHeader(int target_fd);
+
+  const std::string path;
+  const size_t dimension;
+  const bool keep_float;
+
+  // write_mutex serializes appends, clear() and the compaction swap. map_mutex
+  // guards the mapping and entries: shared to read, exclusive to change.
+  std::mutex write_mutex;
+  mutable std::shared_mutex map_mutex;
+  std::mutex compact_mutex;
+
+  int fd = -1;
+  const char* map = nullptr;
+  size_t map_size = 0;
+  uint64_t file_size = 0;
+  size_t records = 0;
+  uint64_t max_version = 0;
+  uint64_t generation = 0; // bumped by open()/clear() so a running compaction can tell
+  std::unordered_map<std::string, Entry> entries;
+
+  std::atomic<uint64_t> appends{0};
+  std::atomic<uint64_t> compactions{0};
+  mutable std::atomic<uint64_t> scans{0};
+};
+
+#endif // EMBEDDING_STORE_H
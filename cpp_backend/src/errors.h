@@ -0,0 +1,18 @@
+#ifndef ERRORS_H
+#define ERRORS_H
+
+#include <stdexcept>
+
+// Base for overload errors (pool exhausted, executor queue full) that handlers map to 503.
+class ServiceUnavailable : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+// A referenced row doesn't exist; handlers map it to 404.
+class NotFound : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+#endif // ERRORS_H
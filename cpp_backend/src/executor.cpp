@@ -0,0 +1,82 @@
+#include "executor.h"
+#include "logger.h"
+
+Executor::Executor(size_t threads, size_t queue_capacity, RejectionPolicy policy)
+    : threads(threads == 0 ? 1 : threads), queue_capacity(queue_capacity),
+      policy(policy), pool(this->threads) {}
+
+Executor::~Executor() {
+    shutdown();
+}
+
+void Executor::shutdown() {
+    stopping.store(true);
+    pool.join();
+}
+
+void Executor::schedule(std::function<void()> task) {
+    if (stopping.load()) {
+        // A joined pool has no threads left: a queued task would never run
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        throw ExecutorRejected("Server is shutting down.");
+    }
+    size_t depth = queued.load(std::memory_order_relaxed);
+    do {
+        if (depth >= queue_capacity) {
+            if (policy == RejectionPolicy::CallerRuns) {
+                caller_runs.fetch_add(1, std::memory_order_relaxed);
+                run(task, std::chrono::steady_clock::now());
+                return;
+            }
+            rejected.fetch_add(1, std::memory_order_relaxed);
+            throw ExecutorRejected("Server is busy: task queue is full.");
+        }
+    } while (!queued.compare_exchange_weak(depth, depth + 1, std::memory_order_relaxed));
+
+    submitted.fetch_add(1, std::memory_order_relaxed);
+    auto enqueued = std::chrono::steady_clock::now();
+    boost::asio::post(pool, [this, task = std::move(task), enqueued]() {
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        run(task, enqueued);
+    });
+}
+
+void Executor::run(const std::function<void()>& task, std::chrono::steady_clock::time_point enqueued) {
+    auto started = std::chrono::steady_clock::now();
+    uint64_t waited_us = std::chrono::duration_cast<std::chrono::microseconds>(started - enqueued).count();
+    total_queue_wait_us.fetch_add(waited_us, std::memory_order_relaxed);
+    uint64_t prev_max = max_queue_wait_us.load(std::memory_order_relaxed);
+    while (waited_us > prev_max && !max_queue_wait_us.compare_exchange_weak(prev_max, waited_us, std::memory_order_relaxed)) {
+    }
+
+    active.fetch_add(1, std::memory_order_relaxed);
+    try {
+        task();
+    } catch (const std::exception& e) {
+        // Only post() tasks can get here; submit() stores exceptions in the future.
+        LOG_ERROR("Unhandled exception in executor task: " << e.what());
+    } catch (...) {
+        LOG_ERROR("Unhandled unknown exception in executor task.");
+    }
+    active.fetch_sub(1, std::memory_order_relaxed);
+
+    total_run_us.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started).count(), std::memory_order_relaxed);
+    completed.fetch_add(1, std::memory_order_relaxed);
+}
+
+ExecutorStats Executor::stats() const {
+    ExecutorStats s;
+    s.threads = threads;
+    s.queue_capacity = queue_capacity;
+    s.queue_depth = queued.load(std::memory_order_relaxed);
+    s.active = active.load(std::memory_order_relaxed);
+    s.submitted = submitted.load(std::memory_order_relaxed);
+    s.completed = completed.load(std::memory_order_relaxed);
+    s.rejected = rejected.load(std::memory_order_relaxed);
+    s.caller_runs = caller_runs.load(std::memory_order_relaxed);
+    s.total_queue_wait_us = total_queue_wait_us.load(std::memory_order_relaxed);
+    s.max_queue_wait_us = max_queue_wait_us.load(std::memory_order_relaxed);
+    s.total_run_us = total_run_us.load(std::memory_order_relaxed);
+    return s;
+}
@@ -0,0 +1,96 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include "errors.h"
+
+// Thrown by submit()/post() when the queue is full and the policy is Reject.
+class ExecutorRejected : public ServiceUnavailable {
+public:
+  using ServiceUnavailable::ServiceUnavailable;
+};
+
+enum class RejectionPolicy {
+  Reject,     // throw ExecutorRejected
+  CallerRuns  // run the task inline on the submitting thread
+};
+
+struct ExecutorStats {
+  size_t threads;
+  size_t queue_capacity;
+  size_t queue_depth;
+  size_t active;
+  uint64_t submitted;
+  uint64_t completed;
+  uint64_t rejected;
+  uint64_t caller_runs;
+  uint64_t total_queue_wait_us;
+  uint64_t max_queue_wait_us;
+  uint64_t total_run_us;
+};
+
+// Fixed-size worker pool with a bounded queue. Replaces thread-per-call
+// std::async so a traffic spike queues (or is rejected) instead of spawning threads.
+class Executor {
+public:
+  Executor(size_t threads, size_t queue_capacity, RejectionPolicy policy);
+  ~Executor();
+
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+
+  // Run fn on the pool and return a future for its result.
+  template <typename F>
+  std::future<std::invoke_result_t<std::decay_t<F>>> submit(F&& fn) {
+    using R = std::invoke_result_t<std::decay_t<F>>;
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+    std::future<R> result = task->get_future();
+    schedule([task]() { (*task)(); });
+    return result;
+  }
+
+  // Fire-and-forget; fn is responsible for its own completion callback and errors.
+  template <typename F>
+  void post(F&& fn) {
+    schedule(std::function<void()>(std::forward<F>(fn)));
+  }
+
+  // Stop accepting tasks (submit()/post() throw ExecutorRejected, so tasks that
+  // post follow-up work see it rejected), then wait for everything already queued
+  // to finish. Owners whose members the tasks use call this before destroying
+  // them; the destructor calls it too. Idempotent.
+  void shutdown();
+
+  ExecutorStats stats() const;
+
+private:
+  void schedule(std::function<void()> task);
+  void run(const std::function<void()>& task, std::chrono::steady_clock::time_point enqueued);
+
+  const size_t threads;
+  const size_t queue_capacity;
+  const RejectionPolicy policy;
+  boost::asio::thread_pool pool;
+  std::atomic<bool> stopping{false};
+
+  std::atomic<size_t> queued{0};
+  std::atomic<size_t> active{0};
+  std::atomic<uint64_t> submitted{0};
+  std::atomic<uint64_t> completed{0};
+  std::atomic<uint64_t> rejected{0};
+  std::atomic<uint64_t> caller_runs{0};
+  std::atomic<uint64_t> total_queue_wait_us{0};
+  std::atomic<uint64_t> max_queue_wait_us{0};
+  std::atomic<uint64_t> total_run_us{0};
+};
+
+#endif // EXECUTOR_H
@@ -0,0 +1,58 @@
+#include "float_buffer_pool.h"
+#include <utility>
+
+PooledFloats::PooledFloats(FloatBufferPool* pool, std::vector<float> buffer)
+    : pool(pool), buffer(std::move(buffer)) {}
+
+PooledFloats::PooledFloats(PooledFloats&& other) noexcept
+    : pool(other.pool), buffer(std::move(other.buffer)) {
+    other.pool = nullptr;
+}
+
+PooledFloats& PooledFloats::operator=(PooledFloats&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool = other.pool;
+        buffer = std::move(other.buffer);
+        other.pool = nullptr;
+    }
+    return *this;
+}
+
+PooledFloats::~PooledFloats() {
+    release();
+}
+
+void PooledFloats::release() {
+    if (pool) {
+        pool->release(std::move(buffer));
+        pool = nullptr;
+    }
+}
+
+FloatBufferPool::FloatBufferPool(size_t buffer_size, size_t max_idle)
+    : buffer_size(buffer_size), max_idle(max_idle) {
+    idle.reserve(max_idle);
+}
+
+PooledFloats FloatBufferPool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!idle.empty()) {
+            std::vector<float> buffer = std::move(idle.back());
+            idle.pop_back();
+            return PooledFloats(this, std::move(buffer));
+        }
+    }
+    return PooledFloats(this, std::vector<float>(buffer_size));
+}
+
+void FloatBufferPool::release(std::vector<float> buffer) {
+    if (buffer.size() != buffer_size) {
+        return; // resized by its user; not reusable as is
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (idle.size() < max_idle) {
+        idle.push_back(std::move(buffer));
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef FLOAT_BUFFER_POOL_H
+#define FLOAT_BUFFER_POOL_H
+
+#include <mutex>
+#include <vector>
+
+class FloatBufferPool;
+
+// RAII handle for a pooled float buffer. Returns it to the pool on destruction,
+// so it can be moved into an executor task and outlive the request.
+class PooledFloats {
+public:
+  PooledFloats(FloatBufferPool* pool, std::vector<float> buffer);
+  PooledFloats(PooledFloats&& other) noexcept;
+  PooledFloats& operator=(PooledFloats&& other) noexcept;
+  ~PooledFloats();
+
+  PooledFloats(const PooledFloats&) = delete;
+  PooledFloats& operator=(const PooledFloats&) = delete;
+
+  std::vector<float>& operator*() { return buffer; }
+  const std::vector<float>& operator*() const { return buffer; }
+  std::vector<float>* operator->() { return &buffer; }
+  const std::vector<float>* operator->() const { return &buffer; }
+
+private:
+  void release();
+
+  FloatBufferPool* pool;
+  std::vector<float> buffer;
+};
+
+// Free list of fixed-size float buffers for embedding uploads, so decoding a
+// body allocates nothing once the pool is warm. Keeps at most max_idle buffers;
+// more are allocated under load and freed on release.
+class FloatBufferPool {
+public:
+  FloatBufferPool(size_t buffer_size, size_t max_idle);
+
+  // A buffer of exactly buffer_size floats (contents unspecified)
+  PooledFloats acquire();
+
+private:
+  friend class PooledFloats;
+  void release(std::vector<float> buffer);
+
+  const size_t buffer_size;
+  const size_t max_idle;
+  std::mutex mutex;
+  std::vector<std::vector<float>> idle;
+};
+
+#endif // FLOAT_BUFFER_POOL_H
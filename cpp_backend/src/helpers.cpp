@@ -1,4 +1,6 @@
 #include "helpers.h"
+#include "vector_codec.h"
+#include "config.h"
 
 // Helper to extract YouTube video ID
 std::string getYouTubeVideoId(const std::string& url) {
@@ -33,14 +35,85 @@ std::string generateUserId() {
 
 // Helper to format a std::vector<float> into a string for pgvector
 std::string formatVectorForPgvector(const std::vector<float>& vec) {
-    std::stringstream ss;
-    ss << "[";
-    for (size_t i = 0; i < vec.size(); ++i) {
-        ss << std::fixed << std::setprecision(8) << vec[i];
-        if (i < vec.size() - 1) {
-            ss << ",";
+    return encodePgvector(vec);
+}
+
+// Helper to format strings as a PostgreSQL text array literal, e.g. for "= ANY($1::text[])"
+std::string formatPgTextArray(const std::vector<std::string>& values) {
+    std::string out = "{";
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+            out += ',';
+        }
+        // Quote every element so empty strings, commas and NULL are taken literally
+        out += '"';
+        for (char ch : values[i]) {
+            if (ch == '"' || ch == '\\') {
+                out += '\\';
+            }
+            out += ch;
         }
+        out += '"';
     }
-    ss << "]";
-    return ss.str();
-}
\ No newline at end of file
+    out += '}';
+    return out;
+}
+
+// Helper to format ints as a PostgreSQL int array literal, e.g. for "unnest($1::int[])"
+std::string formatPgIntArray(const std::vector<int>& values) {
+    std::string out = "{";
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+            out += ',';
+        }
+        out += std::to_string(values[i]);
+    }
+    out += '}';
+    return out;
+}
+
+std::string formatPgIntArray(const std::vector<int64_t>& values) {
+    std::string out = "{";
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+            out += ',';
+        }
+        out += std::to_string(values[i]);
+    }
+    out += '}';
+    return out;
+}
+
+// Helper to test an If-None-Match header (a comma-separated list of entity tags) against an ETag
+bool etagMatches(std::string_view ifNoneMatch, std::string_view etag) {
+    if (etag.size() > 2 && etag[0] == 'W' && etag[1] == '/') {
+        etag.remove_prefix(2);
+    }
+    size_t pos = 0;
+    while (pos < ifNoneMatch.size()) {
+        size_t end = ifNoneMatch.find(',', pos);
+        if (end == std::string_view::npos) {
+            end = ifNoneMatch.size();
+        }
+        std::string_view tag = ifNoneMatch.substr(pos, end - pos);
+        while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) {
+            tag.remove_prefix(1);
+        }
+        while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) {
+            tag.remove_suffix(1);
+        }
+        if (tag.size() > 2 && tag[0] == 'W' && tag[1] == '/') {
+            tag.remove_prefix(2);
+        }
+        if (tag == etag) {
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+// Helper to build the libpq connection string from config.h
+std::string buildConnectionString() {
+    return "host=" + DB_HOST + " port=" + std::to_string(DB_PORT) + " user=" + DB_USER + " password=" + DB_PASS + " dbname=" + DB_NAME;
+}
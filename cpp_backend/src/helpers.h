@@ -1,7 +1,9 @@
 #ifndef HELPERS_H
 #define HELPERS_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <regex>
 #include <random>
 #include <sstream>
@@ -19,4 +21,18 @@ std::string generateUserId();
 // Helper to format a std::vector<float> into a string for pgvector
 std::string formatVectorForPgvector(const std::vector<float>& vec);
 
+// Helper to format strings as a PostgreSQL text array literal, e.g. for "= ANY($1::text[])"
+std::string formatPgTextArray(const std::vector<std::string>& values);
+
+// Helper to format ints as a PostgreSQL int array literal, e.g. for "unnest($1::int[])"
+std::string formatPgIntArray(const std::vector<int>& values);
+std::string formatPgIntArray(const std::vector<int64_t>& values);
+
+// Helper to test an If-None-Match header against an ETag. Weak comparison, so W/"x" matches "x";
+// "*" is not honoured, since answering it needs to know whether the resource exists.
+bool etagMatches(std::string_view ifNoneMatch, std::string_view etag);
+
+// Helper to build the libpq connection string from config.h
+std::string buildConnectionString();
+
 #endif // HELPERS_H
\ No newline at end of file
@@ -0,0 +1,394 @@
+#include "hnsw_index.h"
+#include "vector_math.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+
+namespace {
+
+// Per-thread visited marks, reset in O(1) by bumping the epoch.
+struct VisitedSet {
+    std::vector<uint32_t> marks;
+    uint32_t epoch = 0;
+
+    void next() {
+        if (++epoch == 0) {
+            std::fill(marks.begin(), marks.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    // Returns true if id was already visited in this epoch.
+    bool testAndSet(uint32_t id) {
+        if (id >= marks.size()) {
+            marks.resize(std::max<size_t>(id + 1, marks.size() * 2), 0);
+        }
+        if (marks[id] == epoch) {
+            return true;
+        }
+        marks[id] = epoch;
+        return false;
+    }
+};
+
+VisitedSet& threadVisited() {
+    thread_local VisitedSet visited;
+    return visited;
+}
+
+} // namespace
+
+HnswIndex::HnswIndex(size_t dim, size_t m, size_t ef_construction)
+    : dimension(dim), m(std::max<size_t>(m, 2)), ef_construction(std::max(ef_construction, m)),
+      level_mult(1.0 / std::log(static_cast<double>(std::max<size_t>(m, 2)))),
+      chunks(new std::atomic<Chunk*>[MAX_CHUNKS]), rng(0x5eed) {
+    for (uint32_t i = 0; i < MAX_CHUNKS; ++i) {
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+HnswIndex::~HnswIndex() {
+    for (uint32_t i = 0; i < MAX_CHUNKS; ++i) {
+        delete chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+HnswIndex::Node& HnswIndex::node(uint32_t id) const {
+    return chunks[id >> CHUNK_BITS].load(std::memory_order_acquire)->nodes[id & (CHUNK_SIZE - 1)];
+}
+
+int8_t* HnswIndex::codesOf(uint32_t id) const {
+    return chunks[id >> CHUNK_BITS].load(std::memory_order_acquire)->codes.get() +
+           static_cast<size_t>(id & (CHUNK_SIZE - 1)) * dimension;
+}
+
+float& HnswIndex::scaleOf(uint32_t id) const {
+    return chunks[id >> CHUNK_BITS].load(std::memory_order_acquire)->scales[id & (CHUNK_SIZE - 1)];
+}
+
+float HnswIndex::distance(const Query& q, uint32_t id, uint64_t& counter) const {
+    ++counter;
+    return 1.0f - q.scale * scaleOf(id) * static_cast<float>(dotProductInt8(q.codes, codesOf(id), dimension));
+}
+
+int HnswIndex::randomLevel() {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double level = -std::log(std::max(uniform(rng), 1e-12)) * level_mult;
+    return std::min(static_cast<int>(level), 16);
+}
+
+bool HnswIndex::insert(const std::string& label, const float* vec, uint64_t version) {
+    thread_local std::vector<float> normalized;
+    thread_local std::vector<int8_t> codes;
+    normalized.assign(vec, vec + dimension);
+    codes.resize(dimension);
+    normalizeVector(normalized.data(), dimension);
+    float scale = quantizeInt8(normalized.data(), dimension, codes.data());
+    return insertQuantized(label, codes.data(), scale, version);
+}
+
+bool HnswIndex::insertQuantized(const std::string& label, const int8_t* codes, float scale, uint64_t version) {
+    std::lock_guard<std::mutex> writer(insert_mutex);
+
+    uint32_t previous = NO_NODE;
+    {
+        std::shared_lock<std::shared_mutex> lock(labels_mutex);
+        auto it = labels.find(label);
+        if (it != labels.end()) {
+            if (it->second.version >= version) {
+                return false;
+            }
+            previous = it->second.id;
+        }
+    }
+
+    const uint32_t id = node_count.load(std::memory_order_relaxed);
+    const uint32_t chunk = id >> CHUNK_BITS;
+    if (chunk >= MAX_CHUNKS) {
+        throw std::length_error("HNSW index is full.");
+    }
+    if (chunks[chunk].load(std::memory_order_relaxed) == nullptr) {
+        chunks[chunk].store(new Chunk(dimension), std::memory_order_release);
+    }
+
+    // Fill in the node before anything can reach it
+    std::memcpy(codesOf(id), codes, dimension);
+    scaleOf(id) = scale;
+    const Query data = queryFor(id);
+    Node& fresh = node(id);
+    const int level = randomLevel();
+    fresh.label = label;
+    fresh.level = level;
+    fresh.links.resize(level + 1);
+    for (int l = 0; l <= level; ++l) {
+        fresh.links[l].reserve(maxLinks(l) + 1);
+    }
+
+    uint64_t counter = 0;
+    const uint32_t entry = entry_point.load(std::memory_order_acquire);
+    node_count.store(id + 1, std::memory_order_release);
+
+    if (entry != NO_NODE) {
+        const int entry_level = node(entry).level;
+        uint32_t cur = greedyDescend(data, entry, entry_level, level, counter);
+        for (int l = std::min(level, entry_level); l >= 0; --l) {
+            std::vector<Candidate> nearest = searchLayer(data, cur, ef_construction, l, false, NO_NODE, counter);
+            std::vector<uint32_t> selected = selectNeighbors(nearest, m, counter);
+            {
+                std::lock_guard<std::mutex> lock(fresh.links_mutex);
+                fresh.links[l] = selected;
+            }
+            for (uint32_t neighbor : selected) {
+                connect(neighbor, id, l, counter);
+            }
+            if (!nearest.empty()) {
+                cur = nearest.front().second;
+            }
+        }
+        if (level > entry_level) {
+            entry_point.store(id, std::memory_order_release);
+        }
+    } else {
+        entry_point.store(id, std::memory_order_release);
+    }
+
+    {
+        std::unique_lock<std::shared_mutex> lock(labels_mutex);
+        labels[label] = {id, version};
+    }
+    if (previous != NO_NODE) {
+        node(previous).deleted.store(true, std::memory_order_release);
+        deleted_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    inserts.fetch_add(1, std::memory_order_relaxed);
+    distance_computations.fetch_add(counter, std::memory_order_relaxed);
+    return true;
+}
+
+void HnswIndex::connect(uint32_t id, uint32_t neighbor, int level, uint64_t& counter) {
+    Node& target = node(id);
+    std::lock_guard<std::mutex> lock(target.links_mutex);
+    std::vector<uint32_t>& links = target.links[level];
+    if (links.size() < maxLinks(level)) {
+        links.push_back(neighbor);
+        return;
+    }
+
+    // Over capacity: re-select the best maxLinks among the old links plus the new one
+    const Query base = queryFor(id);
+    std::vector<Candidate> candidates;
+    candidates.reserve(links.size() + 1);
+    for (uint32_t existing : links) {
+        candidates.emplace_back(distance(base, existing, counter), existing);
+    }
+    candidates.emplace_back(distance(base, neighbor, counter), neighbor);
+    std::sort(candidates.begin(), candidates.end());
+    links = selectNeighbors(candidates, maxLinks(level), counter);
+}
+
+std::vector<uint32_t> HnswIndex::selectNeighbors(const std::vector<Candidate>& sorted, size_t max, uint64_t& counter) const {
+    std::vector<uint32_t> selected;
+    selected.reserve(max);
+    for (const Candidate& candidate : sorted) {
+        if (selected.size() >= max) {
+            break;
+        }
+        const Query vec = queryFor(candidate.second);
+        bool keep = true;
+        for (uint32_t kept : selected) {
+            if (distance(vec, kept, counter) < candidate.first) {
+                keep = false;
+                break;
+            }
+        }
+        if (keep) {
+            selected.push_back(candidate.second);
+        }
+    }
+    return selected;
+}
+
+uint32_t HnswIndex::greedyDescend(const Query& query, uint32_t entry, int from_level, int to_level, uint64_t& counter) const {
+    uint32_t cur = entry;
+    float cur_dist = distance(query, cur, counter);
+    std::vector<uint32_t> links;
+    for (int l = from_level; l > to_level; --l) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            {
+                const Node& n = node(cur);
+                std::lock_guard<std::mutex> lock(n.links_mutex);
+                links = n.links[l];
+            }
+            for (uint32_t candidate : links) {
+                float d = distance(query, candidate, counter);
+                if (d < cur_dist) {
+                    cur_dist = d;
+                    cur = candidate;
+                    changed = true;
+                }
+            }
+        }
+    }
+    return cur;
+}
+
+std::vector<HnswIndex::Candidate> HnswIndex::searchLayer(const Query& query, uint32_t entry, size_t ef, int level,
+                                                        bool results_only_live, uint32_t skip, uint64_t& counter) const {
+    auto returnable = [&](uint32_t id) {
+        return !results_only_live || (id != skip && !node(id).deleted.load(std::memory_order_acquire));
+    };
+
+    VisitedSet& visited = threadVisited();
+    visited.next();
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates; // nearest on top
+    std::priority_queue<Candidate> results;                                                   // farthest on top
+
+    float d = distance(query, entry, counter);
+    visited.testAndSet(entry);
+    candidates.emplace(d, entry);
+    if (returnable(entry)) {
+        results.emplace(d, entry);
+    }
+
+    std::vector<uint32_t> links;
+    while (!candidates.empty()) {
+        Candidate current = candidates.top();
+        float bound = results.empty() ? std::numeric_limits<float>::max() : results.top().first;
+        if (current.first > bound && results.size() >= ef) {
+            break;
+        }
+        candidates.pop();
+
+        {
+            const Node& n = node(current.second);
+            std::lock_guard<std::mutex> lock(n.links_mutex);
+            links = n.links[level];
+        }
+        for (uint32_t neighbor : links) {
+            if (visited.testAndSet(neighbor)) {
+                continue;
+            }
+            float nd = distance(query, neighbor, counter);
+            bound = results.empty() ? std::numeric_limits<float>::max() : results.top().first;
+            if (results.size() < ef || nd < bound) {
+                candidates.emplace(nd, neighbor);
+                if (returnable(neighbor)) {
+                    results.emplace(nd, neighbor);
+                    if (results.size() > ef) {
+                        results.pop();
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<Candidate> sorted(results.size());
+    for (size_t i = sorted.size(); i-- > 0;) {
+        sorted[i] = results.top();
+        results.pop();
+    }
+    return sorted;
+}
+
+std::vector<HnswResult> HnswIndex::searchInternal(const Query& query, size_t k, size_t ef, uint32_t skip) const {
+    std::vector<HnswResult> out;
+    const uint32_t entry = entry_point.load(std::memory_order_acquire);
+    if (entry == NO_NODE || k == 0) {
+        return out;
+    }
+    uint64_t counter = 0;
+    uint32_t cur = greedyDescend(query, entry, node(entry).level, 0, counter);
+    std::vector<Candidate> nearest = searchLayer(query, cur, std::max(ef, k), 0, true, skip, counter);
+
+    out.reserve(std::min(k, nearest.size()));
+    for (size_t i = 0; i < nearest.size() && i < k; ++i) {
+        out.push_back({node(nearest[i].second).label, 1.0f - nearest[i].first});
+    }
+    searches.fetch_add(1, std::memory_order_relaxed);
+    distance_computations.fetch_add(counter, std::memory_order_relaxed);
+    return out;
+}
+
+std::vector<HnswResult> HnswIndex::search(const float* query, size_t k, size_t ef) const {
+    std::vector<float> normalized(query, query + dimension);
+    std::vector<int8_t> codes(dimension);
+    normalizeVector(normalized.data(), dimension);
+    float scale = quantizeInt8(normalized.data(), dimension, codes.data());
+    return searchInternal({codes.data(), scale}, k, ef, NO_NODE);
+}
+
+bool HnswIndex::searchByLabel(const std::string& label, size_t k, size_t ef, std::vector<HnswResult>& out) const {
+    uint32_t id;
+    {
+        std::shared_lock<std::shared_mutex> lock(labels_mutex);
+        auto it = labels.find(label);
+        if (it == labels.end()) {
+            return false;
+        }
+        id = it->second.id;
+    }
+    // Stored codes are immutable, so the node's own copy is the query
+    out = searchInternal(queryFor(id), k, ef, id);
+    return true;
+}
+
+bool HnswIndex::similarities(const std::string& label, const std::vector<std::string>& others,
+                             std::vector<std::optional<float>>& out) const {
+    std::vector<uint32_t> ids(others.size(), NO_NODE);
+    uint32_t id;
+    {
+        std::shared_lock<std::shared_mutex> lock(labels_mutex);
+        auto it = labels.find(label);
+        if (it == labels.end()) {
+            return false;
+        }
+        id = it->second.id;
+        for (size_t i = 0; i < others.size(); ++i) {
+            auto other = labels.find(others[i]);
+            if (other != labels.end()) {
+                ids[i] = other->second.id;
+            }
+        }
+    }
+    uint64_t counter = 0;
+    const Query query = queryFor(id);
+    out.assign(others.size(), std::nullopt);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (ids[i] != NO_NODE) {
+            out[i] = 1.0f - distance(query, ids[i], counter);
+        }
+    }
+    distance_computations.fetch_add(counter, std::memory_order_relaxed);
+    return true;
+}
+
+bool HnswIndex::contains(const std::string& label) const {
+    std::shared_lock<std::shared_mutex> lock(labels_mutex);
+    return labels.count(label) > 0;
+}
+
+size_t HnswIndex::size() const {
+    std::shared_lock<std::shared_mutex> lock(labels_mutex);
+    return labels.size();
+}
+
+HnswStats HnswIndex::stats() const {
+    HnswStats s;
+    s.dim = dimension;
+    s.nodes = node_count.load(std::memory_order_relaxed);
+    s.live = size();
+    s.deleted = deleted_count.load(std::memory_order_relaxed);
+    s.vector_bytes = s.nodes * (dimension + sizeof(float));
+    const uint32_t entry = entry_point.load(std::memory_order_acquire);
+    s.max_level = entry == NO_NODE ? -1 : node(entry).level;
+    s.inserts = inserts.load(std::memory_order_relaxed);
+    s.searches = searches.load(std::memory_order_relaxed);
+    s.distance_computations = distance_computations.load(std::memory_order_relaxed);
+    s.simd = simdLevelName(detectSimdLevel());
+    return s;
+}
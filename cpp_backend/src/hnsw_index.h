@@ -0,0 +1,152 @@
+#ifndef HNSW_INDEX_H
+#define HNSW_INDEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct HnswResult {
+  std::string label;
+  float similarity; // cosine similarity, 1 = identical direction
+};
+
+struct HnswStats {
+  size_t dim;
+  size_t nodes;   // including replaced ones
+  size_t live;    // labels currently searchable
+  size_t deleted; // nodes left behind by re-inserts
+  size_t vector_bytes;
+  int max_level;
+  uint64_t inserts;
+  uint64_t searches;
+  uint64_t distance_computations;
+  const char* simd;
+};
+
+// In-memory HNSW graph (Malkov & Yashunin) over cosine similarity. Vectors are
+// normalized and int8-quantized on insert (dim + 4 bytes per node instead of
+// 4 * dim), so similarity is a scaled integer dot product.
+//
+// Searches run concurrently with each other and with inserts; inserts are
+// serialized. Node storage is chunked and never moves, node data is immutable
+// once published, and each node's link lists are guarded by its own mutex.
+// Every insert carries a version and only a newer version replaces a label: the
+// replacement is a new node and the old one is marked deleted (deleted nodes
+// still route searches but are never returned).
+class HnswIndex {
+public:
+  HnswIndex(size_t dim, size_t m, size_t ef_construction);
+  ~HnswIndex();
+
+  HnswIndex(const HnswIndex&) = delete;
+  HnswIndex& operator=(const HnswIndex&) = delete;
+
+  // Insert vec (dim floats) under label. Returns false, changing nothing, if the
+  // label is already indexed with a version >= version.
+  bool insert(const std::string& label, const float* vec, uint64_t version);
+  // Same, for a vector already normalized and quantized with quantizeInt8.
+  bool insertQuantized(const std::string& label, const int8_t* codes, float scale, uint64_t version);
+
+  bool contains(const std::string& label) const;
+
+  // Approximate top-k by similarity; ef (>= k) trades latency for recall.
+  std::vector<HnswResult> search(const float* query, size_t k, size_t ef) const;
+
+  // Neighbours of an indexed label, excluding the label itself. Returns false if
+  // the label is not indexed.
+  bool searchByLabel(const std::string& label, size_t k, size_t ef, std::vector<HnswResult>& out) const;
+
+  // Similarity of label to each of others, nullopt where either is not indexed.
+  // Returns false if label is not indexed.
+  bool similarities(const std::string& label, const std::vector<std::string>& others,
+                    std::vector<std::optional<float>>& out) const;
+
+  size_t dim() const { return dimension; }
+  size_t size() const;
+  HnswStats stats() const;
+
+private:
+  static constexpr uint32_t CHUNK_BITS = 14;
+  static constexpr uint32_t CHUNK_SIZE = 1u << CHUNK_BITS;
+  static constexpr uint32_t MAX_CHUNKS = 8192; // 134M nodes
+  static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+  struct Node {
+    std::string label;
+    int level = 0;
+    std::atomic<bool> deleted{false};
+    mutable std::mutex links_mutex;
+    std::vector<std::vector<uint32_t>> links; // links[level], guarded by links_mutex
+  };
+
+  struct Chunk {
+    explicit Chunk(size_t dim) : codes(new int8_t[CHUNK_SIZE * dim]), scales(new float[CHUNK_SIZE]) {}
+    Node nodes[CHUNK_SIZE];
+    std::unique_ptr<int8_t[]> codes;
+    std::unique_ptr<float[]> scales;
+  };
+
+  struct LabelEntry {
+    uint32_t id;
+    uint64_t version;
+  };
+
+  // A quantized vector: element i is codes[i] * scale
+  struct Query {
+    const int8_t* codes;
+    float scale;
+  };
+
+  // (distance, node) with distance = 1 - similarity
+  using Candidate = std::pair<float, uint32_t>;
+
+  Node& node(uint32_t id) const;
+  int8_t* codesOf(uint32_t id) const;
+  float& scaleOf(uint32_t id) const;
+  Query queryFor(uint32_t id) const { return {codesOf(id), scaleOf(id)}; }
+  float distance(const Query& q, uint32_t id, uint64_t& counter) const;
+
+  size_t maxLinks(int level) const { return level == 0 ? 2 * m : m; }
+  int randomLevel();
+
+  std::vector<HnswResult> searchInternal(const Query& query, size_t k, size_t ef, uint32_t skip) const;
+  uint32_t greedyDescend(const Query& query, uint32_t entry, int from_level, int to_level, uint64_t& counter) const;
+  // Best-first search on one layer. Returns up to ef candidates sorted nearest first;
+  // with results_only_live, deleted nodes and `skip` are traversed but not returned.
+  std::vector<Candidate> searchLayer(const Query& query, uint32_t entry, size_t ef, int level,
+                                     bool results_only_live, uint32_t skip, uint64_t& counter) const;
+  // Neighbour selection heuristic: keep a candidate only if it is closer to the
+  // base than to every neighbour already kept, which preserves long-range links.
+  std::vector<uint32_t> selectNeighbors(const std::vector<Candidate>& sorted, size_t max, uint64_t& counter) const;
+  void connect(uint32_t id, uint32_t neighbor, int level, uint64_t& counter);
+
+  const size_t dimension;
+  const size_t m;
+  const size_t ef_construction;
+  const double level_mult;
+
+  std::unique_ptr<std::atomic<Chunk*>[]> chunks;
+  std::atomic<uint32_t> node_count{0};
+  std::atomic<uint32_t> entry_point{NO_NODE};
+
+  std::mutex insert_mutex; // serializes writers
+  std::mt19937_64 rng;     // guarded by insert_mutex
+
+  mutable std::shared_mutex labels_mutex;
+  std::unordered_map<std::string, LabelEntry> labels;
+
+  std::atomic<size_t> deleted_count{0};
+  std::atomic<uint64_t> inserts{0};
+  mutable std::atomic<uint64_t> searches{0};
+  mutable std::atomic<uint64_t> distance_computations{0};
+};
+
+#endif // HNSW_INDEX_H
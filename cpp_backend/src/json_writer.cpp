@@ -0,0 +1,141 @@
+#include "json_writer.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+JsonWriter::JsonWriter(size_t reserve_bytes) {
+    out.reserve(reserve_bytes);
+}
+
+void JsonWriter::separator() {
+    if (after_key) {
+        after_key = false;
+        return;
+    }
+    if (depth > 0) {
+        const uint64_t bit = uint64_t(1) << (depth - 1);
+        if (has_elements & bit) {
+            out += ',';
+        }
+        has_elements |= bit;
+    }
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    separator();
+    out += '{';
+    ++depth;
+    has_elements &= ~(uint64_t(1) << (depth - 1));
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    --depth;
+    out += '}';
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    separator();
+    out += '[';
+    ++depth;
+    has_elements &= ~(uint64_t(1) << (depth - 1));
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    --depth;
+    out += ']';
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+    value(name);
+    out += ':';
+    after_key = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view s) {
+    static const char hex[] = "0123456789abcdef";
+    separator();
+    out += '"';
+    // Copy runs of plain bytes at once; UTF-8 passes through unchanged
+    size_t run = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        const unsigned char ch = static_cast<unsigned char>(s[i]);
+        if (ch >= 0x20 && ch != '"' && ch != '\\') {
+            continue;
+        }
+        out.append(s.data() + run, i - run);
+        run = i + 1;
+        switch (ch) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                out += "\\u00";
+                out += hex[ch >> 4];
+                out += hex[ch & 15];
+        }
+    }
+    out.append(s.data() + run, s.size() - run);
+    out += '"';
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(int64_t n) {
+    separator();
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), n);
+    out.append(buf, res.ptr);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(uint64_t n) {
+    separator();
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), n);
+    out.append(buf, res.ptr);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double d) {
+    if (!std::isfinite(d)) {
+        return null();
+    }
+    separator();
+    char buf[32];
+    auto res = std::to_chars(buf, buf + sizeof(buf), d);
+    out.append(buf, res.ptr);
+    // Keep integral doubles recognizable as floats ("1.0"), as dump() does
+    if (std::find_if(buf, res.ptr, [](char c) { return c == '.' || c == 'e'; }) == res.ptr) {
+        out += ".0";
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool b) {
+    separator();
+    out += b ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    separator();
+    out += "null";
+    return *this;
+}
+
+std::string JsonWriter::take() {
+    has_elements = 0;
+    depth = 0;
+    after_key = false;
+    std::string body = std::move(out);
+    out.clear();
+    return body;
+}
@@ -0,0 +1,51 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Appends JSON text straight into one std::string, for list responses that would
+// otherwise build an nlohmann::json node per row and then dump() the tree. The
+// finished body is moved into crow::response, so it is materialized once.
+// Commas are inserted automatically; begin/end calls must nest correctly.
+class JsonWriter {
+public:
+  // Reserving the expected body size up front makes large bodies one allocation
+  explicit JsonWriter(size_t reserve_bytes = 0);
+
+  JsonWriter& beginObject();
+  JsonWriter& endObject();
+  JsonWriter& beginArray();
+  JsonWriter& endArray();
+  JsonWriter& key(std::string_view name);
+
+  JsonWriter& value(std::string_view s);
+  JsonWriter& value(const char* s) { return value(std::string_view(s)); }
+  JsonWriter& value(const std::string& s) { return value(std::string_view(s)); }
+  JsonWriter& value(int n) { return value(static_cast<int64_t>(n)); }
+  JsonWriter& value(int64_t n);
+  JsonWriter& value(uint64_t n);
+  // Shortest round-trip form, which can be a digit shorter than dump()'s; NaN and
+  // infinities are written as null, like dump()
+  JsonWriter& value(double d);
+  JsonWriter& value(bool b);
+  JsonWriter& null();
+  template <typename T>
+  JsonWriter& value(const std::optional<T>& v) { return v ? value(*v) : null(); }
+
+  // The finished body; the writer is left empty
+  std::string take();
+  const std::string& str() const { return out; }
+
+private:
+  void separator();
+
+  std::string out;
+  uint64_t has_elements = 0; // bit d: the container at depth d already has an element
+  int depth = 0;
+  bool after_key = false;
+};
+
+#endif // JSON_WRITER_H
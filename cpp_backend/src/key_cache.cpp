@@ -0,0 +1,63 @@
+#include "key_cache.h"
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+KeyCache::KeyCache(size_t capacity, size_t shard_count) {
+    if (shard_count == 0) {
+        shard_count = 1;
+    }
+    shard_capacity = std::max<size_t>(1, capacity / shard_count);
+    shards.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+KeyCache::Shard& KeyCache::shardFor(const std::string& id) const {
+    return *shards[std::hash<std::string>{}(id) % shards.size()];
+}
+
+void KeyCache::put(const std::string& id, int64_t key) {
+    Shard& shard = shardFor(id);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (shard.keys.size() >= shard_capacity && shard.keys.find(id) == shard.keys.end()) {
+        // Start from the bucket the new id hashes to, so evictions spread over the table
+        size_t buckets = shard.keys.bucket_count();
+        size_t bucket = shard.keys.bucket(id);
+        for (size_t i = 0; i < buckets; ++i, bucket = (bucket + 1) % buckets) {
+            if (shard.keys.bucket_size(bucket) > 0) {
+                shard.keys.erase(shard.keys.begin(bucket)->first);
+                evictions.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+        }
+    }
+    shard.keys[id] = key;
+}
+
+bool KeyCache::get(const std::string& id, int64_t& out) const {
+    Shard& shard = shardFor(id);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.keys.find(id);
+    if (it == shard.keys.end()) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    out = it->second;
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+KeyCacheStats KeyCache::stats() const {
+    KeyCacheStats s{};
+    s.hits = hits.load(std::memory_order_relaxed);
+    s.misses = misses.load(std::memory_order_relaxed);
+    s.evictions = evictions.load(std::memory_order_relaxed);
+    for (const auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        s.entries += shard->keys.size();
+    }
+    s.capacity = shard_capacity * shards.size();
+    return s;
+}
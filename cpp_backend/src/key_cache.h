@@ -0,0 +1,48 @@
+#ifndef KEY_CACHE_H
+#define KEY_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct KeyCacheStats {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  size_t entries;
+  size_t capacity;
+};
+
+// Sharded in-memory public id -> BIGINT surrogate key map (videos.video_key,
+// users.user_key), so requests resolve keys without a lookup in Postgres. A row's
+// key never changes and rows are never deleted, so entries are never invalidated;
+// a full shard evicts an arbitrary entry to bound memory.
+class KeyCache {
+public:
+  KeyCache(size_t capacity, size_t shard_count);
+
+  // Only put keys of committed rows: the key of a rolled-back insert names nothing.
+  void put(const std::string& id, int64_t key);
+  bool get(const std::string& id, int64_t& out) const;
+  KeyCacheStats stats() const;
+
+private:
+  struct Shard {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, int64_t> keys;
+  };
+
+  Shard& shardFor(const std::string& id) const;
+
+  std::vector<std::unique_ptr<Shard>> shards;
+  size_t shard_capacity;
+  mutable std::atomic<uint64_t> hits{0};
+  mutable std::atomic<uint64_t> misses{0};
+  std::atomic<uint64_t> evictions{0};
+};
+
+#endif // KEY_CACHE_H
@@ -0,0 +1,197 @@
+#include "leaderboard.h"
+#include <mutex>
+
+Leaderboard::Leaderboard() : rng(std::random_device{}()) {
+    head.links.resize(MAX_LEVEL);
+}
+
+Leaderboard::~Leaderboard() {
+    Node* node = head.links[0].next;
+    while (node) {
+        Node* next = node->links[0].next;
+        delete node;
+        node = next;
+    }
+}
+
+bool Leaderboard::before(const Node& a, const Node& b) {
+    if (a.contributions != b.contributions) {
+        return a.contributions > b.contributions;
+    }
+    if (a.username.has_value() != b.username.has_value()) {
+        return a.username.has_value();
+    }
+    if (a.username && *a.username != *b.username) {
+        return *a.username < *b.username;
+    }
+    return a.user_id < b.user_id;
+}
+
+int Leaderboard::randomLevel() {
+    // Each level holds a quarter of the one below
+    int lvl = 1;
+    while (lvl < MAX_LEVEL && (rng() & 3) == 0) {
+        ++lvl;
+    }
+    return lvl;
+}
+
+void Leaderboard::link(Node* node) {
+    Node* update[MAX_LEVEL];
+    size_t rank[MAX_LEVEL];
+    Node* x = &head;
+    for (int i = level - 1; i >= 0; --i) {
+        rank[i] = i == level - 1 ? 0 : rank[i + 1];
+        while (x->links[i].next && before(*x->links[i].next, *node)) {
+            rank[i] += x->links[i].span;
+            x = x->links[i].next;
+        }
+        update[i] = x;
+    }
+
+    const int node_level = randomLevel();
+    if (node_level > level) {
+        for (int i = level; i < node_level; ++i) {
+            rank[i] = 0;
+            update[i] = &head;
+            head.links[i].span = length;
+        }
+        level = node_level;
+    }
+    node->links.assign(node_level, Link{});
+    for (int i = 0; i < node_level; ++i) {
+        node->links[i].next = update[i]->links[i].next;
+        update[i]->links[i].next = node;
+        node->links[i].span = update[i]->links[i].span - (rank[0] - rank[i]);
+        update[i]->links[i].span = rank[0] - rank[i] + 1;
+    }
+    for (int i = node_level; i < level; ++i) {
+        ++update[i]->links[i].span;
+    }
+    ++length;
+}
+
+void Leaderboard::unlink(Node* node) {
+    Node* update[MAX_LEVEL];
+    Node* x = &head;
+    for (int i = level - 1; i >= 0; --i) {
+        while (x->links[i].next && before(*x->links[i].next, *node)) {
+            x = x->links[i].next;
+        }
+        update[i] = x;
+    }
+    for (int i = 0; i < level; ++i) {
+        if (update[i]->links[i].next == node) {
+            update[i]->links[i].span += node->links[i].span - 1;
+            update[i]->links[i].next = node->links[i].next;
+        } else {
+            --update[i]->links[i].span;
+        }
+    }
+    while (level > 1 && !head.links[level - 1].next) {
+        --level;
+    }
+    --length;
+}
+
+const Leaderboard::Node* Leaderboard::nodeAt(size_t rank) const {
+    const Node* x = &head;
+    size_t traversed = 0;
+    for (int i = level - 1; i >= 0; --i) {
+        while (x->links[i].next && traversed + x->links[i].span <= rank) {
+            traversed += x->links[i].span;
+            x = x->links[i].next;
+        }
+        if (traversed == rank) {
+            return x;
+        }
+    }
+    return nullptr;
+}
+
+size_t Leaderboard::rankOf(const Node* node) const {
+    const Node* x = &head;
+    size_t rank = 0;
+    for (int i = level - 1; i >= 0; --i) {
+        while (x->links[i].next && !before(*node, *x->links[i].next)) {
+            rank += x->links[i].span;
+            x = x->links[i].next;
+        }
+        if (x == node) {
+            return rank;
+        }
+    }
+    return 0;
+}
+
+Leaderboard::Node* Leaderboard::findOrCreate(const std::string& userId) {
+    auto it = nodes.find(userId);
+    if (it != nodes.end()) {
+        return it->second;
+    }
+    Node* node = new Node();
+    node->user_id = userId;
+    link(node);
+    nodes.emplace(userId, node);
+    return node;
+}
+
+void Leaderboard::adjust(const std::string& userId, int delta) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    Node* node = findOrCreate(userId);
+    if (delta == 0) {
+        return;
+    }
+    unlink(node);
+    node->contributions += delta;
+    link(node);
+}
+
+void Leaderboard::setUsername(const std::string& userId, const std::optional<std::string>& username) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    Node* node = findOrCreate(userId);
+    if (node->username == username) {
+        return;
+    }
+    unlink(node);
+    node->username = username;
+    link(node);
+}
+
+void Leaderboard::put(const std::string& userId, const std::optional<std::string>& username, int contributions) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    Node* node = findOrCreate(userId);
+    unlink(node);
+    node->username = username;
+    node->contributions = contributions;
+    link(node);
+}
+
+std::vector<LeaderboardEntry> Leaderboard::page(size_t offset, size_t limit) const {
+    std::vector<LeaderboardEntry> out;
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (offset >= length || limit == 0) {
+        return out;
+    }
+    const Node* node = nodeAt(offset + 1);
+    for (size_t rank = offset + 1; node && out.size() < limit; ++rank, node = node->links[0].next) {
+        out.push_back({node->user_id, node->username, node->contributions, rank});
+    }
+    return out;
+}
+
+bool Leaderboard::find(const std::string& userId, LeaderboardEntry& out) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = nodes.find(userId);
+    if (it == nodes.end()) {
+        return false;
+    }
+    const Node* node = it->second;
+    out = {node->user_id, node->username, node->contributions, rankOf(node)};
+    return true;
+}
+
+size_t Leaderboard::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return length;
+}
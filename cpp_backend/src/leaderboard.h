@@ -0,0 +1,75 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct LeaderboardEntry {
+  std::string user_id;
+  std::optional<std::string> username;
+  int contributions;
+  size_t rank; // 1-based
+};
+
+// Users ranked by contributions (descending), then username (ascending, users
+// without one last), then id. Backed by an indexed skip list: every link also
+// stores how many entries it skips, so rank lookups and rank-range pages cost
+// O(log n + page size), and a vote moves one user in O(log n).
+class Leaderboard {
+public:
+  Leaderboard();
+  ~Leaderboard();
+
+  Leaderboard(const Leaderboard&) = delete;
+  Leaderboard& operator=(const Leaderboard&) = delete;
+
+  // Add delta contributions, adding the user (without a username) if unknown
+  void adjust(const std::string& userId, int delta);
+  // Set the username, adding the user with no contributions if unknown
+  void setUsername(const std::string& userId, const std::optional<std::string>& username);
+  // Add or overwrite a user (startup load)
+  void put(const std::string& userId, const std::optional<std::string>& username, int contributions);
+
+  // Entries ranked offset + 1 .. offset + limit
+  std::vector<LeaderboardEntry> page(size_t offset, size_t limit) const;
+  bool find(const std::string& userId, LeaderboardEntry& out) const;
+  size_t size() const;
+
+private:
+  static constexpr int MAX_LEVEL = 32;
+
+  struct Node;
+  struct Link {
+    Node* next = nullptr;
+    size_t span = 0; // entries passed by following next, counting next itself
+  };
+  struct Node {
+    std::string user_id;
+    std::optional<std::string> username;
+    int contributions = 0;
+    std::vector<Link> links;
+  };
+
+  static bool before(const Node& a, const Node& b);
+  int randomLevel();
+  void link(Node* node);
+  void unlink(Node* node);
+  // Node with the given 1-based rank
+  const Node* nodeAt(size_t rank) const;
+  size_t rankOf(const Node* node) const;
+  Node* findOrCreate(const std::string& userId);
+
+  mutable std::shared_mutex mutex;
+  Node head;
+  int level = 1;
+  size_t length = 0;
+  std::mt19937 rng; // guarded by mutex (exclusive)
+  std::unordered_map<std::string, Node*> nodes;
+};
+
+#endif // LEADERBOARD_H
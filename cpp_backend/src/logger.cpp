@@ -0,0 +1,337 @@
+#include "logger.h"
+#include "config.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <streambuf>
+
+namespace {
+
+// Appends to a string whose capacity survives clear(), so steady-state records don't allocate
+class RecordBuf : public std::streambuf {
+public:
+    std::string text;
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            text.push_back(traits_type::to_char_type(ch));
+        }
+        return traits_type::not_eof(ch);
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        text.append(s, static_cast<size_t>(n));
+        return n;
+    }
+};
+
+const char* LEVEL_NAMES[] = {"trace", "debug", "info", "warn", "error", "off"};
+const char* LEVEL_LABELS[] = {"TRACE", "DEBUG", "INFO ", "WARN ", "ERROR", "OFF  "};
+
+const char* baseName(const char* path) {
+    const char* slash = std::strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// 2026-01-31T12:00:00.123Z TRACE [3] file.cpp:42 text
+void formatLine(std::string& out, std::chrono::system_clock::time_point time, LogLevel level,
+                uint32_t thread, const char* file, int line, const std::string& text) {
+    auto since_epoch = time.time_since_epoch();
+    std::time_t seconds = std::chrono::duration_cast<std::chrono::seconds>(since_epoch).count();
+    int millis = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch).count() % 1000);
+    std::tm tm{};
+    gmtime_r(&seconds, &tm);
+    char prefix[96];
+    int n = std::snprintf(prefix, sizeof(prefix), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ %s [%u] %s:%d ",
+                          tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, millis,
+                          LEVEL_LABELS[static_cast<int>(level)], thread, baseName(file), line);
+    out.append(prefix, std::min<size_t>(static_cast<size_t>(std::max(n, 0)), sizeof(prefix) - 1));
+    out += text;
+    out += '\n';
+}
+
+size_t ringCapacity() {
+    size_t capacity = 2;
+    while (capacity < LOG_RING_CAPACITY) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+} // namespace
+
+void writeLogValue(std::ostream& os, const std::string& value) {
+    bool quote = value.empty() || value.find_first_of(" \"=\n\\") != std::string::npos;
+    if (!quote) {
+        os << value;
+        return;
+    }
+    os << '"';
+    for (char ch : value) {
+        if (ch == '"' || ch == '\\') {
+            os << '\\' << ch;
+        } else if (ch == '\n') {
+            os << "\\n";
+        } else {
+            os << ch;
+        }
+    }
+    os << '"';
+}
+
+void writeLogValue(std::ostream& os, const char* value) {
+    writeLogValue(os, std::string(value ? value : ""));
+}
+
+// Single-producer (the owning thread) single-consumer (the drainer) ring
+struct Logger::Ring {
+    struct Slot {
+        std::chrono::system_clock::time_point time;
+        LogLevel level;
+        const char* file;
+        int line;
+        std::string text;
+    };
+
+    Ring(size_t capacity, uint32_t thread) : slots(capacity), mask(capacity - 1), thread(thread) {}
+
+    std::vector<Slot> slots;
+    const size_t mask;
+    const uint32_t thread;
+    alignas(64) std::atomic<uint64_t> head{0}; // next slot to drain
+    alignas(64) std::atomic<uint64_t> tail{0}; // next slot to fill
+    std::atomic<bool> closed{false};           // owning thread exited; drop once drained
+};
+
+struct Logger::ThreadState {
+    RecordBuf buf;
+    std::ostream stream{&buf};
+    uint32_t thread;
+    std::shared_ptr<Ring> ring;
+
+    explicit ThreadState(uint32_t thread) : thread(thread) {}
+    ~ThreadState() {
+        if (ring) {
+            ring->closed.store(true, std::memory_order_release);
+        }
+    }
+};
+
+Logger& Logger::instance() {
+    // Never destroyed, so logging from static destructors stays safe
+    static Logger* logger = new Logger();
+    return *logger;
+}
+
+Logger::Logger() {
+    LogLevel level = LogLevel::Info;
+    parseLevel(LOG_LEVEL, level);
+    min_level.store(static_cast<int>(level));
+    setRequestSampling(LOG_REQUEST_SAMPLE_EVERY);
+}
+
+Logger::ThreadState& Logger::threadState() {
+    thread_local ThreadState state(next_thread.fetch_add(1, std::memory_order_relaxed));
+    return state;
+}
+
+void Logger::setLevel(LogLevel level) {
+    min_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel Logger::level() const {
+    return static_cast<LogLevel>(min_level.load(std::memory_order_relaxed));
+}
+
+bool Logger::parseLevel(const std::string& name, LogLevel& out) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (int i = 0; i <= static_cast<int>(LogLevel::Off); ++i) {
+        if (lower == LEVEL_NAMES[i]) {
+            out = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Logger::setRequestSampling(unsigned int n) {
+    request_sample_every.store(std::max(n, 1u), std::memory_order_relaxed);
+}
+
+bool Logger::sampleRequest() {
+    const unsigned int every = request_sample_every.load(std::memory_order_relaxed);
+    if (every <= 1 || request_counter.fetch_add(1, std::memory_order_relaxed) % every == 0) {
+        return true;
+    }
+    sampled_out.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+std::ostream& Logger::begin() {
+    ThreadState& state = threadState();
+    state.buf.text.clear();
+    state.stream.clear();
+    return state.stream;
+}
+
+void Logger::commit(LogLevel level, const char* file, int line) {
+    ThreadState& state = threadState();
+    const auto now = std::chrono::system_clock::now();
+    records.fetch_add(1, std::memory_order_relaxed);
+
+    if (!running.load(std::memory_order_acquire)) {
+        std::string out;
+        formatLine(out, now, level, state.thread, file, line, state.buf.text);
+        writeOut(out);
+        return;
+    }
+
+    if (!state.ring) {
+        state.ring = std::make_shared<Ring>(ringCapacity(), state.thread);
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        rings.push_back(state.ring);
+    }
+    Ring& ring = *state.ring;
+    const uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    const uint64_t used = tail - ring.head.load(std::memory_order_acquire);
+    if (used > ring.mask) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Ring::Slot& slot = ring.slots[tail & ring.mask];
+    slot.time = now;
+    slot.level = level;
+    slot.file = file;
+    slot.line = line;
+    slot.text.assign(state.buf.text);
+    ring.tail.store(tail + 1, std::memory_order_release);
+
+    // Errors go out promptly; a filling ring shouldn't wait for the next round
+    if (level >= LogLevel::Error || used >= ring.mask / 2) {
+        wake_requested.store(true, std::memory_order_relaxed);
+        wake.notify_one();
+    }
+}
+
+void Logger::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (drainer.joinable()) {
+        return;
+    }
+    stopping = false;
+    running.store(true, std::memory_order_release);
+    drainer = std::thread([this]() { run(); });
+}
+
+void Logger::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!drainer.joinable()) {
+            return;
+        }
+        stopping = true;
+    }
+    // Later records are written synchronously; the drainer's last round picks up the rest
+    running.store(false, std::memory_order_release);
+    wake.notify_all();
+    drainer.join();
+}
+
+void Logger::run() {
+    std::string out;
+    while (true) {
+        bool stop_now;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MS), [&]() {
+                return stopping || wake_requested.exchange(false, std::memory_order_relaxed);
+            });
+            stop_now = stopping;
+        }
+
+        out.clear();
+        drain(out);
+        const uint64_t lost = dropped.load(std::memory_order_relaxed);
+        if (lost != reported_dropped) {
+            formatLine(out, std::chrono::system_clock::now(), LogLevel::Warn, 0, __FILE__, __LINE__,
+                       "Dropped " + std::to_string(lost - reported_dropped) + " log records: ring full");
+            reported_dropped = lost;
+        }
+        if (!out.empty()) {
+            writeOut(out);
+        }
+        if (stop_now) {
+            return;
+        }
+    }
+}
+
+bool Logger::drain(std::string& out) {
+    struct Record {
+        std::chrono::system_clock::time_point time;
+        LogLevel level;
+        uint32_t thread;
+        const char* file;
+        int line;
+        std::string text;
+    };
+    thread_local std::vector<Record> batch;
+    batch.clear();
+
+    std::vector<std::shared_ptr<Ring>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        snapshot = rings;
+    }
+    std::vector<Ring*> finished;
+    for (const auto& ring : snapshot) {
+        // Read closed first: a thread's last record is published before it exits
+        const bool closed = ring->closed.load(std::memory_order_acquire);
+        const uint64_t head = ring->head.load(std::memory_order_relaxed);
+        const uint64_t tail = ring->tail.load(std::memory_order_acquire);
+        for (uint64_t i = head; i < tail; ++i) {
+            const Ring::Slot& slot = ring->slots[i & ring->mask];
+            batch.push_back({slot.time, slot.level, ring->thread, slot.file, slot.line, slot.text});
+        }
+        ring->head.store(tail, std::memory_order_release);
+        if (closed) {
+            finished.push_back(ring.get());
+        }
+    }
+    if (!finished.empty()) {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        rings.erase(std::remove_if(rings.begin(), rings.end(), [&](const std::shared_ptr<Ring>& ring) {
+            return std::find(finished.begin(), finished.end(), ring.get()) != finished.end();
+        }), rings.end());
+    }
+
+    // Each ring is in order already; interleave them by time
+    std::stable_sort(batch.begin(), batch.end(), [](const Record& a, const Record& b) { return a.time < b.time; });
+    for (const Record& record : batch) {
+        formatLine(out, record.time, record.level, record.thread, record.file, record.line, record.text);
+    }
+    return !batch.empty();
+}
+
+void Logger::writeOut(const std::string& text) {
+    std::lock_guard<std::mutex> lock(output_mutex);
+    std::fwrite(text.data(), 1, text.size(), stderr);
+    std::fflush(stderr);
+}
+
+LoggerStats Logger::stats() const {
+    LoggerStats s;
+    s.level = LEVEL_NAMES[min_level.load(std::memory_order_relaxed)];
+    s.records = records.load(std::memory_order_relaxed);
+    s.dropped = dropped.load(std::memory_order_relaxed);
+    s.sampled_out = sampled_out.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        s.threads = rings.size();
+    }
+    return s;
+}
@@ -0,0 +1,145 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class LogLevel : int { Trace = 0, Debug = 1, Info = 2, Warn = 3, Error = 4, Off = 5 };
+
+// Statements below this level are compiled out, arguments and all (CMake LOG_COMPILE_LEVEL)
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 1
+#endif
+
+struct LoggerStats {
+  std::string level;
+  uint64_t records;
+  uint64_t dropped;  // ring full
+  uint64_t sampled_out;
+  size_t threads;    // rings registered
+};
+
+// key=value field for a log line; strings with spaces, quotes or '=' are quoted
+template <typename T>
+struct LogField {
+  const char* key;
+  const T& value;
+};
+
+template <typename T>
+LogField<T> kv(const char* key, const T& value) {
+  return {key, value};
+}
+
+void writeLogValue(std::ostream& os, const std::string& value);
+void writeLogValue(std::ostream& os, const char* value);
+template <typename T>
+void writeLogValue(std::ostream& os, const T& value) {
+  os << value;
+}
+
+template <typename T>
+std::ostream& operator<<(std::ostream& os, const LogField<T>& field) {
+  os << ' ' << field.key << '=';
+  writeLogValue(os, field.value);
+  return os;
+}
+
+// Asynchronous leveled logger. A record is formatted on the calling thread into
+// a thread-local buffer, only once its level is known to be enabled, and pushed
+// into that thread's lock-free single-producer ring. A background thread drains
+// all rings, orders the records by time and writes them to stderr in one write
+// per round. A full ring drops the record (counted) instead of blocking the
+// caller. Before start() and after stop(), records are written synchronously.
+class Logger {
+public:
+  static Logger& instance();
+
+  void start();
+  // Drain everything logged so far and stop the background thread
+  void stop();
+
+  bool enabled(LogLevel level) const {
+    return static_cast<int>(level) >= min_level.load(std::memory_order_relaxed);
+  }
+  void setLevel(LogLevel level);
+  LogLevel level() const;
+  // trace, debug, info, warn, error, off
+  static bool parseLevel(const std::string& name, LogLevel& out);
+
+  // One in every n LOG_REQUEST lines is written (n >= 1)
+  void setRequestSampling(unsigned int n);
+  bool sampleRequest();
+
+  // The calling thread's record buffer, cleared; fill it and call commit()
+  std::ostream& begin();
+  void commit(LogLevel level, const char* file, int line);
+
+  LoggerStats stats() const;
+
+private:
+  struct Ring;
+  struct ThreadState;
+
+  Logger();
+  ThreadState& threadState();
+  void run();
+  // Move every queued record out of the rings; returns whether any were found
+  bool drain(std::string& out);
+  void writeOut(const std::string& text);
+
+  std::atomic<int> min_level;
+  std::atomic<unsigned int> request_sample_every{1};
+  std::atomic<uint64_t> request_counter{0};
+
+  mutable std::mutex rings_mutex;
+  std::vector<std::shared_ptr<Ring>> rings;
+  std::atomic<uint32_t> next_thread{0};
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::atomic<bool> wake_requested{false};
+  std::atomic<bool> running{false};
+  bool stopping = false; // guarded by mutex
+  std::thread drainer;
+  std::mutex output_mutex;
+
+  std::atomic<uint64_t> records{0};
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<uint64_t> sampled_out{0};
+  uint64_t reported_dropped = 0; // drainer only
+};
+
+#define LOG_AT(level, ...)                                                              \
+  do {                                                                                  \
+    if (static_cast<int>(level) >= LOG_COMPILE_LEVEL && Logger::instance().enabled(level)) { \
+      Logger::instance().begin() << __VA_ARGS__;                                        \
+      Logger::instance().commit(level, __FILE__, __LINE__);                             \
+    }                                                                                   \
+  } while (0)
+
+#define LOG_TRACE(...) LOG_AT(LogLevel::Trace, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LogLevel::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LogLevel::Error, __VA_ARGS__)
+
+// Per-request debug lines, sampled (setRequestSampling) so debug logging stays
+// affordable under load
+#define LOG_REQUEST(...)                                                                \
+  do {                                                                                  \
+    if (static_cast<int>(LogLevel::Debug) >= LOG_COMPILE_LEVEL &&                       \
+        Logger::instance().enabled(LogLevel::Debug) && Logger::instance().sampleRequest()) { \
+      Logger::instance().begin() << __VA_ARGS__;                                        \
+      Logger::instance().commit(LogLevel::Debug, __FILE__, __LINE__);                   \
+    }                                                                                   \
+  } while (0)
+
+#endif // LOGGER_H
@@ -1,45 +1,106 @@
 #include <crow/crow.h>
 #include <crow/middlewares/cors.h>
 #include <nlohmann/json.hpp>
+#include <cstdlib>
 #include <future>
+#include <unordered_set>
 #include <boost/asio.hpp>
 #include <boost/asio/thread_pool.hpp>
 
 #include "config.h"
 #include "helpers.h"
 #include "database.h"
+#include "embedding_parser.h"
+#include "logger.h"
+#include "metrics.h"
+#include "metrics_middleware.h"
 
 int main() {
-    crow::App<crow::CORSHandler> app;
+    Logger& logger = Logger::instance();
+    if (const char* level_name = std::getenv("LOG_LEVEL")) {
+        LogLevel level;
+        if (Logger::parseLevel(level_name, level)) {
+            logger.setLevel(level);
+        } else {
+            LOG_WARN("Ignoring unknown LOG_LEVEL" << kv("value", level_name));
+        }
+    }
+    logger.start();
+    // Declared before the database so its shutdown messages are flushed too
+    struct LoggerStop {
+        ~LoggerStop() { Logger::instance().stop(); }
+    } logger_stop;
+
+    crow::App<crow::CORSHandler, MetricsMiddleware> app;
+    // Crow's own per-request lines only when our debug logging is on
+    app.loglevel(logger.enabled(LogLevel::Debug) ? crow::LogLevel::Info : crow::LogLevel::Warning);
+    // Outlives db, whose executor may still hold buffers at shutdown
+    FloatBufferPool embedding_buffers(EMBEDDING_DIM, EMBEDDING_BUFFER_POOL_SIZE);
     Database db; // Initialize database connection
 
     // Enable CORS for all routes
     auto& cors = app.get_middleware<crow::CORSHandler>();
     cors
         .global()
-        .headers("Content-Type", "Authorization") // Allow these headers
+        .headers("Content-Type", "Authorization", "If-None-Match") // Allow these headers
         .methods("POST"_method, "GET"_method, "OPTIONS"_method) // Allow these HTTP methods
         .origin("*") // Allow requests from any origin (for development)
         .allow_credentials();
+
+    // Route templates for /metrics labels - keep in sync with the CROW_ROUTEs below
+    Metrics& metrics = Metrics::instance();
+    metrics.addRoute("GET", "/videos/<string>");
+    metrics.addRoute("POST", "/videos");
+    metrics.addRoute("GET", "/videos/<string>/topics");
+    metrics.addRoute("POST", "/topics/batch");
+    metrics.addRoute("POST", "/videos/<string>/topics");
+    metrics.addRoute("POST", "/videos/<string>/embedding");
+    metrics.addRoute("GET", "/videos/<string>/similar");
+    metrics.addRoute("GET", "/videos/<string>/similar_hybrid");
+    metrics.addRoute("GET", "/videos/<string>/similar_by_vector");
+    metrics.addRoute("GET", "/users/contributions");
+    metrics.addRoute("GET", "/users/<string>/stats");
+    metrics.addRoute("GET", "/users/<string>/rank");
+    metrics.addRoute("GET", "/stats");
+    metrics.addRoute("GET", "/metrics");
+    metrics.addRoute("GET", "/test");
         
 
 
 
+    // Validators for the per-video GETs. The ETag is read from memory before the data, so a
+    // matching If-None-Match is answered with 304 without a query or serialization.
+    auto cacheHeaders = [](crow::response res, const std::string& etag) {
+        res.set_header("ETag", etag);
+        res.set_header("Cache-Control", VIDEO_CACHE_CONTROL);
+        return res;
+    };
+    auto notModified = [](const crow::request& req, const std::string& etag) {
+        return etagMatches(req.get_header_value("If-None-Match"), etag);
+    };
+
     // POST /videos: Add a new video with optional title
     // GET /videos/:id: Get a video by its ID
     CROW_ROUTE(app, "/videos/<string>").methods("GET"_method)([&](const crow::request& req, std::string videoId) {
-        std::cerr << "GET /videos/" << videoId << " received." << std::endl;
+        LOG_REQUEST("GET /videos/:id" << kv("video", videoId));
+        const std::string etag = db.getVideoEtag(videoId);
+        if (notModified(req, etag)) {
+            LOG_TRACE("Video not modified" << kv("video", videoId) << kv("etag", etag));
+            return cacheHeaders(crow::response(304), etag);
+        }
         try {
             nlohmann::json video = db.getVideoById(videoId);
 
             if (video.is_null()) {
-                std::cerr << "Video " << videoId << " not found in DB." << std::endl;
+                LOG_DEBUG("Video not found" << kv("video", videoId));
                 return crow::response(404, nlohmann::json{{"error", "Video not found."}}.dump());
             }
-            std::cerr << "Video " << videoId << " found in DB: " << video.dump() << std::endl;
-            return crow::response(200, video.dump());
+            LOG_TRACE("Video found" << kv("video", videoId) << kv("body", video.dump()));
+            return cacheHeaders(crow::response(200, video.dump()), etag);
+        } catch (const ServiceUnavailable& e) {
+            return crow::response(503, nlohmann::json{{"error", e.what()}}.dump());
         } catch (const std::exception& e) {
-            std::cerr << "Error in GET /videos/" << videoId << ": " << e.what() << std::endl;
+            LOG_ERROR("GET /videos/:id failed" << kv("video", videoId) << kv("error", e.what()));
             return crow::response(500, nlohmann::json{{"error", e.what()}}.dump());
         }
     });
@@ -48,17 +109,17 @@ int main() {
         auto json_body = nlohmann::json::parse(req.body);
         std::string url = json_body.value("id", ""); // Frontend sends URL in 'id' field
         std::string title = json_body.value("title", "");
-        std::cerr << "POST /videos received (async). URL: " << url << ", Title: " << title << std::endl;
+        LOG_REQUEST("POST /videos" << kv("url", url) << kv("title", title));
 
         if (url.empty()) {
-            std::cerr << "Error: Video URL is required." << std::endl;
+            LOG_DEBUG("POST /videos rejected: video URL is required");
             return crow::response(400, nlohmann::json{{"error", "Video URL is required."}}.dump());
         }
 
         std::string youtubeId = getYouTubeVideoId(url);
-        std::cerr << "Extracted YouTube ID: " << youtubeId << std::endl;
+        LOG_TRACE("Extracted YouTube ID" << kv("video", youtubeId));
         if (youtubeId.empty()) {
-            std::cerr << "Error: Invalid YouTube URL." << std::endl;
+            LOG_DEBUG("POST /videos rejected: invalid YouTube URL" << kv("url", url));
             return crow::response(400, nlohmann::json{{"error", "Invalid YouTube URL."}}.dump());
         }
 
@@ -67,48 +128,87 @@ int main() {
             nlohmann::json existingVideo = future.get();
 
             if (!existingVideo.is_null()) {
-                std::cerr << "Video " << youtubeId << " already exists. Returning existing video." << std::endl;
+                LOG_DEBUG("Video already exists" << kv("video", youtubeId));
                 return crow::response(200, existingVideo.dump());
             }
 
-            std::cerr << "Video " << youtubeId << " not found. Inserting new video (async)." << std::endl;
+            LOG_DEBUG("Inserting new video" << kv("video", youtubeId));
             auto insertFuture = db.insertVideoAsync(youtubeId, title);
             nlohmann::json newVideo = insertFuture.get();
-            std::cerr << "New video inserted: " << newVideo.dump() << std::endl;
+            LOG_TRACE("New video inserted" << kv("body", newVideo.dump()));
             return crow::response(201, newVideo.dump());
 
+        } catch (const ServiceUnavailable& e) {
+            return crow::response(503, nlohmann::json{{"error", e.what()}}.dump());
         } catch (const std::exception& e) {
-            std::cerr << "Error in POST /videos for " << youtubeId << ": " << e.what() << std::endl;
+            LOG_ERROR("POST /videos failed" << kv("video", youtubeId) << kv("error", e.what()));
             return crow::response(500, nlohmann::json{{"error", e.what()}}.dump());
         }
     });
 
     // GET /videos/:id/topics: Get topics and their aggregated votes for a video
     CROW_ROUTE(app, "/videos/<string>/topics").methods("GET"_method)([&](const crow::request& req, std::string videoId) {
-        std::cerr << "GET /videos/" << videoId << "/topics received (async)." << std::endl;
+        LOG_REQUEST("GET /videos/:id/topics" << kv("video", videoId));
+        const std::string etag = db.getVideoEtag(videoId);
+        if (notModified(req, etag)) {
+            LOG_TRACE("Topics not modified" << kv("video", videoId) << kv("etag", etag));
+            return cacheHeaders(crow::response(304), etag);
+        }
         try {
             auto future = db.getAggregatedTopicsForVideoAsync(videoId);
-            nlohmann::json topics = future.get();
-            nlohmann::json response_json;
-            response_json["video_id"] = videoId;
-            response_json["topics"] = topics;
-            std::cerr << "Returning topics for " << videoId << ": " << response_json.dump() << std::endl;
-            return crow::response(200, response_json.dump());
+            std::string body = future.get();
+            LOG_TRACE("Returning topics" << kv("video", videoId) << kv("body", body));
+            return cacheHeaders(crow::response(200, std::move(body)), etag);
+        } catch (const ServiceUnavailable& e) {
+            return crow::response(503, nlohmann::json{{"error", e.what()}}.dump());
         } catch (const std::exception& e) {
-            std::cerr << "Error in GET /videos/" << videoId << "/topics: " << e.what() << std::endl;
+            LOG_ERROR("GET /videos/:id/topics failed" << kv("video", videoId) << kv("error", e.what()));
+            return crow::response(500, nlohmann::json{{"error", e.what()}}.dump());
+        }
+    });
+
+    // POST /topics/batch: Get aggregated topics for many videos (a feed or search page) in one call
+    CROW_ROUTE(app, "/topics/batch").methods("POST"_method)([&](const crow::request& req) {
+        try {
+            auto json_body = nlohmann::json::parse(req.body);
+            if (!json_body.contains("video_ids") || !json_body["video_ids"].is_array()) {
+                return crow::response(400, nlohmann::json{{"error", "video_ids array is required."}}.dump());
+            }
+
+            std::vector<std::string> videoIds;
+            std::unordered_set<std::string> seen;
+            for (const auto& id : json_body["video_ids"]) {
+                if (!id.is_string()) {
+                    return crow::response(400, nlohmann::json{{"error", "video_ids must be strings."}}.dump());
+                }
+                if (seen.insert(id.get<std::string>()).second) {
+                    videoIds.push_back(id.get<std::string>());
+                }
+            }
+            if (videoIds.size() > MAX_BATCH_VIDEO_IDS) {
+                return crow::response(400, nlohmann::json{{"error", "Too many video_ids (max " + std::to_string(MAX_BATCH_VIDEO_IDS) + ")."}}.dump());
+            }
+
+            return crow::response(200, db.getAggregatedTopicsForVideos(videoIds));
+        } catch (const ServiceUnavailable& e) {
+            return crow::response(503, nlohmann::json{{"error", e.what()}}.dump());
+        } catch (const nlohmann::json::parse_error& e) {
+            return crow::response(400, nlohmann::json{{"error", "Invalid JSON body."}}.dump());
+        } catch (const std::exception& e) {
+            LOG_ERROR("POST /topics/batch failed" << kv("error", e.what()));
             return crow::response(500, nlohmann::json{{"error", e.what()}}.dump());
         }
     });
 
     // POST /videos/:id/topics: Submit a new topic or vote on an existing one
     CROW_ROUTE(app, "/videos/<string>/topics").methods("POST"_method)([&](const crow::request& req, std::string videoId) {
-        std::cerr << "POST /videos/" << videoId << "/topics received." << std::endl;
         auto json_body = nlohmann::json::parse(req.body);
         std::string topicName = json_body.value("name", "");
         int desiredVote = json_body.value("desired_vote", 0); // Expecting 1 for upvote, -1 for downvote
         std::string userId = json_body.value("user_id", ""); // Expecting user_id from request body
         int topicId = json_body.value("topic_id", 0);
-        std::cerr << "  Topic: " << topicName << ", Vote: " << desiredVote << ", User: " << userId << std::endl;
+        LOG_REQUEST("POST /videos/:id/topics" << kv("video", videoId) << kv("topic", topicName)
+                    << kv("topic_id", topicId) << kv("vote", desiredVote) << kv("user", userId));
 
         // Sanitize desiredVote: clamp to 1, 0, or -1
         if (desiredVote > 1) {
@@ -120,75 +220,62 @@ int main() {
         if (desiredVote != 1 && desiredVote != -1 && desiredVote != 0) {
             nlohmann::json error_json;
             error_json["error"] = "Desired vote must be 1 (upvote), -1 (downvote), or 0 (no vote).";
-            std::cerr << "  Error: Invalid desired vote." << std::endl;
+            LOG_DEBUG("Vote rejected: invalid desired vote" << kv("video", videoId));
             return crow::response(400, error_json.dump());
         }
 
         if (userId.empty()) {
             userId = generateUserId(); // Fallback if frontend doesn't provide user_id
-            std::cerr << "  Generated new user ID: " << userId << std::endl;
+            LOG_DEBUG("Generated new user ID" << kv("user", userId));
+        }
+
+        if (topicName.empty() && topicId == 0) {
+            LOG_DEBUG("Vote rejected: topic name or topic ID is required" << kv("video", videoId));
+            nlohmann::json error_json;
+            error_json["error"] = "Topic name or topic ID is required.";
+            return crow::response(400, error_json.dump());
         }
 
         try {
-            db.upsertUser(userId);
-            std::cerr << "  User upserted." << std::endl;
-
-            if (!topicName.empty()) {
-                nlohmann::json existingTopic = db.getTopicByName(topicName);
-                if (existingTopic.is_null()) {
-                    std::cerr << "  Topic '" << topicName << "' not found. Inserting new topic." << std::endl;
-                    topicId = db.insertTopic(topicName);
-                    if (topicId == 0) {
-                        std::cerr << "  Error: Failed to create new topic." << std::endl;
-                        nlohmann::json error_json;
-                        error_json["error"] = "Failed to create new topic.";
-                        return crow::response(500, error_json.dump());
-                    }
-                    std::cerr << "  New topic '" << topicName << "' inserted with ID: " << topicId << std::endl;
-                } else {
-                    topicId = existingTopic["id"].get<int>();
-                    std::cerr << "  Topic '" << topicName << "' found with ID: " << topicId << std::endl;
-                }
-            } else if (topicId == 0) {
-                std::cerr << "  Error: Topic name or topic ID is required." << std::endl;
+            nlohmann::json result = db.submitVote(videoId, topicName, topicId, userId, desiredVote);
+            if (result.is_null()) {
+                LOG_DEBUG("Vote rejected: unknown topic" << kv("video", videoId) << kv("topic_id", topicId));
                 nlohmann::json error_json;
-                error_json["error"] = "Topic name or topic ID is required.";
-                return crow::response(400, error_json.dump());
+                error_json["error"] = "Topic not found.";
+                return crow::response(404, error_json.dump());
             }
 
-            nlohmann::json existingVote = db.getVideoTopicVote(videoId, topicId, userId);
-            if (!existingVote.is_null()) {
-                int currentVote = existingVote["vote"].get<int>();
-                std::cerr << "  Existing vote found for video " << videoId << ", topic " << topicId << ", user " << userId << ": " << currentVote << std::endl;
-                if (currentVote == desiredVote) {
-                    // User is toggling off their vote
-                    db.deleteVideoTopicVote(videoId, topicId, userId);
-                    std::cerr << "  Vote removed." << std::endl;
-                    nlohmann::json success_json;
-                    success_json["message"] = "Vote removed successfully";
-                    success_json["user_id"] = userId;
-                    return crow::response(200, success_json.dump());
-                } else {
-                    // User is changing their vote (e.g., from +1 to -1, or -1 to +1)
-                    db.updateVideoTopicVote(videoId, topicId, userId, desiredVote);
-                    std::cerr << "  Vote updated to " << desiredVote << "." << std::endl;
-                    nlohmann::json success_json;
-                    success_json["message"] = "Vote updated successfully";
-                    success_json["user_id"] = userId;
-                    return crow::response(200, success_json.dump());
-                }
-            } else {
-                // No existing vote, insert new vote
-                db.insertVideoTopicVote(videoId, topicId, userId, desiredVote);
-                std::cerr << "  New vote " << desiredVote << " recorded." << std::endl;
-                nlohmann::json success_json;
-                success_json["message"] = "Vote recorded successfully";
-                success_json["user_id"] = userId;
-                return crow::response(201, success_json.dump());
+            std::string action = result["action"].get<std::string>();
+            LOG_DEBUG("Vote " << action << kv("video", videoId) << kv("topic_id", result["topic_id"].dump()) << kv("user", userId));
+
+            nlohmann::json success_json;
+            success_json["user_id"] = userId;
+            success_json["topic_id"] = result["topic_id"];
+            success_json["vote"] = result["vote"];
+            // Write-behind: logged and applied in memory, not yet in Postgres
+            const bool queued = result.value("queued", false);
+            if (queued) {
+                // false if the log sync failed: applied and queued, but lost if the process crashes first
+                success_json["durable"] = result.value("durable", true);
             }
-
+            if (action == "removed") {
+                success_json["message"] = "Vote removed successfully";
+                return crow::response(queued ? 202 : 200, success_json.dump());
+            } else if (action == "updated") {
+                success_json["message"] = "Vote updated successfully";
+                return crow::response(queued ? 202 : 200, success_json.dump());
+            }
+            success_json["message"] = "Vote recorded successfully";
+            return crow::response(queued ? 202 : 201, success_json.dump());
+
+        } catch (const ServiceUnavailable& e) {
+            return crow::response(503, nlohmann::json{{"error", e.what()}}.dump());
+        } catch (const NotFound& e) {
+            return crow::response(404, nlohmann::json{{"error", e.what()}}.dump());
+        } catch (const std::invalid_argument& e) {
+            return crow::response(400, nlohmann::json{{"error", e.what()}}.dump());
         } catch (const std::exception& e) {
-            std::cerr << "  Error occurred: " << e.what() << std::endl;
+            LOG_ERROR("POST /videos/:id/topics failed" << kv("video", videoId) << kv("error", e.what()));
             nlohmann::json error_json;
             error_json["error"] = e.what();
             return crow::response(500, error_json.dump());
@@ -197,41 +284,122 @@ int main() {
 
     // POST /videos/:id/embedding: Update a video's vector embedding
     CROW_ROUTE(app, "/videos/<string>/embedding").methods("POST"_method)([&](const crow::request& req, std::string videoId) {
-        std::cerr << "POST /videos/" << videoId << "/embedding received." << std::endl;
+        LOG_REQUEST("POST /videos/:id/embedding" << kv("video", videoId));
         try {
-            auto json_body = nlohmann::json::parse(req.body);
-            std::vector<float> embedding = json_body.at("embedding").get<std::vector<float>>();
-            std::cerr << "  Received embedding size: " << embedding.size() << std::endl;
-
-            if (embedding.empty() || embedding.size() != 384) { // Assuming 384 dimensions
-                std::cerr << "Error: Invalid embedding size." << std::endl;
-                return crow::response(400, nlohmann::json{{"error", "Invalid embedding size. Expected 1536 dimensions."}}.dump());
+            // Decoded straight into a pooled buffer that moves on to the executor task
+            PooledFloats embedding = embedding_buffers.acquire();
+            const bool raw = req.get_header_value("Content-Type").rfind("application/octet-stream", 0) == 0;
+            std::string error;
+            if (!(raw ? parseEmbeddingFloat32(req.body, embedding->data(), EMBEDDING_DIM, error)
+                      : parseEmbeddingJson(req.body, embedding->data(), EMBEDDING_DIM, error))) {
+                LOG_DEBUG("Embedding rejected" << kv("video", videoId) << kv("error", error));
+                return crow::response(400, nlohmann::json{{"error", error}}.dump());
             }
+            LOG_TRACE("Received embedding" << kv("video", videoId) << kv("format", raw ? "float32" : "json"));
 
-            db.updateVideoEmbeddingAsync(videoId, embedding);
-            std::cerr << "Embedding update initiated for video " << videoId << "." << std::endl;
+            db.updateVideoEmbeddingAsync(videoId, std::move(embedding));
+            LOG_DEBUG("Embedding update initiated" << kv("video", videoId));
             return crow::response(202, nlohmann::json{{"message", "Embedding update accepted."}}.dump());
+        } catch (const ServiceUnavailable& e) {
+            return crow::response(503, nlohmann::json{{"error", e.what()}}.dump());
+        } catch (const std::exception& e) {
+            LOG_ERROR("POST /videos/:id/embedding failed" << kv("video", videoId) << kv("error", e.what()));
+            return crow::response(500, nlohmann::json{{"error", e.what()}}.dump());
+        }
+    });
+
+    // GET /videos/:id/similar: Videos sharing the most topics with this one
+    CROW_ROUTE(app, "/videos/<string>/similar").methods("GET"_method)([&](const crow::request& req, std::string videoId) {
+        try {
+            int limit = SIMILAR_VIDEOS_DEFAULT_LIMIT;
+            try {
+                if (req.url_params.get("limit")) {
+                    limit = std::stoi(req.url_params.get("limit"));
+                }
+            } catch (const std::logic_error&) {
+                return crow::response(400, nlohmann::json{{"error", "limit must be a number."}}.dump());
+            }
+            if (limit < 1) {
+                return crow::response(400, nlohmann::json{{"error", "limit must be positive."}}.dump());
+            }
+
+            return crow::response(200, db.getSimilarVideosAsync(videoId, limit).get());
+        } catch (const ServiceUnavailable& e) {
+            return crow::response(503, nlohmann::json{{"error", e.what()}}.dump());
+        } catch (const std::exception& e) {
+            LOG_ERROR("GET /videos/:id/similar failed" << kv("video", videoId) << kv("error", e.what()));
+            return crow::response(500, nlohmann::json{{"error", e.what()}}.dump());
+        }
+    });
+
+    // GET /videos/:id/similar_hybrid: One ranking over topic overlap and embedding similarity
+    CROW_ROUTE(app, "/videos/<string>/similar_hybrid").methods("GET"_method)([&](const crow::request& req, std::string videoId) {
+        try {
+            int limit = SIMILAR_VIDEOS_DEFAULT_LIMIT;
+            double topic_weight = HYBRID_TOPIC_WEIGHT;
+            double vector_weight = HYBRID_VECTOR_WEIGHT;
+            try {
+                if (req.url_params.get("limit")) {
+                    limit = std::stoi(req.url_params.get("limit"));
+                }
+                if (req.url_params.get("topic_weight")) {
+                    topic_weight = std::stod(req.url_params.get("topic_weight"));
+                }
+                if (req.url_params.get("vector_weight")) {
+                    vector_weight = std::stod(req.url_params.get("vector_weight"));
+                }
+            } catch (const std::logic_error&) {
+                return crow::response(400, nlohmann::json{{"error", "limit, topic_weight and vector_weight must be numbers."}}.dump());
+            }
+            if (limit < 1 || !(topic_weight >= 0) || !(vector_weight >= 0) || topic_weight + vector_weight <= 0) {
+                return crow::response(400, nlohmann::json{{"error", "limit must be positive, weights non-negative and not both zero."}}.dump());
+            }
+
+            return crow::response(200, db.getSimilarVideosHybrid(videoId, limit, topic_weight, vector_weight));
+        } catch (const ServiceUnavailable& e) {
+            return crow::response(503, nlohmann::json{{"error", e.what()}}.dump());
         } catch (const std::exception& e) {
-            std::cerr << "Error in POST /videos/" << videoId << "/embedding: " << e.what() << std::endl;
+            LOG_ERROR("GET /videos/:id/similar_hybrid failed" << kv("video", videoId) << kv("error", e.what()));
             return crow::response(500, nlohmann::json{{"error", e.what()}}.dump());
         }
     });
 
     // GET /videos/:id/similar_by_vector: Get similar videos based on vector embedding
     CROW_ROUTE(app, "/videos/<string>/similar_by_vector").methods("GET"_method)([&](const crow::request& req, std::string videoId) {
-        std::cerr << "GET /videos/" << videoId << "/similar_by_vector received." << std::endl;
+        LOG_REQUEST("GET /videos/:id/similar_by_vector" << kv("video", videoId));
         try {
             int limit = 10;
-            if (req.url_params.get("limit")) {
-                limit = std::stoi(req.url_params.get("limit"));
+            double min_similarity = -1.0;
+            int probes = 0;
+            int ef = 0;
+            try {
+                if (req.url_params.get("limit")) {
+                    limit = std::stoi(req.url_params.get("limit"));
+                }
+                if (req.url_params.get("min_similarity")) {
+                    min_similarity = std::stod(req.url_params.get("min_similarity"));
+                }
+                if (req.url_params.get("probes")) {
+                    probes = std::stoi(req.url_params.get("probes"));
+                }
+                if (req.url_params.get("ef")) {
+                    ef = std::stoi(req.url_params.get("ef"));
+                }
+            } catch (const std::logic_error&) {
+                return crow::response(400, nlohmann::json{{"error", "limit, min_similarity, probes and ef must be numbers."}}.dump());
+            }
+            if (limit < 1 || probes < 0 || ef < 0) {
+                return crow::response(400, nlohmann::json{{"error", "limit must be positive, probes and ef non-negative."}}.dump());
             }
 
-            auto future = db.getSimilarVideosByVectorAsync(videoId, limit);
-            nlohmann::json similar = future.get();
-            std::cerr << "Returning vector-similar videos for " << videoId << ": " << similar.dump() << std::endl;
-            return crow::response(200, similar.dump());
+            auto future = db.getSimilarVideosByVectorAsync(videoId, limit, min_similarity, probes, ef);
+            std::string body = future.get();
+            LOG_TRACE("Returning vector-similar videos" << kv("video", videoId) << kv("body", body));
+            return crow::response(200, std::move(body));
+        } catch (const ServiceUnavailable& e) {
+            return crow::response(503, nlohmann::json{{"error", e.what()}}.dump());
         } catch (const std::exception& e) {
-            std::cerr << "Error in GET /videos/" << videoId << "/similar_by_vector: " << e.what() << std::endl;
+            LOG_ERROR("GET /videos/:id/similar_by_vector failed" << kv("video", videoId) << kv("error", e.what()));
             return crow::response(500, nlohmann::json{{"error", e.what()}}.dump());
         }
     });
@@ -239,48 +407,104 @@ int main() {
     // GET /users/:id/stats: Get user statistics
     CROW_ROUTE(app, "/users/<string>/stats").methods("GET"_method)([&](const crow::request& req, std::string userId) {
         try {
-            auto userDetailsFuture = db.getUserDetailsAsync(userId);
-            nlohmann::json userDetails = userDetailsFuture.get();
-
-            if (userDetails.is_null()) {
+            nlohmann::json stats = db.getUserStatsAsync(userId).get();
+            if (stats.is_null()) {
                 return crow::response(404, nlohmann::json{{"error", "User not found."}}.dump());
             }
-
-            // Launch all async operations concurrently
-            auto submissionsFuture = db.getUserSubmissionsCountAsync(userId);
-            auto lastDateFuture = db.getUserLastSubmissionDateAsync(userId);
-            auto tagFuture = db.getUserMostFrequentTagAsync(userId);
-
-            // Wait for all to complete
-            int submissionsCount = submissionsFuture.get();
-            std::string lastSubmissionDate = lastDateFuture.get();
-            nlohmann::json mostFrequentTag = tagFuture.get();
-
-            nlohmann::json response_json;
-            response_json["user_id"] = userDetails["id"];
-            response_json["username"] = userDetails["username"];
-            response_json["reputation"] = userDetails["reputation"];
-            response_json["created_at"] = userDetails["created_at"];
-            response_json["submissions_count"] = submissionsCount;
-            response_json["last_submission_date"] = lastSubmissionDate;
-            response_json["most_frequent_tag"] = mostFrequentTag;
-
-            return crow::response(200, response_json.dump());
+            return crow::response(200, stats.dump());
+        } catch (const ServiceUnavailable& e) {
+            return crow::response(503, nlohmann::json{{"error", e.what()}}.dump());
         } catch (const std::exception& e) {
             return crow::response(500, nlohmann::json{{"error", e.what()}}.dump());
         }
     });
 
-    // GET /users/contributions: Get all users with their contribution counts
+    // GET /users/contributions: One page of users ranked by contribution count
     CROW_ROUTE(app, "/users/contributions").methods("GET"_method)([&](const crow::request& req) {
         try {
-            nlohmann::json usersWithContributions = db.getAllUsersWithContributionCounts();
-            return crow::response(200, usersWithContributions.dump());
+            long offset = 0;
+            long limit = CONTRIBUTIONS_DEFAULT_LIMIT;
+            try {
+                if (req.url_params.get("offset")) {
+                    offset = std::stol(req.url_params.get("offset"));
+                }
+                if (req.url_params.get("limit")) {
+                    limit = std::stol(req.url_params.get("limit"));
+                }
+            } catch (const std::logic_error&) {
+                return crow::response(400, nlohmann::json{{"error", "offset and limit must be numbers."}}.dump());
+            }
+            if (offset < 0 || limit < 1) {
+                return crow::response(400, nlohmann::json{{"error", "offset must be non-negative and limit positive."}}.dump());
+            }
+            limit = std::min(limit, static_cast<long>(MAX_CONTRIBUTIONS_LIMIT));
+
+            crow::response res(200, db.getUserContributions(offset, limit));
+            res.add_header("X-Total-Count", std::to_string(db.getContributorCount()));
+            return res;
+        } catch (const ServiceUnavailable& e) {
+            return crow::response(503, nlohmann::json{{"error", e.what()}}.dump());
         } catch (const std::exception& e) {
             return crow::response(500, nlohmann::json{{"error", e.what()}}.dump());
         }
     });
 
+    // GET /users/:id/rank: A user's position on the contributions leaderboard
+    CROW_ROUTE(app, "/users/<string>/rank").methods("GET"_method)([&](const crow::request& req, std::string userId) {
+        nlohmann::json rank = db.getUserRank(userId);
+        if (rank.is_null()) {
+            return crow::response(404, nlohmann::json{{"error", "User not found."}}.dump());
+        }
+        return crow::response(200, rank.dump());
+    });
+
+
+    // GET /stats: Internal counters for the connection pool, executor, caches and logger
+    CROW_ROUTE(app, "/stats").methods("GET"_method)([&](const crow::request& req) {
+        nlohmann::json stats;
+        stats["db_pool"] = db.getPoolStats();
+        stats["executor"] = db.getExecutorStats();
+        stats["tally_cache"] = db.getTallyCacheStats();
+        stats["key_cache"] = db.getKeyCacheStats();
+        stats["vote_pipeline"] = db.getVotePipelineStats();
+        stats["topic_index"] = db.getTopicIndexStats();
+        stats["vector_index"] = db.getVectorIndexStats();
+        LoggerStats log_stats = Logger::instance().stats();
+        stats["logger"]["level"] = log_stats.level;
+        stats["logger"]["records"] = log_stats.records;
+        stats["logger"]["dropped"] = log_stats.dropped;
+        stats["logger"]["sampled_out"] = log_stats.sampled_out;
+        stats["logger"]["threads"] = log_stats.threads;
+        return crow::response(200, stats.dump());
+    });
+
+    // GET /metrics: Prometheus text format - per-route and per-statement latency, executor and pool
+    CROW_ROUTE(app, "/metrics").methods("GET"_method)([&](const crow::request& req) {
+        std::string body;
+        Metrics::instance().render(body);
+        nlohmann::json executor = db.getExecutorStats();
+        Metrics::renderValue(body, "executor_queue_depth", "gauge", "Tasks waiting for an executor thread.",
+                             executor["queue_depth"].get<double>());
+        Metrics::renderValue(body, "executor_active", "gauge", "Tasks running on executor threads.",
+                             executor["active"].get<double>());
+        Metrics::renderValue(body, "executor_rejected_total", "counter", "Tasks rejected because the queue was full.",
+                             executor["rejected"].get<double>());
+        Metrics::renderValue(body, "executor_queue_wait_seconds_total", "counter", "Time tasks spent queued.",
+                             executor["total_queue_wait_us"].get<double>() / 1e6);
+        nlohmann::json pool = db.getPoolStats();
+        Metrics::renderValue(body, "db_pool_in_use", "gauge", "Connections checked out of the pool.",
+                             pool["in_use"].get<double>());
+        Metrics::renderValue(body, "db_pool_waits_total", "counter", "Acquisitions that had to wait for a connection.",
+                             pool["waits"].get<double>());
+        Metrics::renderValue(body, "db_pool_wait_seconds_total", "counter", "Time spent waiting for a connection.",
+                             pool["total_wait_us"].get<double>() / 1e6);
+        Metrics::renderValue(body, "db_pool_timeouts_total", "counter", "Acquisitions that timed out.",
+                             pool["timeouts"].get<double>());
+
+        crow::response res(200, body);
+        res.set_header("Content-Type", "text/plain; version=0.0.4");
+        return res;
+    });
 
     // Test route
     CROW_ROUTE(app, "/test")([&](){
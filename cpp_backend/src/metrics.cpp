@@ -0,0 +1,340 @@
+#include "metrics.h"
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+const char* METRIC_PREFIX = "youtube_topics_";
+
+// Histogram `le` bounds: powers of two from 16 us to ~8.4 s, which are bucket edges
+const int LE_MIN_SHIFT = 4;
+const int LE_MAX_SHIFT = 23;
+
+const double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+size_t threadStripe() {
+    static std::atomic<size_t> next_stripe{0};
+    thread_local size_t stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % METRICS_HISTOGRAM_STRIPES;
+    return stripe;
+}
+
+void appendHeader(std::string& out, const std::string& name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += METRIC_PREFIX;
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += METRIC_PREFIX;
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void appendNumber(std::string& out, double value) {
+    char buf[32];
+    int n = std::snprintf(buf, sizeof(buf), "%.9g", value);
+    out.append(buf, static_cast<size_t>(std::max(n, 0)));
+}
+
+// name{labels} value; labels is the already formatted list without braces
+void appendSample(std::string& out, const std::string& name, const std::string& labels, double value) {
+    out += METRIC_PREFIX;
+    out += name;
+    if (!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    appendNumber(out, value);
+    out += '\n';
+}
+
+std::string label(const char* key, const std::string& value) {
+    std::string out = key;
+    out += "=\"";
+    for (char ch : value) {
+        if (ch == '\\' || ch == '"') {
+            out += '\\';
+            out += ch;
+        } else if (ch == '\n') {
+            out += "\\n";
+        } else {
+            out += ch;
+        }
+    }
+    out += '"';
+    return out;
+}
+
+void appendHistogram(std::string& out, const std::string& name, const std::string& labels,
+                     const LatencyHistogram::Snapshot& s) {
+    const std::string prefix = labels.empty() ? "" : labels + ",";
+    char le[32];
+    for (int shift = LE_MIN_SHIFT; shift <= LE_MAX_SHIFT; ++shift) {
+        const uint64_t bound_us = uint64_t(1) << shift;
+        std::snprintf(le, sizeof(le), "le=\"%.9g\"", bound_us / 1e6);
+        appendSample(out, name + "_bucket", prefix + le, static_cast<double>(s.countBelow(bound_us)));
+    }
+    appendSample(out, name + "_bucket", prefix + "le=\"+Inf\"", static_cast<double>(s.count));
+    appendSample(out, name + "_sum", labels, s.sum_us / 1e6);
+    appendSample(out, name + "_count", labels, static_cast<double>(s.count));
+}
+
+void appendQuantiles(std::string& out, const std::string& name, const std::string& labels,
+                     const LatencyHistogram::Snapshot& s) {
+    const std::string prefix = labels.empty() ? "" : labels + ",";
+    char quantile[32];
+    for (double q : QUANTILES) {
+        std::snprintf(quantile, sizeof(quantile), "quantile=\"%g\"", q);
+        appendSample(out, name, prefix + quantile, s.quantile(q) / 1e6);
+    }
+}
+
+bool matchesRoute(const std::vector<std::string>& segments, const std::string& path) {
+    const size_t stop = std::min(path.find('?'), path.size());
+    size_t pos = 0;
+    size_t i = 0;
+    while (pos < stop) {
+        if (path[pos] == '/') {
+            ++pos;
+            continue;
+        }
+        size_t end = std::min(path.find('/', pos), stop);
+        if (i == segments.size()) {
+            return false;
+        }
+        const std::string& segment = segments[i++];
+        const bool parameter = !segment.empty() && segment.front() == '<';
+        if (!parameter && path.compare(pos, end - pos, segment) != 0) {
+            return false;
+        }
+        pos = end;
+    }
+    return i == segments.size();
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram()
+    : shards(std::make_unique<Shard[]>(METRICS_HISTOGRAM_STRIPES)) {}
+
+size_t LatencyHistogram::bucketFor(uint64_t micros) {
+    if (micros < SUB_BUCKETS) {
+        return static_cast<size_t>(micros);
+    }
+    const int magnitude = 63 - __builtin_clzll(micros); // >= 3
+    const size_t octave = static_cast<size_t>(magnitude - 3);
+    if (octave >= (BUCKETS - SUB_BUCKETS) / SUB_BUCKETS) {
+        return BUCKETS - 1;
+    }
+    const size_t sub = static_cast<size_t>(micros >> octave) & (SUB_BUCKETS - 1);
+    return SUB_BUCKETS + octave * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketLower(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    const size_t octave = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+    const size_t sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+    return static_cast<uint64_t>(SUB_BUCKETS + sub) << octave;
+}
+
+uint64_t LatencyHistogram::bucketUpper(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket + 1;
+    }
+    const size_t octave = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+    const size_t sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+    return static_cast<uint64_t>(SUB_BUCKETS + sub + 1) << octave;
+}
+
+void LatencyHistogram::record(uint64_t micros) {
+    Shard& shard = shards[threadStripe()];
+    shard.counts[bucketFor(micros)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum_us.fetch_add(micros, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot s;
+    for (size_t i = 0; i < METRICS_HISTOGRAM_STRIPES; ++i) {
+        const Shard& shard = shards[i];
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            s.counts[b] += shard.counts[b].load(std::memory_order_relaxed);
+        }
+        s.sum_us += shard.sum_us.load(std::memory_order_relaxed);
+    }
+    for (uint64_t c : s.counts) {
+        s.count += c;
+    }
+    return s;
+}
+
+uint64_t LatencyHistogram::Snapshot::countBelow(uint64_t micros) const {
+    uint64_t below = 0;
+    for (size_t b = 0; b < BUCKETS && bucketUpper(b) <= micros; ++b) {
+        below += counts[b];
+    }
+    return below;
+}
+
+double LatencyHistogram::Snapshot::quantile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count))));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKETS; ++b) {
+        seen += counts[b];
+        if (seen >= rank) {
+            return (bucketLower(b) + bucketUpper(b)) / 2.0;
+        }
+    }
+    return static_cast<double>(bucketUpper(BUCKETS - 1));
+}
+
+Metrics& Metrics::instance() {
+    // Never destroyed, like the logger: handlers may still record during shutdown
+    static Metrics* metrics = new Metrics();
+    return *metrics;
+}
+
+Metrics::Metrics() : other_route(std::make_unique<RouteMetrics>()) {
+    other_route->route = "other";
+}
+
+void Metrics::addRoute(const std::string& method, const std::string& pattern) {
+    auto route = std::make_unique<RouteMetrics>();
+    route->method = method;
+    route->route = pattern;
+    size_t pos = 0;
+    while (pos < pattern.size()) {
+        size_t end = std::min(pattern.find('/', pos), pattern.size());
+        if (end > pos) {
+            route->segments.push_back(pattern.substr(pos, end - pos));
+        }
+        pos = end + 1;
+    }
+    routes.push_back(std::move(route));
+}
+
+RouteMetrics& Metrics::route(const std::string& method, const std::string& path) {
+    for (const auto& route : routes) {
+        if (route->method == method && matchesRoute(route->segments, path)) {
+            return *route;
+        }
+    }
+    return *other_route;
+}
+
+void Metrics::requestFinished(RouteMetrics& route, int status, std::chrono::steady_clock::time_point start) {
+    route.latency.record(start);
+    route.statuses[static_cast<size_t>(std::clamp(status, 0, 599))].fetch_add(1, std::memory_order_relaxed);
+    in_flight.fetch_sub(1, std::memory_order_relaxed);
+}
+
+StatementMetrics& Metrics::statement(const char* name) {
+    thread_local std::unordered_map<const char*, StatementMetrics*> cache;
+    auto it = cache.find(name);
+    if (it != cache.end()) {
+        return *it->second;
+    }
+    std::lock_guard<std::mutex> lock(statements_mutex);
+    std::unique_ptr<StatementMetrics>& entry = statements[name];
+    if (!entry) {
+        entry = std::make_unique<StatementMetrics>();
+        entry->name = name;
+    }
+    cache.emplace(name, entry.get());
+    return *entry;
+}
+
+void Metrics::renderValue(std::string& out, const std::string& name, const char* type, const char* help,
+                          double value) {
+    appendHeader(out, name, type, help);
+    appendSample(out, name, "", value);
+}
+
+void Metrics::render(std::string& out) const {
+    renderValue(out, "http_requests_in_flight", "gauge", "HTTP requests being handled.",
+                static_cast<double>(in_flight.load(std::memory_order_relaxed)));
+
+    std::vector<const RouteMetrics*> all_routes;
+    for (const auto& route : routes) {
+        all_routes.push_back(route.get());
+    }
+    all_routes.push_back(other_route.get());
+    std::vector<LatencyHistogram::Snapshot> route_latency;
+    for (const RouteMetrics* route : all_routes) {
+        route_latency.push_back(route->latency.snapshot());
+    }
+
+    appendHeader(out, "http_requests_total", "counter", "HTTP requests by route, method and status.");
+    for (const RouteMetrics* route : all_routes) {
+        const std::string labels = label("method", route->method) + "," + label("route", route->route);
+        for (size_t status = 0; status < route->statuses.size(); ++status) {
+            const uint64_t n = route->statuses[status].load(std::memory_order_relaxed);
+            if (n > 0) {
+                appendSample(out, "http_requests_total", labels + "," + label("status", std::to_string(status)),
+                             static_cast<double>(n));
+            }
+        }
+    }
+
+    // Only series that have seen a request, so unused routes don't add empty buckets
+    appendHeader(out, "http_request_duration_seconds", "histogram", "HTTP request latency by route.");
+    for (size_t i = 0; i < all_routes.size(); ++i) {
+        if (route_latency[i].count > 0) {
+            appendHistogram(out, "http_request_duration_seconds",
+                            label("method", all_routes[i]->method) + "," + label("route", all_routes[i]->route),
+                            route_latency[i]);
+        }
+    }
+    appendHeader(out, "http_request_duration_quantile_seconds", "gauge",
+                 "HTTP request latency quantiles since startup (12.5% resolution).");
+    for (size_t i = 0; i < all_routes.size(); ++i) {
+        if (route_latency[i].count > 0) {
+            appendQuantiles(out, "http_request_duration_quantile_seconds",
+                            label("method", all_routes[i]->method) + "," + label("route", all_routes[i]->route),
+                            route_latency[i]);
+        }
+    }
+
+    // Entries are never removed, so the pointers outlive the lock
+    std::vector<const StatementMetrics*> all_statements;
+    {
+        std::lock_guard<std::mutex> lock(statements_mutex);
+        for (const auto& entry : statements) {
+            all_statements.push_back(entry.second.get());
+        }
+    }
+    std::sort(all_statements.begin(), all_statements.end(),
+              [](const StatementMetrics* a, const StatementMetrics* b) { return a->name < b->name; });
+    std::vector<LatencyHistogram::Snapshot> statement_latency;
+    for (const StatementMetrics* statement : all_statements) {
+        statement_latency.push_back(statement->latency.snapshot());
+    }
+
+    appendHeader(out, "db_statement_duration_seconds", "histogram",
+                 "Prepared statement execution time, including the round trip to Postgres.");
+    for (size_t i = 0; i < all_statements.size(); ++i) {
+        appendHistogram(out, "db_statement_duration_seconds", label("statement", all_statements[i]->name),
+                        statement_latency[i]);
+    }
+    appendHeader(out, "db_statement_duration_quantile_seconds", "gauge",
+                 "Prepared statement latency quantiles since startup (12.5% resolution).");
+    for (size_t i = 0; i < all_statements.size(); ++i) {
+        appendQuantiles(out, "db_statement_duration_quantile_seconds", label("statement", all_statements[i]->name),
+                        statement_latency[i]);
+    }
+    appendHeader(out, "db_statement_errors_total", "counter", "Prepared statements that threw.");
+    for (const StatementMetrics* statement : all_statements) {
+        appendSample(out, "db_statement_errors_total", label("statement", statement->name),
+                     static_cast<double>(statement->errors.load(std::memory_order_relaxed)));
+    }
+}
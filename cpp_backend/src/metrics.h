@@ -0,0 +1,107 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Log-linear (HDR-style) latency histogram in microseconds: exact below 8 us, then
+// 8 sub-buckets per power of two, so any recorded value is off by at most 12.5%.
+// Counts are striped across cache-line-aligned shards picked per thread, so
+// recording is a relaxed fetch_add on a line no other thread usually touches;
+// snapshot() merges the shards.
+class LatencyHistogram {
+public:
+  static constexpr size_t SUB_BUCKETS = 8;
+  static constexpr size_t BUCKETS = SUB_BUCKETS + 33 * SUB_BUCKETS; // up to 2^36 us
+
+  struct Snapshot {
+    std::array<uint64_t, BUCKETS> counts{};
+    uint64_t count = 0;
+    uint64_t sum_us = 0;
+
+    // Values recorded below `micros`, which must be a power of two >= SUB_BUCKETS
+    uint64_t countBelow(uint64_t micros) const;
+    // Midpoint of the bucket holding the q-th value, in microseconds
+    double quantile(double q) const;
+  };
+
+  LatencyHistogram();
+
+  void record(uint64_t micros);
+  void record(std::chrono::steady_clock::time_point start) {
+    record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count()));
+  }
+  Snapshot snapshot() const;
+
+  static size_t bucketFor(uint64_t micros);
+  static uint64_t bucketLower(size_t bucket);
+  static uint64_t bucketUpper(size_t bucket);
+
+private:
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> counts[BUCKETS];
+    std::atomic<uint64_t> sum_us;
+  };
+  std::unique_ptr<Shard[]> shards;
+};
+
+struct RouteMetrics {
+  std::string method;
+  std::string route;
+  std::vector<std::string> segments; // of route; "<...>" matches any one segment
+  LatencyHistogram latency;
+  std::array<std::atomic<uint64_t>, 600> statuses{};
+};
+
+struct StatementMetrics {
+  std::string name;
+  LatencyHistogram latency;
+  std::atomic<uint64_t> errors{0};
+};
+
+// Process-wide request and prepared-statement metrics, rendered in the
+// Prometheus text format by GET /metrics.
+class Metrics {
+public:
+  static Metrics& instance();
+
+  // Route templates requests are labelled with, in Crow's syntax
+  // ("/videos/<string>/topics"). Register them all before serving: lookups
+  // don't lock. Requests matching none are counted under route "other".
+  void addRoute(const std::string& method, const std::string& pattern);
+  RouteMetrics& route(const std::string& method, const std::string& path);
+
+  void requestStarted() { in_flight.fetch_add(1, std::memory_order_relaxed); }
+  void requestFinished(RouteMetrics& route, int status, std::chrono::steady_clock::time_point start);
+
+  // Metrics for a prepared statement; `name` must be a string literal (it is
+  // cached per thread by address)
+  StatementMetrics& statement(const char* name);
+
+  // Appends every family above in the Prometheus text exposition format
+  void render(std::string& out) const;
+
+  // One-sample families for values owned elsewhere (executor, pool); type is "gauge" or "counter"
+  static void renderValue(std::string& out, const std::string& name, const char* type, const char* help,
+                          double value);
+
+private:
+  Metrics();
+
+  std::vector<std::unique_ptr<RouteMetrics>> routes;
+  std::unique_ptr<RouteMetrics> other_route;
+  std::atomic<int64_t> in_flight{0};
+
+  mutable std::mutex statements_mutex;
+  std::unordered_map<std::string, std::unique_ptr<StatementMetrics>> statements;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,25 @@
+#ifndef METRICS_MIDDLEWARE_H
+#define METRICS_MIDDLEWARE_H
+
+#include <chrono>
+#include <crow/crow.h>
+#include "metrics.h"
+
+// Crow middleware feeding Metrics: requests in flight, and status and latency per route
+struct MetricsMiddleware {
+  struct context {
+    std::chrono::steady_clock::time_point start;
+  };
+
+  void before_handle(crow::request& req, crow::response& res, context& ctx) {
+    ctx.start = std::chrono::steady_clock::now();
+    Metrics::instance().requestStarted();
+  }
+
+  void after_handle(crow::request& req, crow::response& res, context& ctx) {
+    Metrics& metrics = Metrics::instance();
+    metrics.requestFinished(metrics.route(crow::method_name(req.method), req.url), res.code, ctx.start);
+  }
+};
+
+#endif // METRICS_MIDDLEWARE_H
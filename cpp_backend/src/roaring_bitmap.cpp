@@ -0,0 +1,140 @@
+#include "roaring_bitmap.h"
+#include <algorithm>
+
+namespace {
+
+uint16_t highBits(uint32_t id) {
+    return static_cast<uint16_t>(id >> 16);
+}
+
+uint16_t lowBits(uint32_t id) {
+    return static_cast<uint16_t>(id & 0xFFFF);
+}
+
+} // namespace
+
+const RoaringBitmap::Container* RoaringBitmap::find(uint16_t key) const {
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    return it != containers.end() && it->key == key ? &*it : nullptr;
+}
+
+RoaringBitmap::Container* RoaringBitmap::find(uint16_t key) {
+    return const_cast<Container*>(static_cast<const RoaringBitmap*>(this)->find(key));
+}
+
+void RoaringBitmap::toBitmap(Container& c) {
+    c.words.assign(BITMAP_WORDS, 0);
+    for (uint16_t low : c.array) {
+        c.words[low / 64] |= uint64_t{1} << (low % 64);
+    }
+    std::vector<uint16_t>().swap(c.array);
+}
+
+void RoaringBitmap::toArray(Container& c) {
+    c.array.clear();
+    c.array.reserve(c.cardinality);
+    for (size_t w = 0; w < BITMAP_WORDS; ++w) {
+        uint64_t word = c.words[w];
+        while (word) {
+            c.array.push_back(static_cast<uint16_t>(w * 64 + __builtin_ctzll(word)));
+            word &= word - 1;
+        }
+    }
+    std::vector<uint64_t>().swap(c.words);
+}
+
+bool RoaringBitmap::add(uint32_t id) {
+    const uint16_t key = highBits(id);
+    const uint16_t low = lowBits(id);
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    if (it == containers.end() || it->key != key) {
+        it = containers.insert(it, Container{});
+        it->key = key;
+    }
+    Container& c = *it;
+
+    if (c.isBitmap()) {
+        uint64_t& word = c.words[low / 64];
+        uint64_t bit = uint64_t{1} << (low % 64);
+        if (word & bit) {
+            return false;
+        }
+        word |= bit;
+        ++c.cardinality;
+        return true;
+    }
+    auto pos = std::lower_bound(c.array.begin(), c.array.end(), low);
+    if (pos != c.array.end() && *pos == low) {
+        return false;
+    }
+    c.array.insert(pos, low);
+    if (++c.cardinality > ARRAY_MAX) {
+        toBitmap(c);
+    }
+    return true;
+}
+
+bool RoaringBitmap::remove(uint32_t id) {
+    const uint16_t key = highBits(id);
+    const uint16_t low = lowBits(id);
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    if (it == containers.end() || it->key != key) {
+        return false;
+    }
+    Container& c = *it;
+
+    if (c.isBitmap()) {
+        uint64_t& word = c.words[low / 64];
+        uint64_t bit = uint64_t{1} << (low % 64);
+        if (!(word & bit)) {
+            return false;
+        }
+        word &= ~bit;
+        // Convert back only well below the threshold so add/remove at the boundary doesn't flip-flop
+        if (--c.cardinality <= ARRAY_MAX / 2) {
+            toArray(c);
+        }
+    } else {
+        auto pos = std::lower_bound(c.array.begin(), c.array.end(), low);
+        if (pos == c.array.end() || *pos != low) {
+            return false;
+        }
+        c.array.erase(pos);
+        --c.cardinality;
+    }
+    if (c.cardinality == 0) {
+        containers.erase(it);
+    }
+    return true;
+}
+
+bool RoaringBitmap::contains(uint32_t id) const {
+    const Container* c = find(highBits(id));
+    if (!c) {
+        return false;
+    }
+    const uint16_t low = lowBits(id);
+    if (c->isBitmap()) {
+        return (c->words[low / 64] >> (low % 64)) & 1;
+    }
+    return std::binary_search(c->array.begin(), c->array.end(), low);
+}
+
+uint64_t RoaringBitmap::cardinality() const {
+    uint64_t total = 0;
+    for (const Container& c : containers) {
+        total += c.cardinality;
+    }
+    return total;
+}
+
+size_t RoaringBitmap::bytes() const {
+    size_t total = containers.capacity() * sizeof(Container);
+    for (const Container& c : containers) {
+        total += c.array.capacity() * sizeof(uint16_t) + c.words.capacity() * sizeof(uint64_t);
+    }
+    return total;
+}
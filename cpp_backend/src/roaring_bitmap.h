@@ -0,0 +1,70 @@
+#ifndef ROARING_BITMAP_H
+#define ROARING_BITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compressed set of 32-bit ids in the style of Roaring bitmaps (Chambi, Lemire
+// et al.): ids are grouped by their high 16 bits into containers, each a sorted
+// array of the low halves while sparse and a 65536-bit bitmap once it holds
+// more than 4096 ids (where the array would outgrow the 8 KB bitmap).
+// Not thread-safe; callers synchronize.
+class RoaringBitmap {
+public:
+  // True if the set changed
+  bool add(uint32_t id);
+  bool remove(uint32_t id);
+  bool contains(uint32_t id) const;
+
+  bool empty() const { return containers.empty(); }
+  uint64_t cardinality() const;
+  size_t bytes() const; // heap bytes held by containers
+
+  // Container keys (high 16 bits), ascending
+  size_t containerCount() const { return containers.size(); }
+  uint16_t keyAt(size_t i) const { return containers[i].key; }
+
+  // Call fn(low) for every id whose high 16 bits are key, ascending
+  template <typename F>
+  void forEachInContainer(uint16_t key, F&& fn) const {
+    const Container* c = find(key);
+    if (!c) {
+      return;
+    }
+    if (!c->isBitmap()) {
+      for (uint16_t low : c->array) {
+        fn(low);
+      }
+      return;
+    }
+    for (size_t w = 0; w < c->words.size(); ++w) {
+      uint64_t word = c->words[w];
+      while (word) {
+        fn(static_cast<uint16_t>(w * 64 + __builtin_ctzll(word)));
+        word &= word - 1;
+      }
+    }
+  }
+
+private:
+  static constexpr uint32_t ARRAY_MAX = 4096;
+  static constexpr size_t BITMAP_WORDS = 65536 / 64;
+
+  struct Container {
+    uint16_t key;
+    uint32_t cardinality = 0;
+    std::vector<uint16_t> array; // sorted, while cardinality <= ARRAY_MAX
+    std::vector<uint64_t> words; // BITMAP_WORDS words once dense
+    bool isBitmap() const { return !words.empty(); }
+  };
+
+  const Container* find(uint16_t key) const;
+  Container* find(uint16_t key);
+  static void toBitmap(Container& c);
+  static void toArray(Container& c);
+
+  std::vector<Container> containers; // sorted by key
+};
+
+#endif // ROARING_BITMAP_H
@@ -0,0 +1,152 @@
+#include "tally_cache.h"
+#include <algorithm>
+#include <functional>
+
+TallyCache::TallyCache(size_t capacity_bytes, size_t shard_count)
+    : shard_capacity(capacity_bytes / (shard_count == 0 ? 1 : shard_count)) {
+    if (shard_count == 0) {
+        shard_count = 1;
+    }
+    shards.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+size_t TallyCache::entryBytes(const Entry& entry) {
+    // Entry itself, list and hash nodes, the key stored twice and the tally array
+    return sizeof(Entry) + 64 + 2 * entry.video_id.capacity() +
+           entry.tallies.capacity() * sizeof(TopicTally);
+}
+
+TallyCache::Shard& TallyCache::shardFor(const std::string& videoId) {
+    return *shards[std::hash<std::string>{}(videoId) % shards.size()];
+}
+
+void TallyCache::evict(Shard& shard) {
+    while (shard.bytes > shard_capacity && !shard.lru.empty()) {
+        Entry& victim = shard.lru.back();
+        shard.bytes -= victim.bytes;
+        shard.index.erase(victim.video_id);
+        shard.lru.pop_back();
+        evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool TallyCache::get(const std::string& videoId, std::vector<TopicTally>& out) {
+    Shard& shard = shardFor(videoId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(videoId);
+    if (it == shard.index.end()) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    out = it->second->tallies;
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+uint64_t TallyCache::loadToken(const std::string& videoId) {
+    Shard& shard = shardFor(videoId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.version;
+}
+
+void TallyCache::put(const std::string& videoId, std::vector<TopicTally> tallies, uint64_t token) {
+    Shard& shard = shardFor(videoId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.version != token || shard.pending_writes > 0) {
+        stale_loads.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto it = shard.index.find(videoId);
+    if (it != shard.index.end()) {
+        // Another request loaded the same video concurrently; its copy is equally fresh.
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return;
+    }
+
+    shard.lru.push_front(Entry{videoId, std::move(tallies), 0});
+    Entry& entry = shard.lru.front();
+    entry.bytes = entryBytes(entry);
+    shard.bytes += entry.bytes;
+    shard.index.emplace(videoId, shard.lru.begin());
+    evict(shard);
+}
+
+void TallyCache::beginWrite(const std::string& videoId) {
+    Shard& shard = shardFor(videoId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ++shard.pending_writes;
+    ++shard.version;
+}
+
+void TallyCache::endWrite(const std::string& videoId) {
+    Shard& shard = shardFor(videoId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    --shard.pending_writes;
+    ++shard.version;
+}
+
+void TallyCache::applyVote(const std::string& videoId, int topicId, int voteDelta, int voterDelta) {
+    Shard& shard = shardFor(videoId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ++shard.version;
+
+    auto it = shard.index.find(videoId);
+    if (it == shard.index.end()) {
+        return;
+    }
+
+    Entry& entry = *it->second;
+    auto tally = std::find_if(entry.tallies.begin(), entry.tallies.end(),
+                              [topicId](const TopicTally& t) { return t.topic_id == topicId; });
+    if (tally == entry.tallies.end()) {
+        if (voterDelta > 0) {
+            entry.tallies.push_back(TopicTally{topicId, voteDelta, voterDelta});
+        }
+    } else {
+        tally->total_votes += voteDelta;
+        tally->voter_count += voterDelta;
+        if (tally->voter_count <= 0) {
+            entry.tallies.erase(tally);
+        }
+    }
+
+    shard.bytes -= entry.bytes;
+    entry.bytes = entryBytes(entry);
+    shard.bytes += entry.bytes;
+    vote_updates.fetch_add(1, std::memory_order_relaxed);
+    evict(shard);
+}
+
+void TallyCache::invalidate(const std::string& videoId) {
+    Shard& shard = shardFor(videoId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ++shard.version;
+
+    auto it = shard.index.find(videoId);
+    if (it != shard.index.end()) {
+        shard.bytes -= it->second->bytes;
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+}
+
+TallyCacheStats TallyCache::stats() const {
+    TallyCacheStats s{};
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        s.entries += shard->index.size();
+        s.bytes += shard->bytes;
+    }
+    s.capacity_bytes = shard_capacity * shards.size();
+    s.hits = hits.load(std::memory_order_relaxed);
+    s.misses = misses.load(std::memory_order_relaxed);
+    s.evictions = evictions.load(std::memory_order_relaxed);
+    s.vote_updates = vote_updates.load(std::memory_order_relaxed);
+    s.stale_loads = stale_loads.load(std::memory_order_relaxed);
+    return s;
+}
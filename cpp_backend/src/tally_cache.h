@@ -0,0 +1,87 @@
+#ifndef TALLY_CACHE_H
+#define TALLY_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct TopicTally {
+  int topic_id;
+  int total_votes;
+  int voter_count;
+};
+
+struct TallyCacheStats {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  uint64_t vote_updates; // votes applied in place to a cached entry
+  uint64_t stale_loads;  // loads dropped because a vote raced with them
+  size_t entries;
+  size_t bytes;
+  size_t capacity_bytes;
+};
+
+// Sharded LRU cache of per-video topic tallies with a memory budget. Committed
+// votes are applied to cached entries in place (write-through) instead of
+// invalidating them, so hot videos are served without touching Postgres.
+class TallyCache {
+public:
+  TallyCache(size_t capacity_bytes, size_t shard_count);
+
+  bool get(const std::string& videoId, std::vector<TopicTally>& out);
+
+  // Take a token before reading tallies from the database and pass it to put():
+  // if a vote was in flight or touched the shard in between, the (possibly stale)
+  // load is not cached.
+  uint64_t loadToken(const std::string& videoId);
+  void put(const std::string& videoId, std::vector<TopicTally> tallies, uint64_t token);
+
+  // Bracket every vote write: beginWrite() before the statement runs, endWrite()
+  // after the result was applied (or the write failed).
+  void beginWrite(const std::string& videoId);
+  void endWrite(const std::string& videoId);
+
+  // Apply a committed vote. voteDelta changes total_votes, voterDelta is +1 for a
+  // new vote row, -1 for a removed one and 0 for a changed one.
+  void applyVote(const std::string& videoId, int topicId, int voteDelta, int voterDelta);
+  void invalidate(const std::string& videoId);
+
+  TallyCacheStats stats() const;
+
+private:
+  struct Entry {
+    std::string video_id;
+    std::vector<TopicTally> tallies;
+    size_t bytes;
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::list<Entry> lru; // front is most recently used
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t bytes = 0;
+    uint64_t version = 0; // bumped by every vote or invalidation in this shard
+    size_t pending_writes = 0;
+  };
+
+  static size_t entryBytes(const Entry& entry);
+  Shard& shardFor(const std::string& videoId);
+  void evict(Shard& shard);
+
+  const size_t shard_capacity;
+  std::vector<std::unique_ptr<Shard>> shards;
+
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+  std::atomic<uint64_t> evictions{0};
+  std::atomic<uint64_t> vote_updates{0};
+  std::atomic<uint64_t> stale_loads{0};
+};
+
+#endif // TALLY_CACHE_H
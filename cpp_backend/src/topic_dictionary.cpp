@@ -0,0 +1,81 @@
+#include "topic_dictionary.h"
+#include <functional>
+
+TopicDictionary::TopicDictionary()
+    : by_name(new std::atomic<Entry*>[kBuckets]), by_id(new std::atomic<Entry*>[kBuckets]) {
+    for (size_t i = 0; i < kBuckets; ++i) {
+        by_name[i].store(nullptr, std::memory_order_relaxed);
+        by_id[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+TopicDictionary::~TopicDictionary() {
+    // Every published entry is on exactly one id chain.
+    for (size_t i = 0; i < kBuckets; ++i) {
+        Entry* e = by_id[i].load(std::memory_order_relaxed);
+        while (e) {
+            Entry* next = e->next_by_id;
+            delete e;
+            e = next;
+        }
+    }
+}
+
+const TopicDictionary::Entry* TopicDictionary::findByName(const std::string& name, size_t hash) const {
+    for (const Entry* e = by_name[hash % kBuckets].load(std::memory_order_acquire); e; e = e->next_by_name) {
+        if (e->name_hash == hash && e->name == name) {
+            return e;
+        }
+    }
+    return nullptr;
+}
+
+const TopicDictionary::Entry* TopicDictionary::findById(int id) const {
+    for (const Entry* e = by_id[static_cast<size_t>(id) % kBuckets].load(std::memory_order_acquire); e; e = e->next_by_id) {
+        if (e->id == id) {
+            return e;
+        }
+    }
+    return nullptr;
+}
+
+int TopicDictionary::idForName(const std::string& name) const {
+    const Entry* e = findByName(name, std::hash<std::string>{}(name));
+    return e ? e->id : 0;
+}
+
+const std::string* TopicDictionary::nameForId(int id) const {
+    const Entry* e = findById(id);
+    return e ? &e->name : nullptr;
+}
+
+void TopicDictionary::insert(int id, const std::string& name) {
+    size_t hash = std::hash<std::string>{}(name);
+    Entry* entry = new Entry{id, name, hash, nullptr, nullptr};
+
+    // Publish on the name chain first; losing to a concurrent insert of the same
+    // name means the other thread owns publication.
+    std::atomic<Entry*>& name_head = by_name[hash % kBuckets];
+    Entry* head = name_head.load(std::memory_order_acquire);
+    do {
+        for (const Entry* e = head; e; e = e->next_by_name) {
+            if (e->name_hash == hash && e->name == name) {
+                delete entry;
+                return;
+            }
+        }
+        entry->next_by_name = head;
+    } while (!name_head.compare_exchange_weak(head, entry, std::memory_order_release, std::memory_order_acquire));
+
+    std::atomic<Entry*>& id_head = by_id[static_cast<size_t>(id) % kBuckets];
+    head = id_head.load(std::memory_order_acquire);
+    do {
+        entry->next_by_id = head;
+    } while (!id_head.compare_exchange_weak(head, entry, std::memory_order_release, std::memory_order_acquire));
+
+    count.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t TopicDictionary::size() const {
+    return count.load(std::memory_order_relaxed);
+}
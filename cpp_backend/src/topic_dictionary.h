@@ -0,0 +1,50 @@
+#ifndef TOPIC_DICTIONARY_H
+#define TOPIC_DICTIONARY_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// In-process topic name <-> id dictionary. Topics are never renamed or deleted,
+// so entries are immutable once published: readers walk bucket chains without
+// locks and writers publish new entries with a CAS on the bucket head.
+class TopicDictionary {
+public:
+  TopicDictionary();
+  ~TopicDictionary();
+
+  TopicDictionary(const TopicDictionary&) = delete;
+  TopicDictionary& operator=(const TopicDictionary&) = delete;
+
+  // Returns 0 if the name is unknown.
+  int idForName(const std::string& name) const;
+
+  // Returns nullptr if the id is unknown. The pointer is valid for the dictionary's lifetime.
+  const std::string* nameForId(int id) const;
+
+  // Publish a mapping read from or just written to the topics table. Idempotent.
+  void insert(int id, const std::string& name);
+
+  size_t size() const;
+
+private:
+  struct Entry {
+    int id;
+    std::string name;
+    size_t name_hash;
+    Entry* next_by_name;
+    Entry* next_by_id;
+  };
+
+  static constexpr size_t kBuckets = 1 << 16;
+
+  const Entry* findByName(const std::string& name, size_t hash) const;
+  const Entry* findById(int id) const;
+
+  std::unique_ptr<std::atomic<Entry*>[]> by_name;
+  std::unique_ptr<std::atomic<Entry*>[]> by_id;
+  std::atomic<size_t> count{0};
+};
+
+#endif // TOPIC_DICTIONARY_H
@@ -0,0 +1,212 @@
+#include "topic_index.h"
+#include "config.h"
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+
+namespace {
+
+// More shared topics first, then lower id
+bool better(const std::pair<int, uint32_t>& a, const std::pair<int, uint32_t>& b) {
+    return a.first != b.first ? a.first > b.first : a.second < b.second;
+}
+
+} // namespace
+
+// One similar() call. Container keys are claimed one at a time by the calling
+// thread and any helpers, which merge their top-k into best when out of keys.
+struct TopicIndex::Query {
+    std::vector<const RoaringBitmap*> bitmaps;
+    std::vector<uint16_t> keys;
+    uint32_t self = 0;
+    size_t limit = 0;
+    std::atomic<size_t> next_key{0};
+
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t keys_done = 0;         // guarded by mutex
+    std::vector<Candidate> best;  // guarded by mutex
+};
+
+TopicIndex::TopicIndex(Executor& executor) : executor(executor) {}
+
+void TopicIndex::applyVoters(const std::string& videoId, int topicId, int voterDelta) {
+    if (voterDelta == 0) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto [it, inserted] = ids.try_emplace(videoId, static_cast<uint32_t>(videos.size()));
+    if (inserted) {
+        videos.push_back({videoId, {}});
+    }
+    const uint32_t id = it->second;
+    auto& voters = videos[id].voters;
+    auto pos = std::find_if(voters.begin(), voters.end(), [&](const auto& v) { return v.first == topicId; });
+
+    // Counts may dip below zero when a removal is applied before the insert it
+    // undoes; they still sum correctly, and only a positive count tags the video
+    const int before = pos == voters.end() ? 0 : pos->second;
+    const int after = before + voterDelta;
+    if (after == 0) {
+        if (pos != voters.end()) {
+            voters.erase(pos);
+        }
+    } else if (pos == voters.end()) {
+        voters.emplace_back(topicId, after);
+    } else {
+        pos->second = after;
+    }
+
+    if (before <= 0 && after > 0) {
+        topics[topicId].add(id);
+    } else if (before > 0 && after <= 0) {
+        auto topic = topics.find(topicId);
+        if (topic != topics.end() && topic->second.remove(id) && topic->second.empty()) {
+            topics.erase(topic);
+        }
+    }
+}
+
+void TopicIndex::scan(Query& query) {
+    thread_local std::vector<uint32_t> counts(65536, 0);
+    thread_local std::vector<uint16_t> touched;
+    // Top of the heap is the worst candidate kept so far
+    std::priority_queue<Candidate, std::vector<Candidate>, decltype(&better)> heap(&better);
+
+    size_t claimed = 0;
+    for (size_t i; (i = query.next_key.fetch_add(1)) < query.keys.size();) {
+        ++claimed;
+        const uint16_t key = query.keys[i];
+        touched.clear();
+        for (const RoaringBitmap* bitmap : query.bitmaps) {
+            bitmap->forEachInContainer(key, [&](uint16_t low) {
+                if (counts[low]++ == 0) {
+                    touched.push_back(low);
+                }
+            });
+        }
+        const uint32_t base = static_cast<uint32_t>(key) << 16;
+        for (uint16_t low : touched) {
+            Candidate c{static_cast<int>(counts[low]), base | low};
+            counts[low] = 0;
+            if (c.second == query.self) {
+                continue;
+            }
+            if (heap.size() < query.limit) {
+                heap.push(c);
+            } else if (better(c, heap.top())) {
+                heap.pop();
+                heap.push(c);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(query.mutex);
+    while (!heap.empty()) {
+        query.best.push_back(heap.top());
+        heap.pop();
+    }
+    query.keys_done += claimed;
+    query.done.notify_all();
+}
+
+std::vector<TopicOverlap> TopicIndex::similar(const std::string& videoId, size_t limit) const {
+    queries.fetch_add(1, std::memory_order_relaxed);
+    std::vector<TopicOverlap> out;
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(videoId);
+    if (it == ids.end() || limit == 0) {
+        return out;
+    }
+
+    auto query = std::make_shared<Query>();
+    query->self = it->second;
+    query->limit = limit;
+    uint64_t total_ids = 0;
+    for (const auto& voters : videos[it->second].voters) {
+        auto topic = topics.find(voters.first);
+        if (voters.second <= 0 || topic == topics.end()) {
+            continue;
+        }
+        const RoaringBitmap& bitmap = topic->second;
+        query->bitmaps.push_back(&bitmap);
+        total_ids += bitmap.cardinality();
+        for (size_t i = 0; i < bitmap.containerCount(); ++i) {
+            query->keys.push_back(bitmap.keyAt(i));
+        }
+    }
+    std::sort(query->keys.begin(), query->keys.end());
+    query->keys.erase(std::unique(query->keys.begin(), query->keys.end()), query->keys.end());
+
+    // Helpers only read the index while this thread holds the shared lock: one that
+    // starts after all keys were claimed exits without touching it. This thread
+    // scans too, so nothing waits on a helper that never got a worker.
+    if (total_ids >= TOPIC_INDEX_PARALLEL_MIN_IDS && query->keys.size() > 1) {
+        size_t helpers = std::min<size_t>(query->keys.size(), EXECUTOR_THREADS) - 1;
+        size_t posted = 0;
+        try {
+            for (; posted < helpers; ++posted) {
+                executor.post([query]() { scan(*query); });
+            }
+        } catch (const ServiceUnavailable&) {
+            // Queue full; fewer helpers
+        }
+        if (posted > 0) {
+            parallel_queries.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    scan(*query);
+
+    std::unique_lock<std::mutex> wait(query->mutex);
+    query->done.wait(wait, [&]() { return query->keys_done == query->keys.size(); });
+    std::sort(query->best.begin(), query->best.end(), better);
+    for (size_t i = 0; i < query->best.size() && i < limit; ++i) {
+        out.push_back({videos[query->best[i].second].video_id, query->best[i].first});
+    }
+    return out;
+}
+
+size_t TopicIndex::sharedTopics(const std::string& videoId, const std::vector<std::string>& others,
+                                std::vector<int>& out) const {
+    out.assign(others.size(), 0);
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(videoId);
+    if (it == ids.end()) {
+        return 0;
+    }
+    std::vector<const RoaringBitmap*> bitmaps;
+    for (const auto& voters : videos[it->second].voters) {
+        auto topic = topics.find(voters.first);
+        if (voters.second > 0 && topic != topics.end()) {
+            bitmaps.push_back(&topic->second);
+        }
+    }
+    for (size_t i = 0; i < others.size(); ++i) {
+        auto other = ids.find(others[i]);
+        if (other == ids.end()) {
+            continue;
+        }
+        for (const RoaringBitmap* bitmap : bitmaps) {
+            out[i] += bitmap->contains(other->second) ? 1 : 0;
+        }
+    }
+    return bitmaps.size();
+}
+
+TopicIndexStats TopicIndex::stats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    TopicIndexStats s;
+    s.videos = videos.size();
+    s.topics = topics.size();
+    s.memberships = 0;
+    s.bitmap_bytes = 0;
+    for (const auto& topic : topics) {
+        s.memberships += topic.second.cardinality();
+        s.bitmap_bytes += topic.second.bytes();
+    }
+    s.queries = queries.load(std::memory_order_relaxed);
+    s.parallel_queries = parallel_queries.load(std::memory_order_relaxed);
+    return s;
+}
@@ -0,0 +1,78 @@
+#ifndef TOPIC_INDEX_H
+#define TOPIC_INDEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "executor.h"
+#include "roaring_bitmap.h"
+
+struct TopicOverlap {
+  std::string video_id;
+  int shared_topics;
+};
+
+struct TopicIndexStats {
+  size_t videos;
+  size_t topics;
+  uint64_t memberships; // (video, topic) pairs with at least one voter
+  size_t bitmap_bytes;
+  uint64_t queries;
+  uint64_t parallel_queries;
+};
+
+// Inverted index topic -> bitmap of the videos tagged with it, where a video is
+// tagged while at least one user has a vote on (video, topic). Videos get dense
+// 32-bit ids for the bitmaps. Kept current from committed votes, so topic-overlap
+// similarity never touches Postgres.
+class TopicIndex {
+public:
+  // Large queries are split across executor threads
+  explicit TopicIndex(Executor& executor);
+
+  // Add voterDelta voters to (videoId, topicId): +1 for a new vote row, -1 for a
+  // removed one (as in TallyCache::applyVote). Deltas commute, so concurrent votes
+  // may be applied in any order.
+  void applyVoters(const std::string& videoId, int topicId, int voterDelta);
+
+  // Up to limit videos sharing the most topics with videoId, most shared first
+  // (ties by index order). Empty if videoId has no topics.
+  std::vector<TopicOverlap> similar(const std::string& videoId, size_t limit) const;
+
+  // Number of topics videoId shares with each of others; returns how many topics
+  // videoId has (0 if unknown)
+  size_t sharedTopics(const std::string& videoId, const std::vector<std::string>& others,
+                      std::vector<int>& out) const;
+
+  TopicIndexStats stats() const;
+
+private:
+  // (shared topics, dense id)
+  using Candidate = std::pair<int, uint32_t>;
+  struct Query;
+
+  struct VideoTopics {
+    std::string video_id;
+    std::vector<std::pair<int, int>> voters; // (topic id, voter count > 0)
+  };
+
+  // Count shared topics for every id in the query's containers claimed from
+  // query.next_key, keeping the best query.limit
+  static void scan(Query& query);
+
+  Executor& executor;
+
+  mutable std::shared_mutex mutex;
+  std::unordered_map<std::string, uint32_t> ids;
+  std::vector<VideoTopics> videos; // by dense id
+  std::unordered_map<int, RoaringBitmap> topics;
+
+  mutable std::atomic<uint64_t> queries{0};
+  mutable std::atomic<uint64_t> parallel_queries{0};
+};
+
+#endif // TOPIC_INDEX_H
@@ -0,0 +1,129 @@
+#include "vector_codec.h"
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+// Longest shortest-round-trip float is 15 chars ("-1.17549435e-38")
+constexpr size_t kMaxFloatChars = 16;
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline uint32_t byteSwap32(uint32_t v) {
+    return __builtin_bswap32(v);
+}
+
+inline bool hostIsLittleEndian() {
+    const uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+} // namespace
+
+void encodePgvector(const float* data, size_t n, std::string& out) {
+    out.resize(2 + n * kMaxFloatChars);
+    char* p = &out[0];
+    char* end = p + out.size();
+    *p++ = '[';
+    for (size_t i = 0; i < n; ++i) {
+        if (i > 0) {
+            *p++ = ',';
+        }
+        p = std::to_chars(p, end, data[i]).ptr;
+    }
+    *p++ = ']';
+    out.resize(p - out.data());
+}
+
+std::string encodePgvector(const std::vector<float>& vec) {
+    std::string out;
+    encodePgvector(vec.data(), vec.size(), out);
+    return out;
+}
+
+bool decodePgvector(const char* text, size_t len, std::vector<float>& out) {
+    out.clear();
+    const char* p = text;
+    const char* end = text + len;
+    while (p < end && isSpace(*p)) ++p;
+    if (p == end || *p != '[') {
+        return false;
+    }
+    ++p;
+    while (p < end && isSpace(*p)) ++p;
+    if (p < end && *p == ']') {
+        ++p;
+    } else {
+        while (true) {
+            while (p < end && isSpace(*p)) ++p;
+            if (p < end && *p == '+') ++p; // from_chars rejects a leading '+'
+            float value;
+            auto res = std::from_chars(p, end, value);
+            if (res.ec != std::errc()) {
+                return false;
+            }
+            out.push_back(value);
+            p = res.ptr;
+            while (p < end && isSpace(*p)) ++p;
+            if (p == end) {
+                return false;
+            }
+            if (*p == ']') {
+                ++p;
+                break;
+            }
+            if (*p != ',') {
+                return false;
+            }
+            ++p;
+        }
+    }
+    while (p < end && isSpace(*p)) ++p;
+    return p == end;
+}
+
+void encodePgvectorBinary(const float* data, size_t n, std::string& out) {
+    out.resize(4 + n * 4);
+    unsigned char* p = reinterpret_cast<unsigned char*>(&out[0]);
+    p[0] = static_cast<unsigned char>(n >> 8);
+    p[1] = static_cast<unsigned char>(n);
+    p[2] = 0;
+    p[3] = 0;
+    p += 4;
+    const bool swap = hostIsLittleEndian();
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t bits;
+        std::memcpy(&bits, &data[i], 4);
+        if (swap) {
+            bits = byteSwap32(bits);
+        }
+        std::memcpy(p + i * 4, &bits, 4);
+    }
+}
+
+bool decodePgvectorBinary(const unsigned char* data, size_t len, std::vector<float>& out) {
+    out.clear();
+    if (len < 4) {
+        return false;
+    }
+    size_t n = (static_cast<size_t>(data[0]) << 8) | data[1];
+    if (len != 4 + n * 4) {
+        return false;
+    }
+    out.resize(n);
+    const bool swap = hostIsLittleEndian();
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t bits;
+        std::memcpy(&bits, data + 4 + i * 4, 4);
+        if (swap) {
+            bits = byteSwap32(bits);
+        }
+        std::memcpy(&out[i], &bits, 4);
+    }
+    return true;
+}
@@ -0,0 +1,25 @@
+#ifndef VECTOR_CODEC_H
+#define VECTOR_CODEC_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// pgvector text format: "[0.1,-2.5e-05,...]". Encoding uses shortest round-trip
+// std::to_chars output and writes into out (cleared first) so callers can reuse
+// one buffer across calls.
+void encodePgvector(const float* data, size_t n, std::string& out);
+std::string encodePgvector(const std::vector<float>& vec);
+
+// Parse pgvector text output. Returns false on malformed input; out is cleared first.
+bool decodePgvector(const char* text, size_t len, std::vector<float>& out);
+inline bool decodePgvector(const std::string& text, std::vector<float>& out) {
+  return decodePgvector(text.data(), text.size(), out);
+}
+
+// pgvector binary wire format (vector_send/vector_recv): int16 dim, int16 unused
+// (zero), then dim float4 values, all big-endian.
+void encodePgvectorBinary(const float* data, size_t n, std::string& out);
+bool decodePgvectorBinary(const unsigned char* data, size_t len, std::vector<float>& out);
+
+#endif // VECTOR_CODEC_H
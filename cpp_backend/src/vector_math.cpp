@@ -0,0 +1,226 @@
+#include "vector_math.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VECTOR_MATH_X86 1
+#endif
+
+namespace {
+
+float dotScalar(const float* a, const float* b, size_t n) {
+    // Four independent accumulators so the compiler can keep several FMAs in flight
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; ++i) {
+        s0 += a[i] * b[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+int32_t dotInt8Scalar(const int8_t* a, const int8_t* b, size_t n) {
+    int32_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += static_cast<int32_t>(a[i]) * b[i];
+    }
+    return sum;
+}
+
+#ifdef VECTOR_MATH_X86
+
+__attribute__((target("avx2")))
+int32_t dotInt8Avx2(const int8_t* a, const int8_t* b, size_t n) {
+    // Widen to int16 and multiply-add pairs into int32 lanes; |code| <= 127 so
+    // each pair sum fits easily
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    int32_t result = _mm_cvtsi128_si32(sum);
+    for (; i < n; ++i) {
+        result += static_cast<int32_t>(a[i]) * b[i];
+    }
+    return result;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+int32_t dotInt8Avx512(const int8_t* a, const int8_t* b, size_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512i va = _mm512_cvtepi8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)));
+        __m512i vb = _mm512_cvtepi8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(va, vb));
+    }
+    alignas(64) int32_t lanes[16];
+    _mm512_store_si512(lanes, acc);
+    int32_t result = 0;
+    for (int32_t lane : lanes) {
+        result += lane;
+    }
+    for (; i < n; ++i) {
+        result += static_cast<int32_t>(a[i]) * b[i];
+    }
+    return result;
+}
+
+__attribute__((target("avx2,fma")))
+float dotAvx2(const float* a, const float* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    float result = _mm_cvtss_f32(sum);
+    for (; i < n; ++i) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+__attribute__((target("avx512f")))
+float dotAvx512(const float* a, const float* b, size_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    if (i + 16 <= n) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        i += 16;
+    }
+    if (i < n) {
+        // Masked loads handle the tail without a scalar loop
+        __mmask16 mask = static_cast<__mmask16>((1u << (n - i)) - 1);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc1);
+    }
+    // Spill and add the lanes: GCC's 512-bit extract/reduce intrinsics trip -Wuninitialized
+    alignas(64) float lanes[16];
+    _mm512_store_ps(lanes, _mm512_add_ps(acc0, acc1));
+    float result = 0;
+    for (float lane : lanes) {
+        result += lane;
+    }
+    return result;
+}
+
+#endif // VECTOR_MATH_X86
+
+} // namespace
+
+SimdLevel detectSimdLevel() {
+    static const SimdLevel level = []() {
+#ifdef VECTOR_MATH_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+            return SimdLevel::Avx512;
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return SimdLevel::Avx2;
+        }
+#endif
+        return SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Avx512: return "avx512";
+        case SimdLevel::Avx2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+DotProductFn dotProductFor(SimdLevel level) {
+#ifdef VECTOR_MATH_X86
+    if (level == SimdLevel::Avx512) {
+        return dotAvx512;
+    }
+    if (level == SimdLevel::Avx2) {
+        return dotAvx2;
+    }
+#endif
+    return dotScalar;
+}
+
+DotProductInt8Fn dotProductInt8For(SimdLevel level) {
+#ifdef VECTOR_MATH_X86
+    if (level == SimdLevel::Avx512) {
+        return dotInt8Avx512;
+    }
+    if (level == SimdLevel::Avx2) {
+        return dotInt8Avx2;
+    }
+#endif
+    return dotInt8Scalar;
+}
+
+int32_t dotProductInt8(const int8_t* a, const int8_t* b, size_t n) {
+    static const DotProductInt8Fn kernel = dotProductInt8For(detectSimdLevel());
+    return kernel(a, b, n);
+}
+
+float dotProduct(const float* a, const float* b, size_t n) {
+    static const DotProductFn kernel = dotProductFor(detectSimdLevel());
+    return kernel(a, b, n);
+}
+
+void normalizeVector(float* v, size_t n) {
+    double norm = 0;
+    for (size_t i = 0; i < n; ++i) {
+        norm += static_cast<double>(v[i]) * v[i];
+    }
+    if (norm <= 0) {
+        return;
+    }
+    float scale = static_cast<float>(1.0 / std::sqrt(norm));
+    for (size_t i = 0; i < n; ++i) {
+        v[i] *= scale;
+    }
+}
+
+float quantizeInt8(const float* v, size_t n, int8_t* codes) {
+    float max_abs = 0;
+    for (size_t i = 0; i < n; ++i) {
+        max_abs = std::max(max_abs, std::fabs(v[i]));
+    }
+    if (max_abs == 0) {
+        std::fill(codes, codes + n, 0);
+        return 0;
+    }
+    float scale = max_abs / 127.0f;
+    float inverse = 1.0f / scale;
+    for (size_t i = 0; i < n; ++i) {
+        codes[i] = static_cast<int8_t>(std::lround(v[i] * inverse));
+    }
+    return scale;
+}
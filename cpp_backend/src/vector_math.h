@@ -0,0 +1,38 @@
+#ifndef VECTOR_MATH_H
+#define VECTOR_MATH_H
+
+#include <cstddef>
+#include <cstdint>
+
+enum class SimdLevel {
+  Scalar,
+  Avx2,   // AVX2 + FMA
+  Avx512  // AVX-512F (+ BW for the int8 kernel)
+};
+
+using DotProductFn = float (*)(const float* a, const float* b, size_t n);
+using DotProductInt8Fn = int32_t (*)(const int8_t* a, const int8_t* b, size_t n);
+
+// Best level the running CPU supports (checked once, at first use).
+SimdLevel detectSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+// Kernel for a given level; falls back to scalar if it was not compiled in.
+DotProductFn dotProductFor(SimdLevel level);
+DotProductInt8Fn dotProductInt8For(SimdLevel level);
+
+// Dot product using the best kernel for this CPU. On unit-length vectors this
+// is the cosine similarity.
+float dotProduct(const float* a, const float* b, size_t n);
+
+// Exact integer dot product of int8 codes (see quantizeInt8).
+int32_t dotProductInt8(const int8_t* a, const int8_t* b, size_t n);
+
+// Scale v to unit length in place. Zero vectors are left unchanged.
+void normalizeVector(float* v, size_t n);
+
+// Symmetric per-vector int8 quantization: v[i] ~= codes[i] * scale, codes in
+// [-127, 127]. Returns the scale (0 for a zero vector).
+float quantizeInt8(const float* v, size_t n, int8_t* codes);
+
+#endif // VECTOR_MATH_H
@@ -0,0 +1,47 @@
+#include "video_catalog.h"
+#include <functional>
+#include <mutex>
+
+VideoCatalog::VideoCatalog(size_t shard_count) {
+    if (shard_count == 0) {
+        shard_count = 1;
+    }
+    shards.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+VideoCatalog::Shard& VideoCatalog::shardFor(const std::string& videoId) const {
+    return *shards[std::hash<std::string>{}(videoId) % shards.size()];
+}
+
+bool VideoCatalog::put(const std::string& videoId, VideoInfo info, bool replace) {
+    Shard& shard = shardFor(videoId);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (replace) {
+        shard.videos[videoId] = std::move(info);
+        return true;
+    }
+    return shard.videos.emplace(videoId, std::move(info)).second;
+}
+
+bool VideoCatalog::get(const std::string& videoId, VideoInfo& out) const {
+    Shard& shard = shardFor(videoId);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.videos.find(videoId);
+    if (it == shard.videos.end()) {
+        return false;
+    }
+    out = it->second;
+    return true;
+}
+
+size_t VideoCatalog::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        total += shard->videos.size();
+    }
+    return total;
+}
@@ -0,0 +1,40 @@
+#ifndef VIDEO_CATALOG_H
+#define VIDEO_CATALOG_H
+
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Display fields of a video as stored in the videos table (NULL = nullopt).
+struct VideoInfo {
+  std::optional<std::string> title;
+  std::optional<std::string> upload_date;
+  std::optional<std::string> last_updated;
+};
+
+// Sharded in-memory id -> VideoInfo map, so results from in-process indexes can
+// be rendered without going back to Postgres for titles.
+class VideoCatalog {
+public:
+  explicit VideoCatalog(size_t shard_count);
+
+  // With replace=false an existing entry is kept and false is returned.
+  bool put(const std::string& videoId, VideoInfo info, bool replace = true);
+  bool get(const std::string& videoId, VideoInfo& out) const;
+  size_t size() const;
+
+private:
+  struct Shard {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, VideoInfo> videos;
+  };
+
+  Shard& shardFor(const std::string& videoId) const;
+
+  std::vector<std::unique_ptr<Shard>> shards;
+};
+
+#endif // VIDEO_CATALOG_H
@@ -0,0 +1,39 @@
+#include "video_versions.h"
+#include <charconv>
+#include <chrono>
+#include <functional>
+#include <random>
+
+VideoVersions::VideoVersions(size_t slot_count)
+    : slots(new std::atomic<uint64_t>[slot_count]), slot_count(slot_count) {
+    for (size_t i = 0; i < slot_count; ++i) {
+        slots[i].store(0, std::memory_order_relaxed);
+    }
+    // Differs between runs, so ETags handed out before a restart never match after it
+    std::random_device rd;
+    epoch = (static_cast<uint64_t>(rd()) << 32) ^ rd() ^
+            static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+}
+
+std::atomic<uint64_t>& VideoVersions::slotFor(const std::string& videoId) const {
+    return slots[std::hash<std::string>{}(videoId) % slot_count];
+}
+
+uint64_t VideoVersions::current(const std::string& videoId) const {
+    return slotFor(videoId).load(std::memory_order_acquire);
+}
+
+void VideoVersions::bump(const std::string& videoId) {
+    slotFor(videoId).fetch_add(1, std::memory_order_acq_rel);
+}
+
+std::string VideoVersions::etag(const std::string& videoId) const {
+    char buf[48];
+    char* p = buf;
+    *p++ = '"';
+    p = std::to_chars(p, buf + sizeof(buf), epoch, 16).ptr;
+    *p++ = '-';
+    p = std::to_chars(p, buf + sizeof(buf), current(videoId)).ptr;
+    *p++ = '"';
+    return std::string(buf, p);
+}
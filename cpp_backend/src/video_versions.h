@@ -0,0 +1,34 @@
+#ifndef VIDEO_VERSIONS_H
+#define VIDEO_VERSIONS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Per-video change counters behind the ETags of GET /videos/:id and GET /videos/:id/topics,
+// so a matching If-None-Match is answered from memory. Videos hash onto a fixed array of
+// counters: memory stays bounded, each video's version only ever grows, and a collision
+// just makes a neighbour's cached copy revalidate once more.
+class VideoVersions {
+public:
+  explicit VideoVersions(size_t slot_count);
+
+  uint64_t current(const std::string& videoId) const;
+  // Call after the write is visible to readers (committed and applied to the caches), so a
+  // response never carries a version newer than its data
+  void bump(const std::string& videoId);
+
+  // Strong validator for videoId's current version. Includes a per-process epoch, since
+  // the counters restart at zero with the server.
+  std::string etag(const std::string& videoId) const;
+
+private:
+  std::atomic<uint64_t>& slotFor(const std::string& videoId) const;
+
+  std::unique_ptr<std::atomic<uint64_t>[]> slots;
+  size_t slot_count;
+  uint64_t epoch;
+};
+
+#endif // VIDEO_VERSIONS_H
@@ -0,0 +1,281 @@
+#include "vote_log.h"
+#include "logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace {
+
+constexpr size_t RECORD_HEADER_SIZE = 32;
+constexpr uint16_t FLAG_HAS_VOTE = 1;
+constexpr const char* SEGMENT_PREFIX = "votes-";
+constexpr const char* SEGMENT_SUFFIX = ".log";
+
+struct RecordHeader {
+    uint32_t length;
+    uint32_t crc;
+    uint64_t seq;
+    int32_t topic_id;
+    int32_t vote;
+    uint16_t video_len;
+    uint16_t user_len;
+    uint16_t flags;
+    uint16_t reserved;
+};
+static_assert(sizeof(RecordHeader) == RECORD_HEADER_SIZE, "record header layout");
+
+// Covers everything after the length and crc fields
+uint32_t recordCrc(const char* record, size_t length) {
+    return static_cast<uint32_t>(crc32(0L, reinterpret_cast<const Bytef*>(record + 8), static_cast<uInt>(length - 8)));
+}
+
+bool writeAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Make a created or deleted segment's directory entry durable
+void syncDirectory(const std::string& dir) {
+    int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd >= 0) {
+        ::fsync(dfd);
+        ::close(dfd);
+    }
+}
+
+} // namespace
+
+VoteLog::VoteLog(std::string dir, uint64_t segment_bytes)
+    : dir(std::move(dir)), segment_bytes(segment_bytes) {}
+
+VoteLog::~VoteLog() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+std::string VoteLog::segmentPath(uint64_t index) const {
+    char name[40];
+    std::snprintf(name, sizeof(name), "%s%016llx%s", SEGMENT_PREFIX,
+                  static_cast<unsigned long long>(index), SEGMENT_SUFFIX);
+    return (std::filesystem::path(dir) / name).string();
+}
+
+void VoteLog::openSegment(uint64_t index) {
+    std::string path = segmentPath(index);
+    int next = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (next < 0) {
+        failure = "Cannot create vote log segment " + path + ": " + std::strerror(errno);
+        return;
+    }
+    syncDirectory(dir);
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = next;
+    segments.push_back({index, std::move(path), 0, 0});
+}
+
+void VoteLog::readSegment(Segment& segment, std::vector<VoteRecord>& out) {
+    std::ifstream in(segment.path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    size_t offset = 0;
+    while (offset + RECORD_HEADER_SIZE <= data.size()) {
+        RecordHeader h;
+        std::memcpy(&h, data.data() + offset, sizeof(h));
+        if (h.length != RECORD_HEADER_SIZE + h.video_len + h.user_len || offset + h.length > data.size() ||
+            recordCrc(data.data() + offset, h.length) != h.crc) {
+            break;
+        }
+        const char* body = data.data() + offset + RECORD_HEADER_SIZE;
+        VoteRecord record;
+        record.seq = h.seq;
+        record.video_id.assign(body, h.video_len);
+        record.topic_id = h.topic_id;
+        record.user_id.assign(body + h.video_len, h.user_len);
+        if (h.flags & FLAG_HAS_VOTE) {
+            record.vote = h.vote;
+        }
+        segment.max_seq = std::max(segment.max_seq, record.seq);
+        out.push_back(std::move(record));
+        offset += h.length;
+    }
+    if (offset < data.size()) {
+        // A crash mid-write leaves a partial record; nothing after it was acknowledged
+        LOG_WARN("Dropping " << (data.size() - offset) << " bytes of incomplete records from "
+                 << segment.path);
+        if (::truncate(segment.path.c_str(), static_cast<off_t>(offset)) != 0) {
+            LOG_ERROR("Cannot truncate vote log segment: " << std::strerror(errno));
+        }
+    }
+    segment.bytes = offset;
+}
+
+std::vector<VoteRecord> VoteLog::open() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot create vote log directory " + dir + ": " + ec.message());
+    }
+
+    const std::string prefix = SEGMENT_PREFIX;
+    const std::string suffix = SEGMENT_SUFFIX;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() != prefix.size() + 16 + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        uint64_t index = std::stoull(name.substr(prefix.size(), 16), nullptr, 16);
+        segments.push_back({index, entry.path().string(), 0, 0});
+    }
+    if (ec) {
+        throw std::runtime_error("Cannot list vote log directory " + dir + ": " + ec.message());
+    }
+    std::sort(segments.begin(), segments.end(),
+              [](const Segment& a, const Segment& b) { return a.index < b.index; });
+
+    std::vector<VoteRecord> records;
+    for (Segment& segment : segments) {
+        readSegment(segment, records);
+        appended_seq = std::max(appended_seq, segment.max_seq);
+    }
+    durable_seq = appended_seq;
+
+    openSegment(segments.empty() ? 1 : segments.back().index + 1);
+    if (failure) {
+        throw std::runtime_error(*failure);
+    }
+    LOG_INFO("Opened vote log " << dir << ": " << records.size() << " records in "
+             << (segments.size() - 1) << " segments to replay.");
+    return records;
+}
+
+void VoteLog::append(const VoteRecord& record) {
+    RecordHeader h{};
+    h.video_len = static_cast<uint16_t>(std::min<size_t>(record.video_id.size(), UINT16_MAX));
+    h.user_len = static_cast<uint16_t>(std::min<size_t>(record.user_id.size(), UINT16_MAX));
+    h.length = static_cast<uint32_t>(RECORD_HEADER_SIZE + h.video_len + h.user_len);
+    h.seq = record.seq;
+    h.topic_id = record.topic_id;
+    h.vote = record.vote.value_or(0);
+    h.flags = record.vote ? FLAG_HAS_VOTE : 0;
+
+    thread_local std::string encoded;
+    encoded.assign(h.length, '\0');
+    std::memcpy(&encoded[RECORD_HEADER_SIZE], record.video_id.data(), h.video_len);
+    std::memcpy(&encoded[RECORD_HEADER_SIZE + h.video_len], record.user_id.data(), h.user_len);
+    std::memcpy(&encoded[0], &h, sizeof(h));
+    h.crc = recordCrc(encoded.data(), h.length);
+    std::memcpy(&encoded[0], &h, sizeof(h));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer += encoded;
+    appended_seq = record.seq;
+}
+
+void VoteLog::sync(uint64_t seq) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (durable_seq < seq) {
+        if (failure) {
+            throw std::runtime_error(*failure);
+        }
+        if (syncing) {
+            synced.wait(lock);
+            continue;
+        }
+
+        // Lead this group: write out everything buffered so far
+        syncing = true;
+        std::string batch;
+        batch.swap(buffer);
+        const uint64_t upto = appended_seq;
+        const int target = fd;
+        lock.unlock();
+        bool ok = writeAll(target, batch.data(), batch.size()) && ::fdatasync(target) == 0;
+        const int err = errno;
+        lock.lock();
+
+        syncing = false;
+        if (!ok) {
+            // What reached the file is unknown; stop acknowledging rather than guess
+            failure = std::string("Vote log write failed: ") + std::strerror(err);
+        } else {
+            ++syncs;
+            durable_seq = upto;
+            segments.back().max_seq = upto;
+            segments.back().bytes += batch.size();
+            if (segments.back().bytes >= segment_bytes) {
+                openSegment(segments.back().index + 1);
+            }
+        }
+        synced.notify_all();
+    }
+}
+
+void VoteLog::release(uint64_t seq) {
+    std::lock_guard<std::mutex> lock(mutex);
+    bool removed = false;
+    while (segments.size() > 1 && segments.front().max_seq <= seq) {
+        if (::unlink(segments.front().path.c_str()) != 0) {
+            LOG_ERROR("Cannot delete vote log segment " << segments.front().path << ": "
+                      << std::strerror(errno));
+        }
+        segments.erase(segments.begin());
+        removed = true;
+    }
+    if (removed) {
+        syncDirectory(dir);
+    }
+
+    // Fully written back and nothing in flight: start the current segment over,
+    // so an idle log holds nothing to replay
+    Segment& current = segments.back();
+    if (!syncing && !failure && buffer.empty() && appended_seq <= seq && current.bytes > 0) {
+        if (::ftruncate(fd, 0) != 0 || ::fdatasync(fd) != 0) {
+            LOG_ERROR("Cannot truncate vote log segment " << current.path << ": " << std::strerror(errno));
+            return;
+        }
+        current.bytes = 0;
+    }
+}
+
+bool VoteLog::failed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failure.has_value();
+}
+
+VoteLogStats VoteLog::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    VoteLogStats s;
+    s.segments = segments.size();
+    s.bytes = 0;
+    for (const Segment& segment : segments) {
+        s.bytes += segment.bytes;
+    }
+    s.appended_seq = appended_seq;
+    s.durable_seq = durable_seq;
+    s.syncs = syncs;
+    s.failed = failure.has_value();
+    return s;
+}
@@ -0,0 +1,95 @@
+#ifndef VOTE_LOG_H
+#define VOTE_LOG_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// State of one (video, topic, user) vote after a write. Records hold the
+// resulting row rather than the request, so replaying them is idempotent.
+struct VoteRecord {
+  uint64_t seq;
+  std::string video_id;
+  int topic_id;
+  std::string user_id;
+  std::optional<int> vote; // nullopt: the row is deleted
+};
+
+struct VoteLogStats {
+  size_t segments;
+  uint64_t bytes;
+  uint64_t appended_seq;
+  uint64_t durable_seq;
+  uint64_t syncs;    // fdatasync calls; appended_seq / syncs is the group size
+  bool failed;
+};
+
+// Write-ahead log for write-behind votes: a directory of append-only segment
+// files of CRC-framed records. Appends only buffer; sync() makes them durable,
+// with one caller writing and fdatasync'ing everything buffered so far while
+// concurrent callers wait for it (group commit). Segments are deleted once
+// Postgres holds every record in them.
+//
+// Record layout (host byte order): u32 length, u32 crc32, u64 seq, i32 topic_id,
+// i32 vote, u16 video_len, u16 user_len, u16 flags, u16 reserved, video, user.
+class VoteLog {
+public:
+  VoteLog(std::string dir, uint64_t segment_bytes);
+  ~VoteLog();
+
+  VoteLog(const VoteLog&) = delete;
+  VoteLog& operator=(const VoteLog&) = delete;
+
+  // Create the directory if needed and read back every record of the existing
+  // segments in order, dropping a torn tail. New records go to a fresh segment.
+  // Throws std::runtime_error if the directory cannot be used.
+  std::vector<VoteRecord> open();
+
+  // Buffer a record; records must be appended in seq order
+  void append(const VoteRecord& record);
+
+  // Block until every record up to seq is on disk. Throws std::runtime_error if
+  // the log failed a write, after which it accepts no more syncs.
+  void sync(uint64_t seq);
+
+  // Postgres holds every record up to seq: delete segments with nothing newer,
+  // and empty the current one if it is fully written back too
+  void release(uint64_t seq);
+
+  // A write failed; sync() throws from now on
+  bool failed() const;
+
+  VoteLogStats stats() const;
+
+private:
+  struct Segment {
+    uint64_t index;
+    std::string path;
+    uint64_t max_seq; // newest record written to it
+    uint64_t bytes;
+  };
+
+  std::string segmentPath(uint64_t index) const;
+  void openSegment(uint64_t index); // mutex held
+  // Append the segment's valid records to out, truncating it after the last one
+  void readSegment(Segment& segment, std::vector<VoteRecord>& out);
+
+  const std::string dir;
+  const uint64_t segment_bytes;
+
+  mutable std::mutex mutex;
+  std::condition_variable synced;
+  std::vector<Segment> segments; // oldest first; back() is being written
+  int fd = -1;                   // segments.back()
+  std::string buffer;            // appended, not yet written
+  uint64_t appended_seq = 0;
+  uint64_t durable_seq = 0;
+  bool syncing = false;
+  std::optional<std::string> failure;
+  uint64_t syncs = 0;
+};
+
+#endif // VOTE_LOG_H
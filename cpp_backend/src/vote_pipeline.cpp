@@ -0,0 +1,290 @@
+#include "vote_pipeline.h"
+#include "errors.h"
+#include "logger.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_set>
+
+VotePipeline::VotePipeline(std::string log_dir, uint64_t segment_bytes, size_t batch_size,
+                           std::chrono::milliseconds linger, size_t max_pending,
+                           TallyCache& tally_cache, WriteFn write)
+    : log(std::move(log_dir), segment_bytes),
+      batch_size(std::max<size_t>(batch_size, 1)),
+      linger(linger),
+      max_pending(max_pending),
+      tally_cache(tally_cache),
+      write(std::move(write)),
+      stripes(new Stripe[STRIPES]) {}
+
+VotePipeline::~VotePipeline() {
+    stop();
+}
+
+std::string VotePipeline::rowKey(const std::string& videoId, int topicId, const std::string& userId) {
+    std::string key;
+    key.reserve(videoId.size() + userId.size() + 16);
+    key += videoId;
+    key += '\0';
+    key += userId;
+    key += '\0';
+    key += std::to_string(topicId);
+    return key;
+}
+
+VotePipeline::Stripe& VotePipeline::stripeFor(const std::string& key) const {
+    return stripes[std::hash<std::string>{}(key) % STRIPES];
+}
+
+void VotePipeline::start() {
+    std::vector<VoteRecord> records = log.open();
+    if (!records.empty()) {
+        // Records hold resulting rows, so writing back ones Postgres already has is harmless
+        auto start = std::chrono::steady_clock::now();
+        uint64_t max_seq = 0;
+        for (size_t i = 0; i < records.size(); i += batch_size) {
+            auto first = records.begin() + i;
+            auto last = records.begin() + std::min(records.size(), i + batch_size);
+            write(std::vector<VoteRecord>(first, last));
+        }
+        for (const VoteRecord& record : records) {
+            max_seq = std::max(max_seq, record.seq);
+        }
+        log.release(max_seq);
+        replayed.fetch_add(records.size(), std::memory_order_relaxed);
+        LOG_INFO("Replayed " << records.size() << " votes from the vote log in "
+                 << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s.");
+    }
+    last_seq = log.stats().appended_seq;
+    writer = std::thread([this]() { run(); });
+}
+
+void VotePipeline::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work.notify_all();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    // A sync in flight can keep the last retire() from emptying the log
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending == 0) {
+        log.release(last_seq);
+    }
+}
+
+std::unique_lock<std::mutex> VotePipeline::lockKey(const std::string& videoId, int topicId, const std::string& userId) {
+    return std::unique_lock<std::mutex>(stripeFor(rowKey(videoId, topicId, userId)).mutex);
+}
+
+bool VotePipeline::pendingVote(const std::string& videoId, int topicId, const std::string& userId,
+                               std::optional<int>& vote) const {
+    const std::string key = rowKey(videoId, topicId, userId);
+    const Stripe& stripe = stripeFor(key);
+    auto it = stripe.rows.find(key);
+    if (it == stripe.rows.end()) {
+        return false;
+    }
+    vote = it->second.second;
+    return true;
+}
+
+uint64_t VotePipeline::submit(const std::string& videoId, int topicId, const std::string& userId,
+                              std::optional<int> vote, int voteDelta, int voterDelta) {
+    const std::string key = rowKey(videoId, topicId, userId);
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            throw ServiceUnavailable("Vote writer is shutting down");
+        }
+        if (pending >= max_pending) {
+            throw ServiceUnavailable("Too many votes waiting to be written");
+        }
+        if (log.failed()) {
+            throw ServiceUnavailable("Vote log unavailable");
+        }
+        seq = ++last_seq;
+        VoteRecord record{seq, videoId, topicId, userId, vote};
+        log.append(record);
+        queue.push_back({std::move(record), voteDelta, voterDelta});
+        ++pending;
+
+        addPendingDelta(videoId, topicId, voteDelta, voterDelta);
+
+        if (queue.size() == 1 || queue.size() >= batch_size) {
+            work.notify_one();
+        }
+    }
+    stripeFor(key).rows[key] = {seq, vote};
+    accepted.fetch_add(1, std::memory_order_relaxed);
+    return seq;
+}
+
+void VotePipeline::addPendingDelta(const std::string& videoId, int topicId, int voteDelta, int voterDelta) {
+    auto& deltas = pending_tallies[videoId];
+    auto tally = std::find_if(deltas.begin(), deltas.end(), [topicId](const TopicTally& t) { return t.topic_id == topicId; });
+    if (tally == deltas.end()) {
+        deltas.push_back(TopicTally{topicId, voteDelta, voterDelta});
+        tally = deltas.end() - 1;
+    } else {
+        tally->total_votes += voteDelta;
+        tally->voter_count += voterDelta;
+    }
+    // Pending votes that cancel out leave Postgres current for the topic
+    if (tally->total_votes == 0 && tally->voter_count == 0) {
+        deltas.erase(tally);
+        if (deltas.empty()) {
+            pending_tallies.erase(videoId);
+        }
+    }
+}
+
+void VotePipeline::waitDurable(uint64_t seq) {
+    try {
+        log.sync(seq);
+    } catch (const std::runtime_error& e) {
+        throw ServiceUnavailable(e.what());
+    }
+}
+
+void VotePipeline::addPending(const std::string& videoId, std::vector<TopicTally>& tallies) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = pending_tallies.find(videoId);
+    if (it == pending_tallies.end()) {
+        return;
+    }
+    for (const TopicTally& delta : it->second) {
+        auto tally = std::find_if(tallies.begin(), tallies.end(), [&](const TopicTally& t) { return t.topic_id == delta.topic_id; });
+        if (tally == tallies.end()) {
+            tallies.push_back(delta);
+        } else {
+            tally->total_votes += delta.total_votes;
+            tally->voter_count += delta.voter_count;
+        }
+    }
+    tallies.erase(std::remove_if(tallies.begin(), tallies.end(), [](const TopicTally& t) { return t.voter_count <= 0; }),
+                  tallies.end());
+}
+
+void VotePipeline::run() {
+    while (true) {
+        std::vector<Queued> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work.wait(lock, [&]() { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            if (!stopping && queue.size() < batch_size) {
+                work.wait_for(lock, linger, [&]() { return stopping || queue.size() >= batch_size; });
+            }
+            const size_t n = std::min(batch_size, queue.size());
+            batch.assign(std::make_move_iterator(queue.begin()), std::make_move_iterator(queue.begin() + n));
+            queue.erase(queue.begin(), queue.begin() + n);
+        }
+        if (!writeBatch(batch)) {
+            // Postgres is unreachable at shutdown; the log still holds the rest for the next start
+            return;
+        }
+    }
+}
+
+bool VotePipeline::writeBatch(const std::vector<Queued>& batch) {
+    std::vector<VoteRecord> records;
+    records.reserve(batch.size());
+    std::vector<std::string> videos;
+    std::unordered_set<std::string> seen;
+    for (const Queued& q : batch) {
+        records.push_back(q.record);
+        if (seen.insert(q.record.video_id).second) {
+            videos.push_back(q.record.video_id);
+        }
+    }
+
+    auto delay = std::chrono::milliseconds(50);
+    int retries_at_stop = 0;
+    while (true) {
+        // A tally load racing the commit can't tell whether it saw these votes;
+        // bracketing keeps such loads out of the cache
+        for (const std::string& video : videos) {
+            tally_cache.beginWrite(video);
+        }
+        auto start = std::chrono::steady_clock::now();
+        bool ok = false;
+        try {
+            write(records);
+            retire(batch);
+            ok = true;
+        } catch (const std::exception& e) {
+            write_errors.fetch_add(1, std::memory_order_relaxed);
+            LOG_WARN("Error writing back " << records.size() << " votes (will retry): " << e.what());
+        }
+        for (const std::string& video : videos) {
+            tally_cache.endWrite(video);
+        }
+
+        if (ok) {
+            uint64_t us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+            batches.fetch_add(1, std::memory_order_relaxed);
+            total_batch_us.fetch_add(us, std::memory_order_relaxed);
+            uint64_t prev = max_batch_us.load(std::memory_order_relaxed);
+            while (us > prev && !max_batch_us.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+            }
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (stopping && ++retries_at_stop > 3) {
+            return false;
+        }
+        work.wait_for(lock, delay);
+        delay = std::min(delay * 2, std::chrono::milliseconds(5000));
+    }
+}
+
+void VotePipeline::retire(const std::vector<Queued>& batch) {
+    uint64_t max_seq = 0;
+    for (const Queued& q : batch) {
+        const VoteRecord& record = q.record;
+        max_seq = std::max(max_seq, record.seq);
+        const std::string key = rowKey(record.video_id, record.topic_id, record.user_id);
+        Stripe& stripe = stripeFor(key);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        auto it = stripe.rows.find(key);
+        // A newer vote on the key is still queued; it keeps the overlay entry
+        if (it != stripe.rows.end() && it->second.first == record.seq) {
+            stripe.rows.erase(it);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const Queued& q : batch) {
+            addPendingDelta(q.record.video_id, q.record.topic_id, -q.vote_delta, -q.voter_delta);
+        }
+        pending -= batch.size();
+    }
+    written.fetch_add(batch.size(), std::memory_order_relaxed);
+    log.release(max_seq);
+}
+
+VotePipelineStats VotePipeline::stats() const {
+    VotePipelineStats s;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        s.pending = pending;
+    }
+    s.accepted = accepted.load(std::memory_order_relaxed);
+    s.written = written.load(std::memory_order_relaxed);
+    s.batches = batches.load(std::memory_order_relaxed);
+    s.write_errors = write_errors.load(std::memory_order_relaxed);
+    s.replayed = replayed.load(std::memory_order_relaxed);
+    s.total_batch_us = total_batch_us.load(std::memory_order_relaxed);
+    s.max_batch_us = max_batch_us.load(std::memory_order_relaxed);
+    s.log = log.stats();
+    return s;
+}
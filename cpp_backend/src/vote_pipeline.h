@@ -0,0 +1,132 @@
+#ifndef VOTE_PIPELINE_H
+#define VOTE_PIPELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "tally_cache.h"
+#include "vote_log.h"
+
+struct VotePipelineStats {
+  uint64_t accepted;
+  uint64_t written;       // records written back to Postgres
+  uint64_t batches;
+  uint64_t write_errors;  // failed batch writes (retried)
+  uint64_t replayed;      // records replayed from the log at startup
+  size_t pending;         // accepted, not yet written back
+  uint64_t total_batch_us;
+  uint64_t max_batch_us;
+  VoteLogStats log;
+};
+
+// Write-behind vote path. An accepted vote is appended to the VoteLog, applied to
+// the in-memory state by the caller, and queued; a writer thread drains the queue
+// into Postgres in batches of up to batch_size, waiting up to linger for a batch
+// to fill. Until its batch commits, a vote's resulting row is kept in an overlay
+// (so the next vote on the same key sees it) and its tally deltas are kept per
+// video (so tallies loaded from Postgres can be brought up to date).
+class VotePipeline {
+public:
+  // Write the batch to Postgres in one transaction; throw to have it retried
+  using WriteFn = std::function<void(const std::vector<VoteRecord>&)>;
+
+  VotePipeline(std::string log_dir, uint64_t segment_bytes, size_t batch_size,
+               std::chrono::milliseconds linger, size_t max_pending,
+               TallyCache& tally_cache, WriteFn write);
+  ~VotePipeline();
+
+  VotePipeline(const VotePipeline&) = delete;
+  VotePipeline& operator=(const VotePipeline&) = delete;
+
+  // Write back whatever the log still holds from the last run, then start the
+  // writer thread. Call before serving votes. Throws if the log can't be used.
+  void start();
+  // Write back everything accepted so far and stop the writer
+  void stop();
+
+  // Serializes votes on one (video, topic, user): hold it across pendingVote()
+  // and submit() so the decision and the log order agree
+  std::unique_lock<std::mutex> lockKey(const std::string& videoId, int topicId, const std::string& userId);
+
+  // The key's latest accepted row if it isn't in Postgres yet (nullopt vote:
+  // deleted). Returns false if Postgres is current. Requires lockKey().
+  bool pendingVote(const std::string& videoId, int topicId, const std::string& userId,
+                   std::optional<int>& vote) const;
+
+  // Log and queue the key's new row. voteDelta/voterDelta are relative to the
+  // previous row, as for TallyCache::applyVote. Returns the record's seq for
+  // waitDurable(). Requires lockKey(). Throws ServiceUnavailable if too many
+  // votes are waiting or the log has failed.
+  uint64_t submit(const std::string& videoId, int topicId, const std::string& userId,
+                  std::optional<int> vote, int voteDelta, int voterDelta);
+
+  // Block until the record is on disk (group commit with concurrent callers)
+  void waitDurable(uint64_t seq);
+
+  // Add the deltas of videoId's queued votes to tallies read from Postgres
+  void addPending(const std::string& videoId, std::vector<TopicTally>& tallies) const;
+
+  VotePipelineStats stats() const;
+
+private:
+  struct Queued {
+    VoteRecord record;
+    int vote_delta;
+    int voter_delta;
+  };
+  struct Stripe {
+    std::mutex mutex;
+    // key -> (seq, row) of the newest queued record for the key
+    std::unordered_map<std::string, std::pair<uint64_t, std::optional<int>>> rows;
+  };
+
+  static constexpr size_t STRIPES = 256;
+
+  static std::string rowKey(const std::string& videoId, int topicId, const std::string& userId);
+  Stripe& stripeFor(const std::string& key) const;
+  // Add to pending_tallies, dropping deltas that reach zero; mutex held
+  void addPendingDelta(const std::string& videoId, int topicId, int voteDelta, int voterDelta);
+  void run();
+  // Write one batch, retrying until it commits; gives up after a few retries once stopping
+  bool writeBatch(const std::vector<Queued>& batch);
+  void retire(const std::vector<Queued>& batch);
+
+  VoteLog log;
+  const size_t batch_size;
+  const std::chrono::milliseconds linger;
+  const size_t max_pending;
+  TallyCache& tally_cache;
+  WriteFn write;
+
+  std::unique_ptr<Stripe[]> stripes;
+
+  mutable std::mutex mutex;
+  std::condition_variable work;
+  std::deque<Queued> queue;
+  size_t pending = 0;  // queued + being written
+  uint64_t last_seq = 0;
+  bool stopping = false;
+  // videoId -> per-topic (vote, voter) deltas of pending records
+  std::unordered_map<std::string, std::vector<TopicTally>> pending_tallies;
+  std::thread writer;
+
+  std::atomic<uint64_t> accepted{0};
+  std::atomic<uint64_t> written{0};
+  std::atomic<uint64_t> batches{0};
+  std::atomic<uint64_t> write_errors{0};
+  std::atomic<uint64_t> replayed{0};
+  std::atomic<uint64_t> total_batch_us{0};
+  std::atomic<uint64_t> max_batch_us{0};
+};
+
+#endif // VOTE_PIPELINE_H
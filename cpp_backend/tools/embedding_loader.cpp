@@ -0,0 +1,284 @@
+// Offline bulk loader for video embeddings.
+//
+// Streams embeddings from a local binary file into Postgres with COPY into a
+// staging table, then merges them into videos.vector_embedding with one
+// set-based statement. Optionally rebuilds the ivfflat index afterwards.
+//
+// Usage:
+//   embedding-loader --ids ids.txt (--raw embeddings.f32 | --npy embeddings.npy)
+//                    [--dim 384] [--conn "host=... dbname=..."]
+//                    [--insert-missing] [--rebuild-index] [--lists N]
+//
+// ids.txt holds one video ID per line, in the same order as the embedding rows.
+// --raw expects headerless little-endian float32 rows; --npy expects a 2-D
+// '<f4' C-order array.
+
+#include <pqxx/pqxx>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "config.h"
+#include "helpers.h"
+#include "vector_codec.h"
+
+namespace {
+
+struct Options {
+    std::string ids_path;
+    std::string raw_path;
+    std::string npy_path;
+    std::string conn_str;
+    size_t dim = EMBEDDING_DIM;
+    bool insert_missing = false;
+    bool rebuild_index = false;
+    size_t lists = 0; // 0 = derive from row count
+};
+
+void printUsage() {
+    std::cerr << "Usage: embedding-loader --ids ids.txt (--raw embeddings.f32 | --npy embeddings.npy)\n"
+                 "                        [--dim 384] [--conn \"host=... dbname=...\"]\n"
+                 "                        [--insert-missing] [--rebuild-index] [--lists N]" << std::endl;
+}
+
+Options parseArgs(int argc, char** argv) {
+    Options opts;
+    opts.conn_str = buildConnectionString();
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+        if (arg == "--ids") {
+            opts.ids_path = value();
+        } else if (arg == "--raw") {
+            opts.raw_path = value();
+        } else if (arg == "--npy") {
+            opts.npy_path = value();
+        } else if (arg == "--conn") {
+            opts.conn_str = value();
+        } else if (arg == "--dim") {
+            opts.dim = std::stoul(value());
+        } else if (arg == "--lists") {
+            opts.lists = std::stoul(value());
+        } else if (arg == "--insert-missing") {
+            opts.insert_missing = true;
+        } else if (arg == "--rebuild-index") {
+            opts.rebuild_index = true;
+        } else {
+            throw std::invalid_argument("Unknown argument: " + arg);
+        }
+    }
+    if (opts.ids_path.empty() || opts.raw_path.empty() == opts.npy_path.empty()) {
+        throw std::invalid_argument("--ids and exactly one of --raw or --npy are required.");
+    }
+    if (opts.dim != EMBEDDING_DIM) {
+        throw std::invalid_argument("videos.vector_embedding is VECTOR(" + std::to_string(EMBEDDING_DIM) + ").");
+    }
+    return opts;
+}
+
+std::vector<std::string> readIds(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Cannot open ID list: " + path);
+    }
+    std::vector<std::string> ids;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            ids.push_back(line);
+        }
+    }
+    return ids;
+}
+
+// Opens the embedding file positioned at the first row and returns the row count.
+size_t openEmbeddings(const Options& opts, std::ifstream& in) {
+    const std::string& path = opts.raw_path.empty() ? opts.npy_path : opts.raw_path;
+    in.open(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open embedding file: " + path);
+    }
+    in.seekg(0, std::ios::end);
+    uint64_t file_size = static_cast<uint64_t>(in.tellg());
+    in.seekg(0, std::ios::beg);
+    const uint64_t row_bytes = opts.dim * sizeof(float);
+
+    if (!opts.raw_path.empty()) {
+        if (file_size % row_bytes != 0) {
+            throw std::runtime_error("Raw file size is not a multiple of " + std::to_string(row_bytes) + " bytes.");
+        }
+        return file_size / row_bytes;
+    }
+
+    // .npy: magic, version, little-endian header length, then a Python dict literal
+    char magic[8];
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, "\x93NUMPY", 6) != 0) {
+        throw std::runtime_error("Not a .npy file: " + path);
+    }
+    uint32_t header_len = 0;
+    if (magic[6] == 1) {
+        unsigned char len[2];
+        in.read(reinterpret_cast<char*>(len), 2);
+        header_len = len[0] | (len[1] << 8);
+    } else {
+        unsigned char len[4];
+        in.read(reinterpret_cast<char*>(len), 4);
+        header_len = len[0] | (len[1] << 8) | (len[2] << 16) | (static_cast<uint32_t>(len[3]) << 24);
+    }
+    std::string header(header_len, '\0');
+    in.read(&header[0], header_len);
+    if (!in) {
+        throw std::runtime_error("Truncated .npy header.");
+    }
+    if (header.find("'<f4'") == std::string::npos) {
+        throw std::runtime_error(".npy dtype must be little-endian float32 ('<f4').");
+    }
+    if (header.find("'fortran_order': False") == std::string::npos) {
+        throw std::runtime_error(".npy array must be C-ordered.");
+    }
+    size_t shape_pos = header.find("'shape': (");
+    if (shape_pos == std::string::npos) {
+        throw std::runtime_error(".npy header has no shape.");
+    }
+    size_t rows = 0, cols = 0;
+    if (std::sscanf(header.c_str() + shape_pos, "'shape': (%zu, %zu)", &rows, &cols) != 2 || cols != opts.dim) {
+        throw std::runtime_error(".npy shape must be (N, " + std::to_string(opts.dim) + ").");
+    }
+    uint64_t data_bytes = file_size - static_cast<uint64_t>(in.tellg());
+    if (data_bytes != rows * row_bytes) {
+        throw std::runtime_error(".npy data size does not match its shape.");
+    }
+    return rows;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opts;
+    try {
+        opts = parseArgs(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage();
+        return 2;
+    }
+
+    try {
+        std::vector<std::string> ids = readIds(opts.ids_path);
+        std::ifstream in;
+        size_t rows = openEmbeddings(opts, in);
+        if (rows != ids.size()) {
+            throw std::runtime_error("ID list has " + std::to_string(ids.size()) + " entries but the embedding file has " +
+                                     std::to_string(rows) + " rows.");
+        }
+        std::cout << "Loading " << rows << " embeddings of dimension " << opts.dim << "." << std::endl;
+
+        pqxx::connection conn(opts.conn_str);
+        pqxx::work txn(conn);
+        txn.exec("CREATE TEMP TABLE embedding_staging ("
+                 "seq BIGINT NOT NULL, id VARCHAR(255) NOT NULL, embedding VECTOR(" + std::to_string(opts.dim) + ") NOT NULL"
+                 ") ON COMMIT DROP");
+
+        // Phase 1: COPY every row into the staging table
+        auto copy_start = std::chrono::steady_clock::now();
+        {
+            pqxx::stream_to stream(txn, "embedding_staging");
+            std::vector<float> row(opts.dim);
+            std::string text;
+            for (size_t i = 0; i < rows; ++i) {
+                in.read(reinterpret_cast<char*>(row.data()), opts.dim * sizeof(float));
+                if (!in) {
+                    throw std::runtime_error("Unexpected end of embedding file at row " + std::to_string(i) + ".");
+                }
+                for (float f : row) {
+                    if (!std::isfinite(f)) {
+                        throw std::runtime_error("Non-finite value in row " + std::to_string(i) + " (" + ids[i] + ").");
+                    }
+                }
+                encodePgvector(row.data(), row.size(), text);
+                stream << std::make_tuple(static_cast<int64_t>(i), ids[i], text);
+                if ((i + 1) % 100000 == 0) {
+                    std::cout << "  copied " << (i + 1) << " rows..." << std::endl;
+                }
+            }
+            stream.complete();
+        }
+        double copy_secs = secondsSince(copy_start);
+        std::cout << "COPY: " << rows << " rows in " << copy_secs << " s ("
+                  << static_cast<uint64_t>(rows / std::max(copy_secs, 1e-9)) << " rows/s, "
+                  << (rows * opts.dim * sizeof(float) / (1024.0 * 1024.0)) / std::max(copy_secs, 1e-9) << " MiB/s of float32)" << std::endl;
+
+        // Phase 2: one set-based merge; the last row wins for duplicate IDs. Each merged row takes
+        // a new embedding_version so running backends pick it up on their next startup catch-up.
+        auto merge_start = std::chrono::steady_clock::now();
+        const std::string latest =
+            "SELECT DISTINCT ON (id) id, embedding FROM embedding_staging ORDER BY id, seq DESC";
+        pqxx::result merged;
+        if (opts.insert_missing) {
+            merged = txn.exec("INSERT INTO videos (id, vector_embedding, embedding_version) "
+                              "SELECT id, embedding, nextval('video_embedding_version_seq') FROM (" + latest + ") s "
+                              "ON CONFLICT (id) DO UPDATE SET vector_embedding = EXCLUDED.vector_embedding, "
+                              "embedding_version = EXCLUDED.embedding_version");
+        } else {
+            merged = txn.exec("UPDATE videos v SET vector_embedding = s.embedding, "
+                              "embedding_version = nextval('video_embedding_version_seq') "
+                              "FROM (" + latest + ") s WHERE v.id = s.id");
+        }
+        double merge_secs = secondsSince(merge_start);
+        std::cout << "Merge: " << merged.affected_rows() << " videos updated in " << merge_secs << " s";
+        if (!opts.insert_missing && merged.affected_rows() < rows) {
+            std::cout << " (IDs not in videos were skipped; use --insert-missing to create them)";
+        }
+        std::cout << std::endl;
+
+        txn.commit();
+
+        // Phase 3: rebuild ivfflat once, on the loaded data, instead of maintaining it per row
+        if (opts.rebuild_index) {
+            auto index_start = std::chrono::steady_clock::now();
+            pqxx::work index_txn(conn);
+            size_t total = index_txn.exec("SELECT COUNT(*) FROM videos WHERE vector_embedding IS NOT NULL")[0][0].as<size_t>();
+            // pgvector guidance: rows / 1000 lists up to 1M rows, sqrt(rows) beyond
+            size_t lists = opts.lists;
+            if (lists == 0) {
+                lists = total <= 1000000 ? std::max<size_t>(1, total / 1000)
+                                         : static_cast<size_t>(std::sqrt(static_cast<double>(total)));
+            }
+            index_txn.exec("DROP INDEX IF EXISTS videos_vector_idx");
+            index_txn.exec("CREATE INDEX videos_vector_idx ON videos USING ivfflat (vector_embedding vector_cosine_ops) "
+                           "WITH (lists = " + std::to_string(lists) + ")");
+            index_txn.commit();
+            std::cout << "Index: rebuilt videos_vector_idx with " << lists << " lists over " << total
+                      << " embeddings in " << secondsSince(index_start) << " s" << std::endl;
+        }
+    } catch (const pqxx::sql_error& e) {
+        std::cerr << "SQL error: " << e.what() << std::endl;
+        return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
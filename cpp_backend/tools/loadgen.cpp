@@ -0,0 +1,652 @@
+// End-to-end load generator for the backend.
+//
+// Seeds a running backend through its own API (videos, topic votes and
+// embeddings, so Postgres and every in-memory index see realistic data), then
+// drives it from --connections keep-alive connections, one thread each, with a
+// weighted mix of requests. Video and topic popularity follow a Zipf
+// distribution. Throughput and p50/p99/p99.9 latency are reported per route;
+// --json prints them machine-readable, and --baseline compares against the
+// JSON of an earlier run.
+//
+// Usage:
+//   loadgen [--host 127.0.0.1] [--port 8000] [--connections 16]
+//           [--duration 30] [--warmup 5] [--videos 10000] [--users 1000]
+//           [--topics 200] [--zipf 0.99] [--embedded 0.5] [--seed 1]
+//           [--mix get_video=5,topics=35,...] [--no-seed] [--json]
+//           [--baseline previous.json]
+//
+// Mix operations: get_video, topics, batch, vote, insert, embedding, similar,
+// similar_hybrid, similar_by_vector, user_stats.
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "metrics.h"
+
+namespace beast = boost::beast;
+namespace http = boost::beast::http;
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+enum class Op { GetVideo, Topics, Batch, Vote, Insert, Embedding, Similar, SimilarHybrid, SimilarByVector, UserStats };
+
+struct OpSpec {
+    Op op;
+    const char* name;
+    unsigned int weight; // default mix, roughly a feed-heavy front end
+};
+
+const OpSpec OPS[] = {
+    {Op::GetVideo, "get_video", 5},
+    {Op::Topics, "topics", 35},
+    {Op::Batch, "batch", 15},
+    {Op::Vote, "vote", 20},
+    {Op::Insert, "insert", 2},
+    {Op::Embedding, "embedding", 3},
+    {Op::Similar, "similar", 8},
+    {Op::SimilarHybrid, "similar_hybrid", 2},
+    {Op::SimilarByVector, "similar_by_vector", 5},
+    {Op::UserStats, "user_stats", 5},
+};
+const size_t OP_COUNT = sizeof(OPS) / sizeof(OPS[0]);
+
+// Video IDs per POST /topics/batch (one feed page)
+const size_t BATCH_VIDEOS = 20;
+// Embedding clusters, so vector similarity has neighbours to find
+const size_t EMBEDDING_CLUSTERS = 32;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    std::string port = "8000";
+    size_t connections = 16;
+    double duration = 30;
+    double warmup = 5;
+    size_t videos = 10000;
+    size_t users = 1000;
+    size_t topics = 200;
+    double zipf = 0.99;
+    double embedded = 0.5;
+    uint64_t seed = 1;
+    std::vector<unsigned int> weights;
+    bool no_seed = false;
+    bool json = false;
+    std::string baseline_path;
+};
+
+void printUsage() {
+    std::cerr << "Usage: loadgen [--host 127.0.0.1] [--port 8000] [--connections 16]\n"
+                 "               [--duration 30] [--warmup 5] [--videos 10000] [--users 1000]\n"
+                 "               [--topics 200] [--zipf 0.99] [--embedded 0.5] [--seed 1]\n"
+                 "               [--mix get_video=5,topics=35,...] [--no-seed] [--json]\n"
+                 "               [--baseline previous.json]" << std::endl;
+}
+
+// "name=weight,..." overrides the default weights of the named operations
+void parseMix(const std::string& mix, std::vector<unsigned int>& weights) {
+    size_t pos = 0;
+    while (pos < mix.size()) {
+        size_t end = std::min(mix.find(',', pos), mix.size());
+        std::string item = mix.substr(pos, end - pos);
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            throw std::invalid_argument("Mix entries must be name=weight: " + item);
+        }
+        std::string name = item.substr(0, eq);
+        auto it = std::find_if(std::begin(OPS), std::end(OPS), [&](const OpSpec& s) { return name == s.name; });
+        if (it == std::end(OPS)) {
+            throw std::invalid_argument("Unknown mix operation: " + name);
+        }
+        weights[static_cast<size_t>(it - std::begin(OPS))] = static_cast<unsigned int>(std::stoul(item.substr(eq + 1)));
+        pos = end + 1;
+    }
+}
+
+Options parseArgs(int argc, char** argv) {
+    Options opts;
+    for (const OpSpec& spec : OPS) {
+        opts.weights.push_back(spec.weight);
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+        if (arg == "--host") {
+            opts.host = value();
+        } else if (arg == "--port") {
+            opts.port = value();
+        } else if (arg == "--connections") {
+            opts.connections = std::max<size_t>(1, std::stoul(value()));
+        } else if (arg == "--duration") {
+            opts.duration = std::stod(value());
+        } else if (arg == "--warmup") {
+            opts.warmup = std::stod(value());
+        } else if (arg == "--videos") {
+            opts.videos = std::max<size_t>(1, std::stoul(value()));
+        } else if (arg == "--users") {
+            opts.users = std::max<size_t>(1, std::stoul(value()));
+        } else if (arg == "--topics") {
+            opts.topics = std::max<size_t>(1, std::stoul(value()));
+        } else if (arg == "--zipf") {
+            opts.zipf = std::stod(value());
+        } else if (arg == "--embedded") {
+            opts.embedded = std::clamp(std::stod(value()), 0.0, 1.0);
+        } else if (arg == "--seed") {
+            opts.seed = std::stoull(value());
+        } else if (arg == "--mix") {
+            parseMix(value(), opts.weights);
+        } else if (arg == "--no-seed") {
+            opts.no_seed = true;
+        } else if (arg == "--json") {
+            opts.json = true;
+        } else if (arg == "--baseline") {
+            opts.baseline_path = value();
+        } else {
+            throw std::invalid_argument("Unknown argument: " + arg);
+        }
+    }
+    if (opts.duration <= 0) {
+        throw std::invalid_argument("--duration must be positive");
+    }
+    return opts;
+}
+
+// Ranks 0..n-1 with P(rank) proportional to 1 / (rank + 1)^s
+class ZipfSampler {
+public:
+    ZipfSampler(size_t n, double s) : cdf(n) {
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+            cdf[i] = sum;
+        }
+        for (double& c : cdf) {
+            c /= sum;
+        }
+    }
+
+    template <typename Rng>
+    size_t operator()(Rng& rng) const {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        return std::min(static_cast<size_t>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin()), cdf.size() - 1);
+    }
+
+private:
+    std::vector<double> cdf;
+};
+
+// 11 characters, like a YouTube ID, so POST /videos accepts the URL
+std::string videoId(size_t index) {
+    char id[16];
+    std::snprintf(id, sizeof(id), "lg%09zu", index % 1000000000);
+    return id;
+}
+
+std::string userId(size_t index) {
+    return "loadgen-user-" + std::to_string(index);
+}
+
+std::string topicName(size_t index) {
+    return "loadgen-topic-" + std::to_string(index);
+}
+
+// Unit vector near one of EMBEDDING_CLUSTERS fixed centroids
+std::string embeddingJson(size_t cluster, std::mt19937_64& rng) {
+    std::mt19937_64 centroid_rng(cluster);
+    std::normal_distribution<float> normal(0, 1);
+    std::vector<float> v(EMBEDDING_DIM);
+    double norm = 0;
+    for (float& x : v) {
+        x = normal(centroid_rng) + 0.3f * normal(rng);
+        norm += static_cast<double>(x) * x;
+    }
+    const float scale = static_cast<float>(1.0 / std::sqrt(std::max(norm, 1e-12)));
+    std::string body = "{\"embedding\":[";
+    char num[32];
+    for (size_t i = 0; i < v.size(); ++i) {
+        int n = std::snprintf(num, sizeof(num), i ? ",%.6f" : "%.6f", v[i] * scale);
+        body.append(num, static_cast<size_t>(n));
+    }
+    body += "]}";
+    return body;
+}
+
+// One keep-alive HTTP/1.1 connection
+class HttpClient {
+public:
+    HttpClient(const std::string& host, const tcp::resolver::results_type& endpoints)
+        : host(host), endpoints(endpoints), stream(io) {}
+
+    // Returns the status code; a connection the server closed is reopened once.
+    // Throws on transport errors.
+    int request(http::verb verb, const std::string& target, const std::string& body) {
+        for (int attempt = 0;; ++attempt) {
+            try {
+                if (!connected) {
+                    stream.connect(endpoints);
+                    stream.socket().set_option(tcp::no_delay(true));
+                    connected = true;
+                }
+                http::request<http::string_body> req{verb, target, 11};
+                req.set(http::field::host, host);
+                req.keep_alive(true);
+                if (!body.empty()) {
+                    req.set(http::field::content_type, "application/json");
+                    req.body() = body;
+                }
+                req.prepare_payload();
+                http::write(stream, req);
+                http::response<http::string_body> res;
+                http::read(stream, buffer, res);
+                if (!res.keep_alive()) {
+                    close();
+                }
+                return static_cast<int>(res.result_int());
+            } catch (const beast::system_error&) {
+                close();
+                if (attempt > 0) {
+                    throw;
+                }
+            }
+        }
+    }
+
+private:
+    void close() {
+        beast::error_code ignored;
+        stream.socket().shutdown(tcp::socket::shutdown_both, ignored);
+        stream.close();
+        buffer.clear();
+        connected = false;
+    }
+
+    std::string host;
+    tcp::resolver::results_type endpoints;
+    net::io_context io;
+    beast::tcp_stream stream;
+    beast::flat_buffer buffer;
+    bool connected = false;
+};
+
+struct OpStats {
+    LatencyHistogram latency;
+    std::atomic<uint64_t> ok{0};            // 2xx/3xx
+    std::atomic<uint64_t> client_errors{0}; // 4xx
+    std::atomic<uint64_t> server_errors{0}; // 5xx
+    std::atomic<uint64_t> failures{0};      // no response
+};
+
+struct Workload {
+    const Options& opts;
+    ZipfSampler video_popularity;
+    ZipfSampler topic_popularity;
+    size_t embedded_videos;
+    std::vector<unsigned int> cumulative_weights;
+
+    explicit Workload(const Options& opts)
+        : opts(opts), video_popularity(opts.videos, opts.zipf), topic_popularity(opts.topics, opts.zipf),
+          embedded_videos(std::max<size_t>(1, static_cast<size_t>(opts.videos * opts.embedded))) {
+        unsigned int sum = 0;
+        for (unsigned int w : opts.weights) {
+            sum += w;
+            cumulative_weights.push_back(sum);
+        }
+        if (sum == 0) {
+            throw std::invalid_argument("The mix has no operation with a positive weight");
+        }
+    }
+
+    size_t pickOp(std::mt19937_64& rng) const {
+        unsigned int r = std::uniform_int_distribution<unsigned int>(0, cumulative_weights.back() - 1)(rng);
+        return static_cast<size_t>(std::upper_bound(cumulative_weights.begin(), cumulative_weights.end(), r) -
+                                   cumulative_weights.begin());
+    }
+};
+
+struct Request {
+    http::verb verb = http::verb::get;
+    std::string target;
+    std::string body;
+};
+
+Request makeRequest(const Workload& w, Op op, std::mt19937_64& rng, size_t thread, uint64_t& inserted) {
+    const std::string video = videoId(w.video_popularity(rng));
+    Request r;
+    switch (op) {
+        case Op::GetVideo:
+            r.target = "/videos/" + video;
+            break;
+        case Op::Topics:
+            r.target = "/videos/" + video + "/topics";
+            break;
+        case Op::Batch: {
+            nlohmann::json ids = nlohmann::json::array();
+            for (size_t i = 0; i < BATCH_VIDEOS; ++i) {
+                ids.push_back(videoId(w.video_popularity(rng)));
+            }
+            r.verb = http::verb::post;
+            r.target = "/topics/batch";
+            r.body = nlohmann::json{{"video_ids", ids}}.dump();
+            break;
+        }
+        case Op::Vote: {
+            // Repeating a user's vote removes it, so the mix exercises all three toggle outcomes
+            const size_t user = std::uniform_int_distribution<size_t>(0, w.opts.users - 1)(rng);
+            r.verb = http::verb::post;
+            r.target = "/videos/" + video + "/topics";
+            r.body = nlohmann::json{{"name", topicName(w.topic_popularity(rng))},
+                                    {"desired_vote", std::bernoulli_distribution(0.8)(rng) ? 1 : -1},
+                                    {"user_id", userId(user)}}.dump();
+            break;
+        }
+        case Op::Insert: {
+            // IDs past the seeded range, distinct per thread; reruns hit existing rows
+            char id[16];
+            std::snprintf(id, sizeof(id), "ln%02zu%07llu", thread % 100,
+                          static_cast<unsigned long long>(inserted++ % 10000000));
+            r.verb = http::verb::post;
+            r.target = "/videos";
+            r.body = nlohmann::json{{"id", std::string("https://www.youtube.com/watch?v=") + id},
+                                    {"title", std::string("Load test upload ") + id}}.dump();
+            break;
+        }
+        case Op::Embedding: {
+            const size_t index = w.video_popularity(rng) % w.embedded_videos;
+            r.verb = http::verb::post;
+            r.target = "/videos/" + videoId(index) + "/embedding";
+            r.body = embeddingJson(index % EMBEDDING_CLUSTERS, rng);
+            break;
+        }
+        case Op::Similar:
+            r.target = "/videos/" + video + "/similar?limit=20";
+            break;
+        case Op::SimilarHybrid:
+            r.target = "/videos/" + video + "/similar_hybrid?limit=20";
+            break;
+        case Op::SimilarByVector:
+            r.target = "/videos/" + videoId(w.video_popularity(rng) % w.embedded_videos) + "/similar_by_vector?limit=20";
+            break;
+        case Op::UserStats:
+            r.target = "/users/" + userId(std::uniform_int_distribution<size_t>(0, w.opts.users - 1)(rng)) + "/stats";
+            break;
+    }
+    return r;
+}
+
+// Creates every video, one to three upvotes each from random users on popular
+// topics, and embeddings for the first --embedded fraction (the most popular).
+// Throws if any request is not 2xx: a load run against a half-seeded backend
+// would mostly measure error paths.
+void seed(const Workload& w, const tcp::resolver::results_type& endpoints) {
+    const Options& opts = w.opts;
+    std::atomic<size_t> next{0};
+    std::atomic<uint64_t> errors{0};
+    std::mutex first_error_mutex;
+    std::string first_error;
+    auto recordError = [&](const std::string& what) {
+        if (errors.fetch_add(1) == 0) {
+            std::lock_guard<std::mutex> lock(first_error_mutex);
+            first_error = what;
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < opts.connections; ++t) {
+        threads.emplace_back([&, t]() {
+            HttpClient client(opts.host, endpoints);
+            std::mt19937_64 rng(opts.seed * 7919 + t);
+            auto send = [&](http::verb verb, const std::string& target, const std::string& body) {
+                const auto verb_name = http::to_string(verb);
+                const std::string request_line = std::string(verb_name.data(), verb_name.size()) + " " + target;
+                try {
+                    const int status = client.request(verb, target, body);
+                    if (status < 200 || status >= 300) {
+                        recordError(request_line + " returned " + std::to_string(status));
+                    }
+                } catch (const std::exception& e) {
+                    recordError(request_line + " failed: " + e.what());
+                }
+            };
+            for (size_t i = next.fetch_add(1); i < opts.videos; i = next.fetch_add(1)) {
+                const std::string id = videoId(i);
+                send(http::verb::post, "/videos",
+                     nlohmann::json{{"id", "https://www.youtube.com/watch?v=" + id},
+                                    {"title", "Load test video " + std::to_string(i)}}.dump());
+                for (size_t v = 0; v <= i % 3; ++v) {
+                    send(http::verb::post, "/videos/" + id + "/topics",
+                         nlohmann::json{{"name", topicName(w.topic_popularity(rng))}, {"desired_vote", 1},
+                                        {"user_id", userId(std::uniform_int_distribution<size_t>(0, opts.users - 1)(rng))}}
+                             .dump());
+                }
+                if (i < w.embedded_videos) {
+                    send(http::verb::post, "/videos/" + id + "/embedding", embeddingJson(i % EMBEDDING_CLUSTERS, rng));
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::cerr << "Seeded " << opts.videos << " videos in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s ("
+              << errors.load() << " failed requests)." << std::endl;
+    if (errors.load() > 0) {
+        throw std::runtime_error("Seeding failed: " + std::to_string(errors.load()) +
+                                 " requests were not 2xx (first: " + first_error + ")");
+    }
+}
+
+bool alreadySeeded(const Options& opts, const tcp::resolver::results_type& endpoints) {
+    HttpClient client(opts.host, endpoints);
+    return client.request(http::verb::get, "/videos/" + videoId(0), "") == 200 &&
+           client.request(http::verb::get, "/videos/" + videoId(opts.videos - 1), "") == 200;
+}
+
+nlohmann::json summarize(const std::string& name, const LatencyHistogram::Snapshot& s, uint64_t ok,
+                         uint64_t client_errors, uint64_t server_errors, uint64_t failures, double seconds) {
+    nlohmann::json out;
+    out["name"] = name;
+    out["requests"] = s.count;
+    out["rps"] = s.count / seconds;
+    out["ok"] = ok;
+    out["client_errors"] = client_errors;
+    out["server_errors"] = server_errors;
+    out["failures"] = failures;
+    out["mean_ms"] = s.count ? s.sum_us / 1e3 / static_cast<double>(s.count) : 0.0;
+    out["p50_ms"] = s.quantile(0.5) / 1e3;
+    out["p99_ms"] = s.quantile(0.99) / 1e3;
+    out["p999_ms"] = s.quantile(0.999) / 1e3;
+    return out;
+}
+
+double change(const nlohmann::json& now, const nlohmann::json& before, const char* key) {
+    double b = before.value(key, 0.0);
+    return b > 0 ? (now.value(key, 0.0) - b) / b * 100 : 0;
+}
+
+void printReport(const nlohmann::json& report, const nlohmann::json* baseline) {
+    std::printf("%-18s %10s %10s %9s %9s %9s %9s %8s\n", "route", "requests", "req/s", "mean ms", "p50 ms", "p99 ms",
+                "p99.9 ms", "errors");
+    auto row = [&](const nlohmann::json& r) {
+        uint64_t errors = r["client_errors"].get<uint64_t>() + r["server_errors"].get<uint64_t>() +
+                          r["failures"].get<uint64_t>();
+        std::printf("%-18s %10llu %10.1f %9.3f %9.3f %9.3f %9.3f %8llu", r["name"].get<std::string>().c_str(),
+                    static_cast<unsigned long long>(r["requests"].get<uint64_t>()), r["rps"].get<double>(),
+                    r["mean_ms"].get<double>(), r["p50_ms"].get<double>(), r["p99_ms"].get<double>(),
+                    r["p999_ms"].get<double>(), static_cast<unsigned long long>(errors));
+        if (baseline) {
+            const nlohmann::json* before = nullptr;
+            if (r["name"] == "total") {
+                auto it = baseline->find("total");
+                before = it != baseline->end() ? &*it : nullptr;
+            } else if (baseline->contains("routes")) {
+                for (const auto& b : baseline->at("routes")) {
+                    if (b.value("name", "") == r["name"]) {
+                        before = &b;
+                    }
+                }
+            }
+            if (before && before->is_object()) {
+                std::printf("   req/s %+6.1f%%  p99 %+6.1f%%", change(r, *before, "rps"), change(r, *before, "p99_ms"));
+            }
+        }
+        std::printf("\n");
+    };
+    for (const auto& r : report["routes"]) {
+        row(r);
+    }
+    row(report["total"]);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opts;
+    try {
+        opts = parseArgs(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage();
+        return 2;
+    }
+
+    try {
+        nlohmann::json baseline;
+        if (!opts.baseline_path.empty()) {
+            std::ifstream in(opts.baseline_path);
+            if (!in) {
+                throw std::runtime_error("Cannot open " + opts.baseline_path);
+            }
+            baseline = nlohmann::json::parse(in);
+        }
+
+        Workload workload(opts);
+        net::io_context io;
+        tcp::resolver::results_type endpoints = tcp::resolver(io).resolve(opts.host, opts.port);
+
+        if (opts.no_seed) {
+            std::cerr << "Skipping seeding (--no-seed)." << std::endl;
+        } else if (alreadySeeded(opts, endpoints)) {
+            std::cerr << "Backend already holds the seeded videos, skipping seeding." << std::endl;
+        } else {
+            seed(workload, endpoints);
+        }
+
+        std::vector<OpStats> stats(OP_COUNT);
+        const auto start = std::chrono::steady_clock::now();
+        const auto measure_from = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                              std::chrono::duration<double>(opts.warmup));
+        const auto stop_at = measure_from + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                std::chrono::duration<double>(opts.duration));
+        std::cerr << "Running " << opts.connections << " connections for " << opts.warmup << " s warmup + "
+                  << opts.duration << " s." << std::endl;
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < opts.connections; ++t) {
+            threads.emplace_back([&, t]() {
+                HttpClient client(opts.host, endpoints);
+                std::mt19937_64 rng(opts.seed * 104729 + t);
+                uint64_t inserted = 0;
+                while (true) {
+                    const auto sent = std::chrono::steady_clock::now();
+                    if (sent >= stop_at) {
+                        break;
+                    }
+                    const size_t op = workload.pickOp(rng);
+                    Request r = makeRequest(workload, OPS[op].op, rng, t, inserted);
+                    const bool measured = sent >= measure_from;
+                    OpStats& s = stats[op];
+                    int status;
+                    try {
+                        status = client.request(r.verb, r.target, r.body);
+                    } catch (const std::exception&) {
+                        if (measured) {
+                            s.failures.fetch_add(1, std::memory_order_relaxed);
+                        }
+                        // Don't spin against a backend that is down
+                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                        continue;
+                    }
+                    if (!measured) {
+                        continue;
+                    }
+                    s.latency.record(sent);
+                    if (status >= 500) {
+                        s.server_errors.fetch_add(1, std::memory_order_relaxed);
+                    } else if (status >= 400) {
+                        s.client_errors.fetch_add(1, std::memory_order_relaxed);
+                    } else {
+                        s.ok.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        nlohmann::json report;
+        report["config"] = {{"connections", opts.connections}, {"duration_s", opts.duration},
+                            {"warmup_s", opts.warmup}, {"videos", opts.videos}, {"users", opts.users},
+                            {"topics", opts.topics}, {"zipf", opts.zipf}, {"embedded", opts.embedded},
+                            {"seed", opts.seed}};
+        for (size_t i = 0; i < OP_COUNT; ++i) {
+            report["config"]["mix"][OPS[i].name] = opts.weights[i];
+        }
+        report["routes"] = nlohmann::json::array();
+        LatencyHistogram::Snapshot total;
+        uint64_t ok = 0, client_errors = 0, server_errors = 0, failures = 0;
+        for (size_t i = 0; i < OP_COUNT; ++i) {
+            if (opts.weights[i] == 0) {
+                continue;
+            }
+            const OpStats& s = stats[i];
+            LatencyHistogram::Snapshot snap = s.latency.snapshot();
+            report["routes"].push_back(summarize(OPS[i].name, snap, s.ok, s.client_errors, s.server_errors,
+                                                 s.failures, opts.duration));
+            for (size_t b = 0; b < LatencyHistogram::BUCKETS; ++b) {
+                total.counts[b] += snap.counts[b];
+            }
+            total.count += snap.count;
+            total.sum_us += snap.sum_us;
+            ok += s.ok;
+            client_errors += s.client_errors;
+            server_errors += s.server_errors;
+            failures += s.failures;
+        }
+        report["total"] = summarize("total", total, ok, client_errors, server_errors, failures, opts.duration);
+
+        if (opts.json) {
+            std::cout << report.dump(2) << std::endl;
+        } else {
+            printReport(report, opts.baseline_path.empty() ? nullptr : &baseline);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}